@@ -0,0 +1,509 @@
+/**
+ * @file
+ *
+ * Solves many instances of the tsp in one process. The instances are listed
+ * in a manifest and solved on a fixed pool of threads, every thread reusing
+ * its buffers from one instance to the next.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <pthread.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "sampleMap.h"
+#include "mapReader.h"
+#include "neuralNet.h"
+#include "solver.h"
+#include "instrument.h"
+#include "telemetry.h"
+#include "pool.h"
+/* -------------------------------------------------------------------------- */
+
+/* A type for the config */
+typedef struct {
+  unsigned long maxLearn
+              , seed
+              , threads
+              ;
+
+  double ratio
+       , epsilon
+       ;
+
+  Boolean tours
+        , help
+        , error
+        ;
+
+  char * manifest
+     , * outFile
+     ;
+} Config;
+
+/* Buffers of a worker that are reused for every instance it solves */
+typedef struct {
+  SampleMap cities;
+  unsigned long * tour;
+} Scratch;
+
+/* Everything the workers share */
+typedef struct {
+  Config c;
+
+  /* Instance files in the order of the manifest */
+  char ** files;
+  unsigned long jobs;
+
+  Scratch * scratch;
+
+  /* Results, written by one worker at a time */
+  FILE * out;
+  unsigned long failed;
+  pthread_mutex_t lock;
+} Batch;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_MAXLEARN (10000)
+#define DEFAULT_SEED     (    1)
+#define DEFAULT_RATIO    (    0)
+#define DEFAULT_EPSILON  (    0)
+#define DEFAULT_THREADS  (    0)
+#define DEFAULT_OUTFILE  (  "-")
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the default config
+ *
+ * @return Default config.
+ */
+static Config getDefaultConfig(void)
+{
+  Config c;
+
+  c.maxLearn = DEFAULT_MAXLEARN;
+  c.seed     = DEFAULT_SEED;
+  c.threads  = DEFAULT_THREADS;
+  c.ratio    = DEFAULT_RATIO;
+  c.epsilon  = DEFAULT_EPSILON;
+  c.tours    = FALSE;
+  c.help     = FALSE;
+  c.error    = FALSE;
+  c.manifest = NULL;
+  c.outFile  = DEFAULT_OUTFILE;
+
+  return c;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "tspbatch, a program for solving many instances of the traveling salesman problem in 2D eucledian space at once.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "Usage: tspbatch <manifest> [options]\n");
+  fprintf(stream, "  Required arguments:\n");
+  fprintf(stream, "    manifest       File that lists one tsp file per line, - for stdin.\n");
+  fprintf(stream, "                   Empty lines and lines starting with # are skipped.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -l <number>    Set the number of learning cycles           (default: %i)\n", DEFAULT_MAXLEARN);
+  fprintf(stream, "    -r <number>    Maximum number of neurons per city          (default: log(cities))\n");
+  fprintf(stream, "    -e <number>    Merge cities in grid cells of this diagonal (default: %i)\n", DEFAULT_EPSILON);
+  fprintf(stream, "    -s <number>    Seed for the random number generator        (default: %i)\n", DEFAULT_SEED);
+  fprintf(stream, "    -j <number>    Number of threads                           (default: number of cpus)\n");
+  fprintf(stream, "    -o <file>      Write the results as JSON lines to file     (default: %s)\n", DEFAULT_OUTFILE);
+  fprintf(stream, "    -T             Include the tour through all cities in the results\n");
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = getDefaultConfig();
+
+  /* First parameter is the manifest */
+  c.manifest = argv[1];
+  int i = 2;
+
+  while (i < argc && !c.error)
+  {
+    if (strcmp(argv[i], "-h") == 0)
+      c.help = TRUE;
+
+    else if (strcmp(argv[i], "-T") == 0)
+      c.tours = TRUE;
+
+    else if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-l") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.maxLearn) != 1 || !c.maxLearn;
+
+    else if (strcmp(argv[i], "-r") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.ratio) != 1;
+
+    else if (strcmp(argv[i], "-e") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.epsilon) != 1;
+
+    else if (strcmp(argv[i], "-s") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.seed) != 1;
+
+    else if (strcmp(argv[i], "-j") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.threads) != 1 || !c.threads;
+
+    else if (strcmp(argv[i], "-o") == 0)
+      c.outFile = argv[++i];
+
+    else
+      c.error = TRUE;
+
+    ++i;
+  }
+
+  if (c.error)
+    fprintf(stderr, "[ERROR] Invalid argument %s.\n", argv[i - 1]);
+
+  return c;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Reads the instance files listed in the manifest.
+ *
+ * @param[in]  filename  The manifest, - for stdin.
+ * @param[out] files     The instance files.
+ *
+ * @return Number of instance files, 0 in case of an error.
+ */
+static unsigned long readManifest(char * filename, char *** files)
+{
+  FILE * f = strcmp(filename, "-") ? fopen(filename, "r") : stdin;
+
+  char * line = NULL
+     , * start
+     , * end
+     , ** grown
+     ;
+  size_t length = 0;
+
+  unsigned long items = 0
+              , size  = 0
+              ;
+
+  *files = NULL;
+
+  if (!f)
+  {
+    fprintf(stderr, "[ERROR] Could not open manifest %s.\n", filename);
+    return 0;
+  }
+
+  while (getline(&line, &length, f) >= 0)
+  {
+    /* Trim the line */
+    for (start = line; isspace((unsigned char) *start); ++start);
+    for (end = start + strlen(start); end > start && isspace((unsigned char) end[-1]); --end);
+    *end = '\0';
+
+    if (!*start || *start == '#')
+      continue;
+
+    if (items == size)
+    {
+      size  = size ? 2 * size : 64;
+      grown = realloc(*files, size * sizeof(char *));
+
+      if (!grown)
+      {
+        perror("[ERROR] readManifest :: realloc failed.");
+        break;
+      }
+
+      *files = grown;
+    }
+
+    if (!((*files)[items] = strdup(start)))
+    {
+      perror("[ERROR] readManifest :: strdup failed.");
+      break;
+    }
+
+    ++items;
+  }
+
+  /* Stopped early because of an error */
+  if (!feof(f))
+  {
+    while (items)
+      free((*files)[--items]);
+
+    free(*files);
+    *files = NULL;
+  }
+
+  free(line);
+
+  if (f != stdin)
+    fclose(f);
+
+  return items;
+}
+
+/**
+ * Reads the cities of an instance into the buffers of a worker, which grow if
+ * they are too small.
+ *
+ * @param[in,out] scratch   Buffers of the worker.
+ * @param[in]     filename  The instance file.
+ *
+ * @return 0 on success.
+ */
+static int readCities(Scratch * scratch, char * filename)
+{
+  Vector p;
+
+  MapReader reader = mapReaderOpen(filename);
+
+  int error = !reader.file || !reader.items;
+
+  if (!error && reader.items > scratch->cities.size)
+  {
+    scratch->cities = sampleMapFree(scratch->cities);
+    free(scratch->tour);
+
+    scratch->cities = sampleMapMake(reader.items);
+    scratch->tour   = malloc(reader.items * sizeof(unsigned long));
+
+    if (!scratch->tour)
+      perror("[ERROR] readCities :: malloc failed.");
+
+    error = !scratch->cities.samples || !scratch->tour;
+  }
+
+  scratch->cities.items = 0;
+
+  while (!error && scratch->cities.items < reader.items)
+  {
+    error = mapReaderNext(&reader, &p);
+
+    if (!error)
+      scratch->cities = sampleMapPut(scratch->cities, p);
+  }
+
+  if (reader.file)
+    reader = mapReaderClose(reader);
+
+  return error;
+}
+
+/**
+ * Solves one instance of the manifest and writes its result.
+ *
+ * @param[in] arg     The batch.
+ * @param[in] worker  The worker.
+ * @param[in] job     Index of the instance in the manifest.
+ */
+static void solve(void * arg, unsigned worker, unsigned long job)
+{
+  Batch * batch = arg;
+  Config c = batch->c;
+  Scratch * scratch = &batch->scratch[worker];
+  char * filename = batch->files[job];
+
+  uint64_t start = instrumentNow();
+
+  Solver solver = NULL;
+  SolverOptions options = solverDefaultOptions();
+
+  unsigned long samples = 0
+              , neurons = 0
+              ;
+
+  double netLength  = 0.0
+       , tourLength = -1.0
+       ;
+
+  int error = readCities(scratch, filename);
+
+  if (!error)
+  {
+    options.iterations = c.maxLearn;
+    options.ratio      = c.ratio;
+    options.epsilon    = c.epsilon;
+    options.seed       = c.seed;
+
+    solver = solverMake(scratch->cities, options);
+    error  = !solver;
+  }
+
+  if (!error)
+  {
+    error = solverRun(solver) < 0;
+
+    samples    = solverSamples(solver).items;
+    neurons    = solverNet(solver).size;
+    netLength  = neuralNetLength(solverNet(solver));
+    tourLength = error ? -1 : solverTour(solver, scratch->tour);
+    error      = tourLength < 0;
+
+    solver = solverFree(solver);
+  }
+
+  double seconds = (instrumentNow() - start) / 1e9;
+
+  pthread_mutex_lock(&batch->lock);
+
+  if (error)
+  {
+    fprintf(stderr, "[ERROR] Could not solve %s.\n", filename);
+    fprintf(batch->out, "{\"job\": %lu, \"file\": ", job);
+    telemetryWriteString(batch->out, filename);
+    fprintf(batch->out, ", \"error\": true}\n");
+    ++batch->failed;
+  }
+  else
+  {
+    fprintf(batch->out, "{\"job\": %lu, \"file\": ", job);
+    telemetryWriteString(batch->out, filename);
+    fprintf(batch->out, ", \"cities\": %lu, \"samples\": %lu, \"iterations\": %lu, \"seed\": %lu"
+                        ", \"neurons\": %lu, \"seconds\": %.6lf, \"netLength\": %.6lf, \"tourLength\": %.6lf"
+                      , scratch->cities.items, samples, c.maxLearn, c.seed
+                      , neurons, seconds, netLength, tourLength);
+
+    if (c.tours)
+    {
+      fprintf(batch->out, ", \"tour\": [");
+      for (unsigned long i = 0; i < scratch->cities.items; ++i)
+        fprintf(batch->out, "%s%lu", i ? ", " : "", scratch->tour[i]);
+      fprintf(batch->out, "]");
+    }
+
+    fprintf(batch->out, "}\n");
+  }
+
+  pthread_mutex_unlock(&batch->lock);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  Config c = parseArgs(argc, argv);
+
+  if (c.help || c.error)
+  {
+    help(stderr);
+    return c.error;
+  }
+
+  Batch batch;
+  batch.c      = c;
+  batch.failed = 0;
+  batch.jobs   = readManifest(c.manifest, &batch.files);
+
+  if (!batch.jobs)
+  {
+    fprintf(stderr, "[ERROR] No instances in manifest %s.\n", c.manifest);
+    return 1;
+  }
+
+  /* One thread per cpu, but not more than there are instances */
+  if (!c.threads)
+  {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    c.threads = cpus > 0 ? cpus : 1;
+  }
+
+  if (c.threads > batch.jobs)
+    c.threads = batch.jobs;
+
+  batch.out     = strcmp(c.outFile, "-") ? fopen(c.outFile, "w") : stdout;
+  batch.scratch = calloc(c.threads, sizeof(Scratch));
+
+  int error = 0;
+
+  if (!batch.out)
+  {
+    fprintf(stderr, "[ERROR] Could not open output file %s.\n", c.outFile);
+    error = 1;
+  }
+  else if (!batch.scratch)
+  {
+    perror("[ERROR] main :: calloc failed.");
+    error = 1;
+  }
+  else
+  {
+    pthread_mutex_init(&batch.lock, NULL);
+
+    #ifdef INFO
+    uint64_t start = instrumentNow();
+    #endif
+
+    Pool pool = poolMake(c.threads, solve, &batch);
+
+    if (pool)
+    {
+      poolRun(pool, batch.jobs);
+      pool = poolFree(pool);
+    }
+    else
+      error = 1;
+
+    #ifdef INFO
+    fprintf(stderr, "[INFO ] Solved %lu of %lu instances on %lu threads in %.3lf s.\n"
+                  , batch.jobs - batch.failed, batch.jobs, c.threads
+                  , (instrumentNow() - start) / 1e9);
+    #endif
+
+    pthread_mutex_destroy(&batch.lock);
+
+    error = error || batch.failed;
+  }
+
+  /* Clean up... */
+  if (batch.scratch)
+    for (unsigned long w = 0; w < c.threads; ++w)
+    {
+      batch.scratch[w].cities = sampleMapFree(batch.scratch[w].cities);
+      free(batch.scratch[w].tour);
+    }
+
+  free(batch.scratch);
+
+  for (unsigned long job = 0; job < batch.jobs; ++job)
+    free(batch.files[job]);
+
+  free(batch.files);
+
+  if (batch.out && batch.out != stdout)
+    fclose(batch.out);
+
+  return error;
+}
@@ -0,0 +1,116 @@
+#!/bin/sh
+#
+# Runs tspsom over the TSPLIB instances in data/ with fixed seeds and several
+# iteration budgets and collects wall time, iterations per second, peak RSS,
+# tour length and the gap to the known optimum as CSV and JSON.
+#
+# The optima refer to TSPLIB's integer rounded distances, so the gaps are
+# approximate. For GEO instances, the coordinates are latitudes and longitudes
+# and no gap is computed.
+#
+# With counters set to yes, the hardware counters of the training phases are
+# collected as well. They are empty where the machine does not provide them.
+#
+# Usage: bench.sh <tspsom> <output prefix> [iterations] [seeds] [counters]
+#
+# Author: Christopher Blöcker
+
+TSPSOM=${1:-./tspsom}
+OUT=${2:-bench/results}
+ITERATIONS=${3:-"10000 100000"}
+SEEDS=${4:-"1 2 3"}
+COUNTERS=${5:-no}
+
+KEYS="iterations seed cities samples neurons seconds iterationsPerSecond peakRssKb netLength tourLength"
+FLAGS=""
+
+if [ "$COUNTERS" = yes ]
+then
+  FLAGS="-P"
+
+  for phase in train grow
+  do
+    for counter in Cycles Instructions L1dMisses LlcMisses DtlbMisses
+    do
+      KEYS="$KEYS $phase$counter"
+    done
+  done
+fi
+
+DIR=$(dirname "$0")
+DATA="$DIR/../data"
+TMP=$(mktemp -d)
+trap 'rm -rf "$TMP"' EXIT INT TERM
+
+# Run every instance, smallest first, with every budget and seed
+tail -n +2 "$DIR/optimal.csv" | while IFS=, read -r name metric optimum
+do
+  [ -f "$DATA/$name.tsp" ] || continue
+
+  for iterations in $ITERATIONS
+  do
+    for seed in $SEEDS
+    do
+      echo "bench :: $name, $iterations iterations, seed $seed" >&2
+
+      if ! "$TSPSOM" "$DATA/$name.tsp" -l "$iterations" -p 0 -s "$seed" -J "$TMP/report.json" $FLAGS 2> "$TMP/log"
+      then
+        cat "$TMP/log" >&2
+        exit 1
+      fi
+
+      printf '%s,%s,%s\n' "$name" "$metric" "$optimum" >> "$TMP/instances"
+      cat "$TMP/report.json" >> "$TMP/reports"
+    done
+  done
+done || exit 1
+
+# Join the instances with their reports and compute the gaps
+paste -d '\t' "$TMP/instances" "$TMP/reports" | awk -F '\t' -v csv="$OUT.csv" -v json="$OUT.json" -v keylist="$KEYS" '
+  function get(report, key,    s) {
+    if (!index(report, "\"" key "\""))
+      return ""
+
+    s = report
+    sub(".*\"" key "\": *", "", s)
+    sub("[,}].*", "", s)
+    gsub("\"", "", s)
+    return s
+  }
+
+  BEGIN {
+    n = split(keylist, keys, " ")
+
+    printf "instance,metric,optimum" > csv
+    for (k = 1; k <= n; ++k)
+      printf ",%s", keys[k] > csv
+    printf ",gapPercent\n" > csv
+
+    printf "[" > json
+  }
+
+  {
+    split($1, instance, ",")
+
+    gap = instance[2] == "GEO" ? "" : sprintf("%.4f", 100 * (get($2, "tourLength") - instance[3]) / instance[3])
+
+    printf "%s,%s,%s", instance[1], instance[2], instance[3] > csv
+    printf "%s\n  {\"instance\": \"%s\", \"metric\": \"%s\", \"optimum\": %s", (NR > 1 ? "," : ""), instance[1], instance[2], instance[3] > json
+
+    for (k = 1; k <= n; ++k)
+    {
+      value = get($2, keys[k])
+      printf ",%s", (value == "null" ? "" : value) > csv
+      printf ", \"%s\": %s", keys[k], (value == "" ? "null" : value) > json
+    }
+
+    printf ",%s\n", gap > csv
+    printf ", \"gapPercent\": %s}", (gap == "" ? "null" : gap) > json
+  }
+
+  END {
+    printf "\n]\n" > json
+  }
+' || exit 1
+
+echo "bench :: results written to $OUT.csv and $OUT.json" >&2
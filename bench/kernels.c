@@ -0,0 +1,671 @@
+/**
+ * @file
+ *
+ * Microbenchmarks for the hot kernels of tspsom on synthetic nets: the search
+ * for the best matching unit, the update of its neighbourhood, growing,
+ * pruning, measuring the length of the net, rendering the background with the
+ * cities and rendering a picture of the net, as well as the array kernels of
+ * the vector module on the positions of the neurons.
+ *
+ * Every kernel is run a number of times for warm-up, then measured for a
+ * number of repetitions. The minimum, median, mean and standard deviation of
+ * the repetitions are printed as CSV.
+ *
+ * With -c, the array kernels of the vector module are instead compared with
+ * plain scalar loops on random inputs of every length up to CHECK_MAXN. The
+ * coordinates lie on a small integer grid, so that ties are frequent and all
+ * arithmetic is exact, and any difference is a mismatch.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "rng.h"
+#include "sampleMap.h"
+#include "neuralNet.h"
+#include "drawer.h"
+/* -------------------------------------------------------------------------- */
+
+/* Everything a kernel works on */
+typedef struct {
+  unsigned long neurons;
+
+  Rng rng;
+
+  /* Neuron positions along a noisy circle, in ring order */
+  Vector * positions;
+
+  /* Output of the array kernels */
+  double * distances;
+  Vector * projected;
+
+  /* Cities, uniformly distributed around the circle */
+  SampleMap samples;
+  PositionBounds bounds;
+
+  /* Net on the positions, and its neurons in ring order */
+  NeuralNet net;
+  Neuron * nodes;
+
+  /* Net that is modified by a repetition */
+  NeuralNet scratch;
+
+  /* Background with the cities for rendering */
+  Drawer drawer;
+} Fixture;
+
+/* A kernel to benchmark */
+typedef struct {
+  const char * name;
+
+  /* Operations per repetition, for reporting the time per operation */
+  unsigned long ops;
+
+  /* Run before and after each repetition, not measured */
+  void (*setup)(Fixture *);
+  void (*teardown)(Fixture *);
+
+  /* One repetition */
+  void (*run)(Fixture *);
+} Kernel;
+
+/* Statistics over the repetitions, in nanoseconds */
+typedef struct {
+  double min
+       , median
+       , mean
+       , stddev
+       ;
+} Stats;
+
+/* A type for the config */
+typedef struct {
+  unsigned long maxNeurons
+              , repetitions
+              , warmup
+              ;
+
+  char * kernel;
+
+  Boolean check
+        , error
+        ;
+} Config;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_MAXNEURONS  (1000000)
+#define DEFAULT_REPETITIONS (     20)
+#define DEFAULT_WARMUP      (      3)
+
+/* Spacing of neurons along the circle, larger than the pruning distance */
+#define SPACING (4.0)
+
+/* Operations per repetition of the cheap kernels */
+#define BMU_OPS    (  64)
+#define UPDATE_OPS (4096)
+
+/* Longest input and rounds per length when checking the array kernels */
+#define CHECK_MAXN   (100)
+#define CHECK_ROUNDS (200)
+/* -------------------------------------------------------------------------- */
+
+/* Keeps results alive so that the compiler doesn't drop the kernels */
+static volatile double sink;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Reads the monotonic clock.
+ *
+ * @return Time in nanoseconds.
+ */
+static double now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/**
+ * Orders doubles ascendingly.
+ */
+static int compareDouble(const void * a, const void * b)
+{
+  double u = *(const double *) a
+       , v = *(const double *) b
+       ;
+
+  return (u > v) - (u < v);
+}
+
+/**
+ * Calculates statistics over the given measurements.
+ *
+ * @param[in] times  Measurements, will be sorted.
+ * @param[in] n      Number of measurements.
+ *
+ * @return Statistics.
+ */
+static Stats statsMake(double * times, unsigned long n)
+{
+  Stats res = { 0, 0, 0, 0 };
+
+  qsort(times, n, sizeof(double), compareDouble);
+
+  for (unsigned long i = 0; i < n; ++i)
+    res.mean += times[i] / n;
+
+  for (unsigned long i = 0; i < n; ++i)
+    res.stddev += (times[i] - res.mean) * (times[i] - res.mean) / (n > 1 ? n - 1 : 1);
+
+  res.min    = times[0];
+  res.median = n % 2 ? times[n / 2] : (times[n / 2 - 1] + times[n / 2]) / 2;
+  res.stddev = sqrt(res.stddev);
+
+  return res;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the positions, cities and net for the given number of neurons.
+ *
+ * @param[in] neurons  Number of neurons.
+ *
+ * @return The fixture.
+ */
+static Fixture fixtureMake(unsigned long neurons)
+{
+  Fixture f;
+
+  double radius = SPACING * neurons / (2 * M_PI);
+
+  f.neurons   = neurons;
+  f.rng       = rngMake(neurons);
+  f.positions = malloc(neurons * sizeof(Vector));
+  f.nodes     = malloc(neurons * sizeof(Neuron));
+  f.distances = malloc(neurons * sizeof(double));
+  f.projected = malloc(neurons * sizeof(Vector));
+  f.samples   = sampleMapMake(neurons / 4 + 1);
+
+  if (!f.positions || !f.nodes || !f.distances || !f.projected || !f.samples.samples)
+  {
+    perror("[ERROR] fixtureMake :: malloc failed.");
+    exit(1);
+  }
+
+  for (unsigned long i = 0; i < neurons; ++i)
+  {
+    double angle = 2 * M_PI * i / neurons;
+
+    f.positions[i] = vectorScale( vectorMake(cos(angle), sin(angle))
+                                , radius + SPACING * (rngUniform(&f.rng) - 0.5)
+                                );
+  }
+
+  while (f.samples.items < f.samples.size)
+    f.samples = sampleMapPut(f.samples, vectorMake( radius * (2 * rngUniform(&f.rng) - 1)
+                                                  , radius * (2 * rngUniform(&f.rng) - 1)
+                                                  ));
+
+  f.bounds.topleft     = vectorMake(-radius - SPACING, -radius - SPACING);
+  f.bounds.bottomright = vectorMake( radius + SPACING,  radius + SPACING);
+
+  f.net = neuralNetMakeFrom(f.positions, neurons, neurons);
+
+  Neuron neuron = f.net.neurons;
+  for (unsigned long i = 0; i < neurons; ++i, neuron = neuron->next)
+    f.nodes[i] = neuron;
+
+  return f;
+}
+
+/**
+ * Frees the memory used by the given fixture.
+ *
+ * @param[in] f  The fixture.
+ */
+static void fixtureFree(Fixture * f)
+{
+  f->net     = neuralNetFree(f->net);
+  f->samples = sampleMapFree(f->samples);
+
+  free(f->positions);
+  free(f->nodes);
+  free(f->distances);
+  free(f->projected);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void bmuRun(Fixture * f)
+{
+  for (int i = 0; i < BMU_OPS; ++i)
+    sink = neuralNetNearest(f->net, f->samples.samples[rngIndex(&f->rng, f->samples.items)])->p.x;
+}
+
+static void updateRun(Fixture * f)
+{
+  for (int i = 0; i < UPDATE_OPS; ++i)
+    neuralNetAdapt( f->net
+                  , f->nodes[rngIndex(&f->rng, f->neurons)]
+                  , f->samples.samples[rngIndex(&f->rng, f->samples.items)]
+                  , 0.5
+                  );
+}
+
+/* Every other neuron has been activated and grows a new neighbour */
+static void growSetup(Fixture * f)
+{
+  f->scratch = neuralNetMakeFrom(f->positions, f->neurons, 2 * f->neurons);
+
+  Neuron neuron = f->scratch.neurons;
+  for (unsigned long i = 0; i < f->neurons; ++i, neuron = neuron->next)
+    neuron->hits = i % 2;
+}
+
+static void growRun(Fixture * f)
+{
+  f->scratch = neuralNetGrow(f->scratch, 1.0);
+}
+
+/* Every other neuron coincides with its predecessor and is removed */
+static void pruneSetup(Fixture * f)
+{
+  f->scratch = neuralNetMakeFrom(f->positions, f->neurons, f->neurons);
+
+  Neuron neuron = f->scratch.neurons;
+  for (unsigned long i = 0; i < f->neurons; ++i, neuron = neuron->next)
+    if (i % 2 && i + 1 < f->neurons)
+      neuron->p = neuron->prev->p;
+}
+
+static void pruneRun(Fixture * f)
+{
+  f->scratch = neuralNetRemoveDoubleNeurons(f->scratch);
+}
+
+static void scratchTeardown(Fixture * f)
+{
+  f->scratch = neuralNetFree(f->scratch);
+}
+
+static void lengthRun(Fixture * f)
+{
+  sink = neuralNetLength(f->net);
+}
+
+/* The search for the best matching unit in two passes over the positions */
+static void distancesRun(Fixture * f)
+{
+  for (int i = 0; i < BMU_OPS; ++i)
+  {
+    vectorDistances2(f->samples.samples[rngIndex(&f->rng, f->samples.items)], f->positions, f->neurons, f->distances);
+    sink = vectorArgmin(f->distances, f->neurons);
+  }
+}
+
+static void boundsRun(Fixture * f)
+{
+  Vector min
+       , max
+       ;
+
+  vectorBounds(f->positions, f->neurons, &min, &max);
+  sink = max.x - min.x;
+}
+
+static void projectRun(Fixture * f)
+{
+  vectorProject(f->positions, f->neurons, f->bounds.topleft, vectorMake(2, -2), vectorMake(1, 1), f->projected);
+  sink = f->projected[f->neurons - 1].x;
+}
+
+static void backgroundRun(Fixture * f)
+{
+  f->drawer = drawerFree(drawerMake(f->samples, f->bounds));
+}
+
+static void renderSetup(Fixture * f)
+{
+  f->drawer = drawerMake(f->samples, f->bounds);
+}
+
+static void renderRun(Fixture * f)
+{
+  drawerDrawMap(f->drawer, f->net, f->samples, "/dev/null");
+}
+
+static void renderTeardown(Fixture * f)
+{
+  f->drawer = drawerFree(f->drawer);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static const Kernel kernels[] =
+  { { "bmu",    BMU_OPS,    NULL,        NULL,            bmuRun    }
+  , { "update", UPDATE_OPS, NULL,        NULL,            updateRun }
+  , { "grow",   1,          growSetup,   scratchTeardown, growRun   }
+  , { "prune",  1,          pruneSetup,  scratchTeardown, pruneRun  }
+  , { "length", 1,          NULL,        NULL,            lengthRun }
+  , { "distances", BMU_OPS, NULL,        NULL,            distancesRun }
+  , { "bounds", 1,          NULL,        NULL,            boundsRun }
+  , { "project", 1,         NULL,        NULL,            projectRun }
+  , { "background", 1,      NULL,        NULL,            backgroundRun }
+  , { "render", 1,          renderSetup, renderTeardown,  renderRun }
+  };
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Runs the kernel for warm-up and then for the measured repetitions and
+ * prints the statistics.
+ *
+ * @param[in] c  Config.
+ * @param[in] k  The kernel.
+ * @param[in] f  The fixture.
+ */
+static void benchmark(Config c, const Kernel * k, Fixture * f)
+{
+  double * times = malloc(c.repetitions * sizeof(double))
+       , start
+       ;
+
+  if (!times)
+  {
+    perror("[ERROR] benchmark :: malloc failed.");
+    exit(1);
+  }
+
+  for (unsigned long i = 0; i < c.warmup + c.repetitions; ++i)
+  {
+    if (k->setup)
+      k->setup(f);
+
+    start = now();
+    k->run(f);
+
+    if (i >= c.warmup)
+      times[i - c.warmup] = now() - start;
+
+    if (k->teardown)
+      k->teardown(f);
+  }
+
+  Stats s = statsMake(times, c.repetitions);
+
+  printf("%s,%lu,%lu,%lu,%.0lf,%.0lf,%.0lf,%.0lf,%.2lf,%.4lf\n"
+        , k->name, f->neurons, c.repetitions, k->ops
+        , s.min, s.median, s.mean, s.stddev
+        , s.median / k->ops, s.median / k->ops / f->neurons);
+  fflush(stdout);
+
+  free(times);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Draws a coordinate from the grid -4, -3, ..., 3.
+ *
+ * @param[in] rng  Random number generator.
+ *
+ * @return The coordinate.
+ */
+static double gridValue(Rng * rng)
+{
+  return (double) rngIndex(rng, 8) - 4.0;
+}
+
+/**
+ * Reports a mismatch between a kernel and the scalar reference.
+ *
+ * @param[in] kernel  Name of the kernel.
+ * @param[in] n       Length of the input.
+ * @param[in] i       Index at which the results differ.
+ *
+ * @return 1, to be added to the number of mismatches.
+ */
+static unsigned long mismatch(const char * kernel, unsigned long n, unsigned long i)
+{
+  fprintf(stderr, "[ERROR] %s :: n = %lu, differs from the scalar reference at %lu.\n", kernel, n, i);
+
+  return 1;
+}
+
+/**
+ * Compares the array kernels of the vector module with scalar loops on one
+ * random input of the given length.
+ *
+ * @param[in] rng  Random number generator.
+ * @param[in] n    Length of the input, at least 1.
+ *
+ * @return Number of mismatches.
+ */
+static unsigned long checkRound(Rng * rng, unsigned long n)
+{
+  Vector * points    = malloc(n * sizeof(Vector))
+       , * moved     = malloc(n * sizeof(Vector))
+       , * projected = malloc(n * sizeof(Vector))
+       ;
+  double * distances = malloc(n * sizeof(double))
+       , * rates     = malloc(n * sizeof(double))
+       ;
+  unsigned long res = 0;
+
+  if (!points || !moved || !projected || !distances || !rates)
+  {
+    perror("[ERROR] checkRound :: malloc failed.");
+    exit(1);
+  }
+
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    points[i] = vectorMake(gridValue(rng), gridValue(rng));
+    rates[i]  = rngIndex(rng, 9) / 8.0;
+  }
+
+  Vector u      = vectorMake(gridValue(rng), gridValue(rng))
+       , origin = vectorMake(gridValue(rng), gridValue(rng))
+       , scale  = vectorMake(gridValue(rng) / 2, gridValue(rng) / 4)
+       , offset = vectorMake(gridValue(rng), gridValue(rng))
+       , min
+       , max
+       ;
+
+  /* Squared distances */
+  vectorDistances2(u, points, n, distances);
+
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    double dx = points[i].x - u.x
+         , dy = points[i].y - u.y
+         ;
+
+    if (distances[i] != dx * dx + dy * dy)
+    {
+      res += mismatch("distances", n, i);
+      break;
+    }
+  }
+
+  /* The first smallest distance, which is also the first nearest point */
+  unsigned long nearest = 0;
+
+  for (unsigned long i = 1; i < n; ++i)
+    if (distances[i] < distances[nearest])
+      nearest = i;
+
+  if (vectorArgmin(distances, n) != nearest)
+    res += mismatch("argmin", n, nearest);
+
+  if (vectorNearest(u, points, n) != nearest)
+    res += mismatch("nearest", n, nearest);
+
+  /* Bounding box */
+  Vector lo = points[0]
+       , hi = points[0]
+       ;
+
+  for (unsigned long i = 1; i < n; ++i)
+  {
+    lo = vectorMake(fmin(lo.x, points[i].x), fmin(lo.y, points[i].y));
+    hi = vectorMake(fmax(hi.x, points[i].x), fmax(hi.y, points[i].y));
+  }
+
+  vectorBounds(points, n, &min, &max);
+
+  if (min.x != lo.x || min.y != lo.y || max.x != hi.x || max.y != hi.y)
+    res += mismatch("bounds", n, 0);
+
+  /* Affine map */
+  vectorProject(points, n, origin, scale, offset, projected);
+
+  for (unsigned long i = 0; i < n; ++i)
+    if ( projected[i].x != (points[i].x - origin.x) * scale.x + offset.x
+      || projected[i].y != (points[i].y - origin.y) * scale.y + offset.y
+       )
+    {
+      res += mismatch("project", n, i);
+      break;
+    }
+
+  /* Moving towards the target */
+  memcpy(moved, points, n * sizeof(Vector));
+  vectorToward(moved, n, u, rates);
+
+  for (unsigned long i = 0; i < n; ++i)
+    if ( moved[i].x != points[i].x + (u.x - points[i].x) * rates[i]
+      || moved[i].y != points[i].y + (u.y - points[i].y) * rates[i]
+       )
+    {
+      res += mismatch("toward", n, i);
+      break;
+    }
+
+  free(points);
+  free(moved);
+  free(projected);
+  free(distances);
+  free(rates);
+
+  return res;
+}
+
+/**
+ * Compares the array kernels of the vector module with scalar loops on random
+ * inputs of every length up to CHECK_MAXN.
+ *
+ * @return Number of mismatches.
+ */
+static unsigned long check(void)
+{
+  Rng rng = rngMake(1);
+  unsigned long res = 0;
+
+  for (unsigned long n = 1; n <= CHECK_MAXN; ++n)
+    for (unsigned long round = 0; round < CHECK_ROUNDS; ++round)
+      res += checkRound(&rng, n);
+
+  printf("%d inputs of up to %d points checked, %lu mismatches.\n", CHECK_MAXN * CHECK_ROUNDS, CHECK_MAXN, res);
+
+  return res;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "Usage: kernels [options]\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -n <number>    Largest net, sizes grow by factors of 10    (default: %i)\n", DEFAULT_MAXNEURONS);
+  fprintf(stream, "    -r <number>    Measured repetitions                        (default: %i)\n", DEFAULT_REPETITIONS);
+  fprintf(stream, "    -w <number>    Warm-up repetitions                         (default: %i)\n", DEFAULT_WARMUP);
+  fprintf(stream, "    -k <kernel>    Only run bmu, update, grow, prune, length, distances,\n");
+  fprintf(stream, "                   bounds, project, background or render\n");
+  fprintf(stream, "    -c             Compare the array kernels with scalar loops instead\n");
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = { DEFAULT_MAXNEURONS, DEFAULT_REPETITIONS, DEFAULT_WARMUP, NULL, FALSE, FALSE };
+
+  for (int i = 1; i < argc && !c.error; ++i)
+  {
+    if (strcmp(argv[i], "-c") == 0)
+      c.check = TRUE;
+
+    else if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-n") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.maxNeurons) != 1;
+
+    else if (strcmp(argv[i], "-r") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.repetitions) != 1 || !c.repetitions;
+
+    else if (strcmp(argv[i], "-w") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.warmup) != 1;
+
+    else if (strcmp(argv[i], "-k") == 0)
+      c.kernel = argv[++i];
+
+    else
+      c.error = TRUE;
+  }
+
+  return c;
+}
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  Config c = parseArgs(argc, argv);
+
+  if (c.error)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  if (c.check)
+    return check() != 0;
+
+  printf("kernel,neurons,repetitions,ops,min_ns,median_ns,mean_ns,stddev_ns,median_ns_per_op,median_ns_per_op_per_neuron\n");
+
+  for (unsigned long neurons = 1000; neurons <= c.maxNeurons; neurons *= 10)
+  {
+    Fixture f = fixtureMake(neurons);
+
+    for (unsigned long k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+      if (!c.kernel || strcmp(c.kernel, kernels[k].name) == 0)
+        benchmark(c, &kernels[k], &f);
+
+    fixtureFree(&f);
+  }
+
+  return 0;
+}
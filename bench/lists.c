@@ -0,0 +1,582 @@
+/**
+ * @file
+ *
+ * Benchmarks the list library against the recursive implementation it
+ * replaced, which allocated every node with calloc and recursed once per
+ * element: building a list from a sorted array, measuring its length,
+ * accessing its last element, looking up, inserting and removing elements
+ * and freeing the list.
+ *
+ * The lists hold the even numbers below twice the number of elements, odd
+ * numbers are inserted and removed. Every kernel is run a number of times for
+ * warm-up, then measured for a number of repetitions, and the median is
+ * printed as CSV. The recursion of the old implementation needs a stack
+ * proportional to the length of the lists, so the benchmark runs on a thread
+ * with a large stack.
+ *
+ * With -c, both implementations are instead compared with each other and with
+ * a plain array of flags on random lists with random inserts and removals.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "rng.h"
+#include "list.h"
+/* -------------------------------------------------------------------------- */
+
+/* Everything a kernel works on */
+typedef struct {
+  unsigned long elements;
+
+  /* The even numbers, ascending */
+  Element * elems;
+
+  /* Odd numbers that are looked up, inserted and removed */
+  Element probes[64];
+
+  /* List that kernels only read, and one that a repetition modifies */
+  List list
+     , scratch
+     ;
+} Fixture;
+
+/* An implementation of the list operations */
+typedef struct {
+  const char * name;
+
+  List (*fromSorted)(const Element *, unsigned long);
+  unsigned long (*length)(List);
+  Element (*at)(List, unsigned long);
+  int (*isIn)(Element, List);
+  List (*insertElem)(Element, List);
+  List (*removeElem)(Element, List);
+  List (*removeAllElems)(List);
+} Implementation;
+
+/* A kernel to benchmark */
+typedef struct {
+  const char * name;
+
+  /* Operations per repetition, for reporting the time per operation */
+  unsigned long ops;
+
+  /* Run before and after each repetition, not measured */
+  void (*setup)(const Implementation *, Fixture *);
+  void (*teardown)(const Implementation *, Fixture *);
+
+  /* One repetition */
+  void (*run)(const Implementation *, Fixture *);
+} Kernel;
+
+/* A type for the config */
+typedef struct {
+  unsigned long elements
+              , repetitions
+              , warmup
+              ;
+
+  Boolean check
+        , error
+        ;
+
+  /* Mismatches found with -c, set by the thread that checks */
+  unsigned long mismatches;
+} Config;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_ELEMENTS    (1000000)
+#define DEFAULT_REPETITIONS (      5)
+#define DEFAULT_WARMUP      (      1)
+
+/* Stack of the thread that runs the benchmark */
+#define STACK_SIZE (1UL << 30)
+
+/* Operations per repetition of the kernels that walk into the list */
+#define PROBE_OPS (sizeof(((Fixture *) 0)->probes) / sizeof(Element))
+
+/* Possible elements, rounds and inserts and removals per round with -c */
+#define CHECK_UNIVERSE (500)
+#define CHECK_ROUNDS   (3000)
+#define CHECK_CHANGES  (300)
+
+/* Rounds after which the arena is given back with -c */
+#define CHECK_ARENA (1000)
+/* -------------------------------------------------------------------------- */
+
+/* Keeps results alive so that the compiler doesn't drop the kernels */
+static volatile unsigned long sink;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * The recursive implementation, as it was before the arena.
+ */
+static List recursiveCons(Element e, List l)
+{
+  List res = calloc(sizeof(*l), 1);
+
+  if (!res) exit(1);
+
+  res->value = e;
+  res->next  = l;
+
+  return res;
+}
+
+static List recursiveRemoveHead(List l)
+{
+  List res = l->next;
+
+  free(l);
+
+  return res;
+}
+
+static List recursiveFromSorted(const Element * elems, unsigned long n)
+{
+  List res = NULL;
+
+  while (n--)
+    res = recursiveCons(elems[n], res);
+
+  return res;
+}
+
+static unsigned long recursiveLength(List l)
+{
+  return (l == NULL) ? 0 : 1 + recursiveLength(l->next);
+}
+
+static Element recursiveAt(List l, unsigned long i)
+{
+  return (i == 0) ? l->value : recursiveAt(l->next, i - 1);
+}
+
+static int recursiveIsIn(Element e, List l)
+{
+  return (l == NULL) ? 0 : (list_eqElement(l->value, e)) ? 1 : recursiveIsIn(e, l->next);
+}
+
+static List recursiveInsertElem(Element e, List l)
+{
+  if (l == NULL) return recursiveCons(e, l);
+  if (list_eqElement(l->value, e)) return l;
+  if (list_geElement(l->value, e)) return recursiveCons(e, l);
+  l->next = recursiveInsertElem(e, l->next);
+  return l;
+}
+
+static List recursiveRemoveElem(Element e, List l)
+{
+  if (l == NULL) return l;
+  if (list_geElement(l->value, e) && !list_eqElement(l->value, e)) return l;
+  if (list_eqElement(l->value, e)) return recursiveRemoveHead(l);
+  l->next = recursiveRemoveElem(e, l->next);
+  return l;
+}
+
+static List recursiveRemoveAllElems(List l)
+{
+  if (l == NULL) return l;
+  return recursiveRemoveAllElems(recursiveRemoveHead(l));
+}
+
+/* -------------------------------------------------------------------------- */
+
+static const Implementation implementations[] =
+  { { "arena",     list_fromSorted,     list_length,     list_at,     list_isIn
+    , list_insertElem,     list_removeElem,     list_removeAllElems     }
+  , { "recursive", recursiveFromSorted, recursiveLength, recursiveAt, recursiveIsIn
+    , recursiveInsertElem, recursiveRemoveElem, recursiveRemoveAllElems }
+  };
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Reads the monotonic clock.
+ *
+ * @return Time in nanoseconds.
+ */
+static double now(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/**
+ * Orders doubles ascendingly.
+ */
+static int compareDouble(const void * a, const void * b)
+{
+  double u = *(const double *) a
+       , v = *(const double *) b
+       ;
+
+  return (u > v) - (u < v);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static void buildRun(const Implementation * im, Fixture * f)
+{
+  f->scratch = im->fromSorted(f->elems, f->elements);
+}
+
+static void scratchTeardown(const Implementation * im, Fixture * f)
+{
+  f->scratch = im->removeAllElems(f->scratch);
+}
+
+static void lengthRun(const Implementation * im, Fixture * f)
+{
+  sink = im->length(f->list);
+}
+
+static void atRun(const Implementation * im, Fixture * f)
+{
+  sink = im->at(f->list, f->elements - 1);
+}
+
+static void isInRun(const Implementation * im, Fixture * f)
+{
+  for (unsigned long i = 0; i < PROBE_OPS; ++i)
+    sink = im->isIn(f->probes[i], f->list);
+}
+
+static void insertRun(const Implementation * im, Fixture * f)
+{
+  for (unsigned long i = 0; i < PROBE_OPS; ++i)
+    f->list = im->insertElem(f->probes[i], f->list);
+}
+
+static void insertTeardown(const Implementation * im, Fixture * f)
+{
+  for (unsigned long i = 0; i < PROBE_OPS; ++i)
+    f->list = im->removeElem(f->probes[i], f->list);
+}
+
+static void removeSetup(const Implementation * im, Fixture * f)
+{
+  insertRun(im, f);
+}
+
+static void removeRun(const Implementation * im, Fixture * f)
+{
+  insertTeardown(im, f);
+}
+
+static void freeSetup(const Implementation * im, Fixture * f)
+{
+  buildRun(im, f);
+}
+
+static void freeRun(const Implementation * im, Fixture * f)
+{
+  scratchTeardown(im, f);
+}
+
+/* -------------------------------------------------------------------------- */
+
+static const Kernel kernels[] =
+  { { "build",  1,         NULL,        scratchTeardown, buildRun  }
+  , { "length", 1,         NULL,        NULL,            lengthRun }
+  , { "at",     1,         NULL,        NULL,            atRun     }
+  , { "isIn",   PROBE_OPS, NULL,        NULL,            isInRun   }
+  , { "insert", PROBE_OPS, NULL,        insertTeardown,  insertRun }
+  , { "remove", PROBE_OPS, removeSetup, NULL,            removeRun }
+  , { "free",   1,         freeSetup,   NULL,            freeRun   }
+  };
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Runs the kernel for warm-up and then for the measured repetitions and
+ * prints the median.
+ *
+ * @param[in] c   Config.
+ * @param[in] k   The kernel.
+ * @param[in] im  The implementation.
+ * @param[in] f   The fixture.
+ */
+static void benchmark(Config c, const Kernel * k, const Implementation * im, Fixture * f)
+{
+  double * times = malloc(c.repetitions * sizeof(double))
+       , start
+       ;
+
+  if (!times)
+  {
+    perror("[ERROR] benchmark :: malloc failed.");
+    exit(1);
+  }
+
+  for (unsigned long i = 0; i < c.warmup + c.repetitions; ++i)
+  {
+    if (k->setup)
+      k->setup(im, f);
+
+    start = now();
+    k->run(im, f);
+
+    if (i >= c.warmup)
+      times[i - c.warmup] = now() - start;
+
+    if (k->teardown)
+      k->teardown(im, f);
+  }
+
+  qsort(times, c.repetitions, sizeof(double), compareDouble);
+
+  double median = c.repetitions % 2
+                ? times[c.repetitions / 2]
+                : (times[c.repetitions / 2 - 1] + times[c.repetitions / 2]) / 2
+                ;
+
+  printf("%s,%s,%lu,%lu,%lu,%.0lf,%.0lf,%.2lf\n"
+        , k->name, im->name, f->elements, c.repetitions, k->ops
+        , times[0], median, median / k->ops);
+  fflush(stdout);
+
+  free(times);
+}
+
+/**
+ * Compares both implementations with a plain array of flags on a random list
+ * after random inserts and removals.
+ *
+ * @param[in] rng    Random number generator.
+ * @param[in] round  The round.
+ *
+ * @return Number of mismatches.
+ */
+static unsigned long checkRound(Rng * rng, unsigned long round)
+{
+  const unsigned long n = sizeof(implementations) / sizeof(implementations[0]);
+
+  char ref[CHECK_UNIVERSE];
+  Element elems[CHECK_UNIVERSE];
+  List lists[sizeof(implementations) / sizeof(implementations[0])];
+  unsigned long count = 0
+              , mismatches = 0
+              ;
+
+  for (Element e = 0; e < CHECK_UNIVERSE; ++e)
+    if ((ref[e] = !rngIndex(rng, 3)))
+      elems[count++] = e;
+
+  for (unsigned long i = 0; i < n; ++i)
+    lists[i] = implementations[i].fromSorted(elems, count);
+
+  for (unsigned long k = 0; k < CHECK_CHANGES; ++k)
+  {
+    Element e = rngIndex(rng, CHECK_UNIVERSE);
+    Boolean insert = rngIndex(rng, 2);
+
+    for (unsigned long i = 0; i < n; ++i)
+      lists[i] = insert ? implementations[i].insertElem(e, lists[i])
+                        : implementations[i].removeElem(e, lists[i]);
+
+    ref[e] = insert;
+  }
+
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    const Implementation * im = &implementations[i];
+    unsigned long position = 0;
+
+    for (Element e = 0; e < CHECK_UNIVERSE; ++e)
+    {
+      if (im->isIn(e, lists[i]) != ref[e] || (ref[e] && im->at(lists[i], position++) != e))
+      {
+        fprintf(stderr, "[ERROR] round %lu :: %s differs from the reference at %lu.\n", round, im->name, e);
+        ++mismatches;
+        break;
+      }
+    }
+
+    if (im->length(lists[i]) != position)
+    {
+      fprintf(stderr, "[ERROR] round %lu :: length of %s differs from the reference.\n", round, im->name);
+      ++mismatches;
+    }
+  }
+
+  /* Arena lists are given back as a whole or node by node */
+  if (rngIndex(rng, 2))
+    while (!list_isEmpty(lists[0]))
+      lists[0] = list_removeHead(lists[0]);
+
+  for (unsigned long i = 0; i < n; ++i)
+    lists[i] = implementations[i].removeAllElems(lists[i]);
+
+  if (!((round + 1) % CHECK_ARENA))
+    list_freeArena();
+
+  return mismatches;
+}
+
+/**
+ * Compares both implementations with a plain array of flags on random lists.
+ *
+ * @return Number of mismatches.
+ */
+static unsigned long check(void)
+{
+  Rng rng = rngMake(1);
+  unsigned long res = 0;
+
+  for (unsigned long round = 0; round < CHECK_ROUNDS; ++round)
+    res += checkRound(&rng, round);
+
+  list_freeArena();
+
+  printf("%d rounds of list operations checked, %lu mismatches.\n", CHECK_ROUNDS, res);
+
+  return res;
+}
+
+/**
+ * Runs all kernels for both implementations, or compares them with -c.
+ *
+ * @param[in] config  The config.
+ *
+ * @return NULL.
+ */
+static void * run(void * config)
+{
+  Config c = *(Config *) config;
+  Fixture f;
+  Rng rng = rngMake(c.elements);
+
+  if (c.check)
+  {
+    ((Config *) config)->mismatches = check();
+    return NULL;
+  }
+
+  f.elements = c.elements;
+  f.elems    = malloc(c.elements * sizeof(Element));
+
+  if (!f.elems)
+  {
+    perror("[ERROR] run :: malloc failed.");
+    exit(1);
+  }
+
+  for (unsigned long i = 0; i < c.elements; ++i)
+    f.elems[i] = 2 * i;
+
+  for (unsigned long i = 0; i < PROBE_OPS; ++i)
+    f.probes[i] = 2 * rngIndex(&rng, c.elements) + 1;
+
+  printf("kernel,implementation,elements,repetitions,ops,min_ns,median_ns,median_ns_per_op\n");
+
+  for (unsigned long i = 0; i < sizeof(implementations) / sizeof(implementations[0]); ++i)
+  {
+    const Implementation * im = &implementations[i];
+
+    f.list = im->fromSorted(f.elems, f.elements);
+
+    for (unsigned long k = 0; k < sizeof(kernels) / sizeof(kernels[0]); ++k)
+      benchmark(c, &kernels[k], im, &f);
+
+    f.list = im->removeAllElems(f.list);
+  }
+
+  list_freeArena();
+  free(f.elems);
+
+  return NULL;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "Usage: lists [options]\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -n <number>    Elements of the lists                       (default: %i)\n", DEFAULT_ELEMENTS);
+  fprintf(stream, "    -r <number>    Measured repetitions                        (default: %i)\n", DEFAULT_REPETITIONS);
+  fprintf(stream, "    -w <number>    Warm-up repetitions                         (default: %i)\n", DEFAULT_WARMUP);
+  fprintf(stream, "    -c             Compare the implementations with each other instead\n");
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = { DEFAULT_ELEMENTS, DEFAULT_REPETITIONS, DEFAULT_WARMUP, FALSE, FALSE, 0 };
+
+  for (int i = 1; i < argc && !c.error; ++i)
+  {
+    if (strcmp(argv[i], "-c") == 0)
+      c.check = TRUE;
+
+    else if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-n") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.elements) != 1 || !c.elements;
+
+    else if (strcmp(argv[i], "-r") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.repetitions) != 1 || !c.repetitions;
+
+    else if (strcmp(argv[i], "-w") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.warmup) != 1;
+
+    else
+      c.error = TRUE;
+  }
+
+  return c;
+}
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  Config c = parseArgs(argc, argv);
+
+  if (c.error)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  pthread_t thread;
+  pthread_attr_t attr;
+
+  int error = pthread_attr_init(&attr)
+           || pthread_attr_setstacksize(&attr, STACK_SIZE)
+           || pthread_create(&thread, &attr, run, &c)
+           || pthread_join(thread, NULL)
+           ;
+
+  if (error)
+    fprintf(stderr, "[ERROR] Could not start the benchmark thread.\n");
+
+  pthread_attr_destroy(&attr);
+
+  return error || c.mismatches;
+}
@@ -0,0 +1,318 @@
+/**
+ * @file
+ *
+ * Compares the set library with a plain array of flags, one per possible
+ * element, on random sets: inserting and removing elements, cardinality,
+ * smallest and largest element, membership, union, intersection, difference,
+ * symmetric difference, copies, subsets, equality and partitions.
+ *
+ * Every round builds two random sets, each one either a sorted array, a
+ * bitset for all possible elements or a bitset that is too small and has to
+ * grow, and combines them with one of the operations. The possible elements
+ * span several words of a bitset. Any difference to the reference is a
+ * mismatch. Build with SANITIZE=yes to also catch memory errors and undefined
+ * behaviour.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "rng.h"
+#include "set.h"
+/* -------------------------------------------------------------------------- */
+
+/* A type for the config */
+typedef struct {
+  unsigned long rounds
+              , seed
+              ;
+
+  Boolean error;
+} Config;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_ROUNDS (20000)
+#define DEFAULT_SEED   (    1)
+
+/* Possible elements 0 to UNIVERSE - 1, spanning several words of a bitset */
+#define UNIVERSE (300)
+
+/* Bitsets that are too small for the possible elements and have to grow */
+#define SMALL (37)
+
+/* Most changes made to a random set */
+#define CHANGES (120)
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Reports a mismatch between the set library and the reference.
+ *
+ * @param[in] what   What differs.
+ * @param[in] round  The round.
+ *
+ * @return 1, to be added to the number of mismatches.
+ */
+static unsigned long mismatch(const char * what, unsigned long round)
+{
+  fprintf(stderr, "[ERROR] round %lu :: %s differs from the reference.\n", round, what);
+
+  return 1;
+}
+
+/**
+ * Compares a set with its reference.
+ *
+ * @param[in] s      The set.
+ * @param[in] ref    Flags of the elements the set should contain.
+ * @param[in] what   Name of the set.
+ * @param[in] round  The round.
+ *
+ * @return Number of mismatches.
+ */
+static unsigned long compare(Set s, const char * ref, const char * what, unsigned long round)
+{
+  unsigned long count = 0
+              , first = UNIVERSE
+              , last  = 0
+              ;
+
+  for (unsigned long e = 0; e < UNIVERSE; ++e)
+  {
+    if (set_contains(s, e) != ref[e])
+      return mismatch(what, round);
+
+    if (ref[e])
+    {
+      ++count;
+      first = first < e ? first : e;
+      last  = e;
+    }
+  }
+
+  if (set_cardinality(s) != count || set_is_empty(s) != !count)
+    return mismatch(what, round);
+
+  if (count && (set_get_first(s) != first || set_get_last(s) != last))
+    return mismatch(what, round);
+
+  return 0;
+}
+
+/**
+ * Builds a random set and its reference by inserting and removing random
+ * elements.
+ *
+ * @param[out] s    The set.
+ * @param[out] ref  Flags of the elements in the set.
+ * @param[in]  rng  Random number generator.
+ */
+static void randomSet(Set * s, char * ref, Rng * rng)
+{
+  switch (rngIndex(rng, 3))
+  {
+    case 0:  set_make_empty(s);             break;
+    case 1:  set_make_bounded(s, UNIVERSE); break;
+    default: set_make_bounded(s, SMALL);    break;
+  }
+
+  memset(ref, 0, UNIVERSE);
+
+  for (unsigned long i = rngIndex(rng, CHANGES); i > 0; --i)
+  {
+    Element e = rngIndex(rng, UNIVERSE);
+
+    /* Mostly inserts, so that the sets fill up */
+    if (rngIndex(rng, 4))
+    {
+      set_insert(s, e);
+      ref[e] = 1;
+    }
+    else
+    {
+      set_remove(s, e);
+      ref[e] = 0;
+    }
+  }
+}
+
+/**
+ * Combines two random sets with a random operation and compares everything
+ * with the reference.
+ *
+ * @param[in] rng    Random number generator.
+ * @param[in] round  The round.
+ *
+ * @return Number of mismatches.
+ */
+static unsigned long checkRound(Rng * rng, unsigned long round)
+{
+  Set a, b, res, lower, upper;
+  char refA[UNIVERSE], refB[UNIVERSE], refRes[UNIVERSE], refLower[UNIVERSE], refUpper[UNIVERSE];
+  unsigned long mismatches = 0
+              , operation
+              ;
+
+  randomSet(&a, refA, rng);
+  randomSet(&b, refB, rng);
+
+  mismatches += compare(a, refA, "a", round);
+  mismatches += compare(b, refB, "b", round);
+
+  /* The result is a sorted array or a small bitset */
+  if (rngIndex(rng, 3))
+    set_make_empty(&res);
+  else
+    set_make_bounded(&res, SMALL);
+
+  operation = rngIndex(rng, 5);
+
+  for (unsigned long e = 0; e < UNIVERSE; ++e)
+    switch (operation)
+    {
+      case 0:  refRes[e] = refA[e] | refB[e];  break;
+      case 1:  refRes[e] = refA[e] & refB[e];  break;
+      case 2:  refRes[e] = refA[e] & !refB[e]; break;
+      case 3:  refRes[e] = refA[e] ^ refB[e];  break;
+      default: refRes[e] = refA[e];            break;
+    }
+
+  switch (operation)
+  {
+    case 0:  set_union(&res, a, b);                break;
+    case 1:  set_intersection(&res, a, b);         break;
+    case 2:  set_difference(&res, a, b);           break;
+    case 3:  set_symmetric_difference(&res, a, b); break;
+    default: set_copy(&res, a);                    break;
+  }
+
+  mismatches += compare(res, refRes, "result", round);
+
+  /* Subsets and equality */
+  int subset = 1;
+
+  for (unsigned long e = 0; e < UNIVERSE; ++e)
+    if (refA[e] && !refB[e])
+      subset = 0;
+
+  if (set_is_subset(a, b) != subset)
+    mismatches += mismatch("subset", round);
+
+  if (set_equals(a, res) != !memcmp(refA, refRes, UNIVERSE))
+    mismatches += mismatch("equality", round);
+
+  /* Partition: the smallest elements go into the lower set for as long as
+     their sum is less than that of the remaining ones */
+  unsigned long total = 0
+              , sum   = 0
+              ;
+  Boolean full = FALSE;
+
+  for (unsigned long e = 0; e < UNIVERSE; ++e)
+    if (refA[e])
+      total += e;
+
+  memset(refLower, 0, UNIVERSE);
+  memset(refUpper, 0, UNIVERSE);
+
+  for (unsigned long e = 0; e < UNIVERSE; ++e)
+    if (refA[e])
+    {
+      if (!full && sum < total - sum)
+      {
+        refLower[e] = 1;
+        sum += e;
+      }
+      else
+      {
+        full = TRUE;
+        refUpper[e] = 1;
+      }
+    }
+
+  set_make_empty(&lower);
+  set_make_empty(&upper);
+  set_partition(&lower, &upper, a);
+
+  mismatches += compare(lower, refLower, "lower part of the partition", round);
+  mismatches += compare(upper, refUpper, "upper part of the partition", round);
+
+  set_remove_all_elems(&a);
+  set_remove_all_elems(&b);
+  set_remove_all_elems(&res);
+  set_remove_all_elems(&lower);
+  set_remove_all_elems(&upper);
+
+  return mismatches;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "Usage: sets [options]\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -r <number>    Rounds                                      (default: %i)\n", DEFAULT_ROUNDS);
+  fprintf(stream, "    -s <number>    Seed                                        (default: %i)\n", DEFAULT_SEED);
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = { DEFAULT_ROUNDS, DEFAULT_SEED, FALSE };
+
+  for (int i = 1; i < argc && !c.error; ++i)
+  {
+    if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-r") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.rounds) != 1;
+
+    else if (strcmp(argv[i], "-s") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.seed) != 1;
+
+    else
+      c.error = TRUE;
+  }
+
+  return c;
+}
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  Config c = parseArgs(argc, argv);
+
+  if (c.error)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  Rng rng = rngMake(c.seed);
+  unsigned long mismatches = 0;
+
+  for (unsigned long round = 0; round < c.rounds; ++round)
+    mismatches += checkRound(&rng, round);
+
+  printf("%lu rounds of set operations checked, %lu mismatches.\n", c.rounds, mismatches);
+
+  return mismatches != 0;
+}
@@ -0,0 +1,251 @@
+/**
+ * @file
+ *
+ * A checkpoint consists of the magic and version, the header fields of the
+ * checkpoint, the net and the generator state as 64 bit values, the neurons
+ * in the order of the ring, each as two doubles and a 64 bit hit count, and
+ * the fingerprint once more to detect truncated files. Values are stored in
+ * host byte order.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+/* -------------------------------------------------------------------------- */
+#include "checkpoint.h"
+/* -------------------------------------------------------------------------- */
+
+/* Number of 64 bit values in the header */
+#define CHECKPOINT_HEADER (13)
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Mixes bytes into a FNV-1a hash.
+ *
+ * @param[in] hash   Hash so far.
+ * @param[in] bytes  The bytes.
+ * @param[in] n      Number of bytes.
+ *
+ * @return The new hash.
+ */
+static uint64_t hashBytes(uint64_t hash, const void * bytes, size_t n)
+{
+  const unsigned char * b = bytes;
+
+  for (size_t i = 0; i < n; ++i)
+    hash = (hash ^ b[i]) * 1099511628211ULL;
+
+  return hash;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Calculates a fingerprint of the given samples, which tells whether a
+ * checkpoint belongs to them.
+ *
+ * @param[in] s  The samples.
+ *
+ * @return The fingerprint.
+ */
+extern uint64_t checkpointHash(SampleMap s)
+{
+  uint64_t hash = 14695981039346656037ULL;
+
+  hash = hashBytes(hash, s.samples, s.items * sizeof(Vector));
+
+  if (s.weights)
+    hash = hashBytes(hash, s.weights, s.items * sizeof(unsigned long));
+
+  return hash;
+}
+
+/**
+ * Writes the checkpoint to the given file. The file is replaced atomically, it
+ * either holds the previous or the new checkpoint.
+ *
+ * @param[in] filename  Where to write the checkpoint.
+ * @param[in] c         The checkpoint.
+ *
+ * @return 0 on success.
+ */
+extern int checkpointWrite(char * filename, Checkpoint c)
+{
+  size_t length = strlen(filename) + sizeof(".tmp");
+  char * tmp = malloc(length);
+
+  if (!tmp)
+  {
+    perror("[ERROR] checkpointWrite :: malloc failed.");
+    return 1;
+  }
+
+  snprintf(tmp, length, "%s.tmp", filename);
+
+  FILE * f = fopen(tmp, "wb");
+
+  if (!f)
+  {
+    fprintf(stderr, "[ERROR] Could not open checkpoint file %s.\n", tmp);
+    free(tmp);
+    return 1;
+  }
+
+  uint64_t header[CHECKPOINT_HEADER] =
+    { CHECKPOINT_VERSION
+    , c.iteration
+    , c.maxLearn
+    , c.seed
+    , c.samples
+    , c.hash
+    , c.net.size
+    , c.net.learned
+    , c.net.maxSize
+    , c.rng.s[0]
+    , c.rng.s[1]
+    , c.rng.s[2]
+    , c.rng.s[3]
+    };
+
+  int error = fwrite(CHECKPOINT_MAGIC, 4, 1, f) != 1
+           || fwrite(header, sizeof(header), 1, f) != 1
+           || fwrite(&c.net.error, sizeof(double), 1, f) != 1
+           ;
+
+  Neuron neuron = c.net.neurons;
+
+  for (unsigned long i = 0; !error && i < c.net.size; ++i, neuron = neuron->next)
+  {
+    uint64_t hits = neuron->hits;
+
+    error = fwrite(&neuron->p, sizeof(Vector), 1, f) != 1
+         || fwrite(&hits, sizeof(hits), 1, f) != 1
+         ;
+  }
+
+  error = error
+       || fwrite(&c.hash, sizeof(c.hash), 1, f) != 1
+       || fflush(f)
+       || fsync(fileno(f))
+       ;
+
+  error = fclose(f) || error;
+
+  /* Only a complete checkpoint replaces the previous one */
+  if (error || rename(tmp, filename))
+  {
+    fprintf(stderr, "[ERROR] Could not write checkpoint file %s.\n", filename);
+    remove(tmp);
+    error = 1;
+  }
+
+  free(tmp);
+
+  return error;
+}
+
+/**
+ * Reads a checkpoint from the given file.
+ *
+ * @param[in]  filename  File that holds the checkpoint.
+ * @param[out] c         The checkpoint, whose net must be freed.
+ *
+ * @return 0 on success.
+ */
+extern int checkpointRead(char * filename, Checkpoint * c)
+{
+  FILE * f = fopen(filename, "rb");
+
+  if (!f)
+  {
+    fprintf(stderr, "[ERROR] Could not open checkpoint file %s.\n", filename);
+    return 1;
+  }
+
+  char magic[4];
+  uint64_t header[CHECKPOINT_HEADER]
+         , hash
+         , hits
+         ;
+
+  double error;
+
+  if (fread(magic, 4, 1, f) != 1
+   || memcmp(magic, CHECKPOINT_MAGIC, 4)
+   || fread(header, sizeof(header), 1, f) != 1
+   || header[0] != CHECKPOINT_VERSION
+   || !header[6]
+   || fread(&error, sizeof(error), 1, f) != 1)
+  {
+    fprintf(stderr, "[ERROR] %s is not a checkpoint.\n", filename);
+    fclose(f);
+    return 1;
+  }
+
+  c->iteration = header[1];
+  c->maxLearn  = header[2];
+  c->seed      = header[3];
+  c->samples   = header[4];
+  c->hash      = header[5];
+  c->rng.s[0]  = header[9];
+  c->rng.s[1]  = header[10];
+  c->rng.s[2]  = header[11];
+  c->rng.s[3]  = header[12];
+
+  Vector * positions = malloc(header[6] * sizeof(Vector));
+  unsigned * counts  = malloc(header[6] * sizeof(unsigned));
+
+  if (!positions || !counts)
+  {
+    perror("[ERROR] checkpointRead :: malloc failed.");
+    free(positions);
+    free(counts);
+    fclose(f);
+    return 1;
+  }
+
+  int failed = 0;
+
+  for (unsigned long i = 0; !failed && i < header[6]; ++i)
+  {
+    failed = fread(&positions[i], sizeof(Vector), 1, f) != 1
+          || fread(&hits, sizeof(hits), 1, f) != 1
+          ;
+
+    counts[i] = hits;
+  }
+
+  failed = failed
+        || fread(&hash, sizeof(hash), 1, f) != 1
+        || hash != c->hash
+        ;
+
+  fclose(f);
+
+  if (failed)
+    fprintf(stderr, "[ERROR] Checkpoint %s is truncated.\n", filename);
+  else
+  {
+    /* Rebuild the ring in the same order, starting at the same neuron */
+    c->net         = neuralNetMakeFrom(positions, header[6], header[8]);
+    c->net.learned = header[7];
+    c->net.error   = error;
+
+    Neuron neuron = c->net.neurons;
+
+    failed = !neuron;
+
+    for (unsigned long i = 0; neuron && i < header[6]; ++i, neuron = neuron->next)
+      neuron->hits = counts[i];
+  }
+
+  free(positions);
+  free(counts);
+
+  return failed;
+}
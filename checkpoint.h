@@ -0,0 +1,75 @@
+/**
+ * @file
+ *
+ * Checkpoints hold the complete state of training, so that training can be
+ * resumed where it stopped and continues exactly as it would have.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __CHECKPOINT_H__
+#define __CHECKPOINT_H__
+
+/* -------------------------------------------------------------------------- */
+#include <stdint.h>
+/* -------------------------------------------------------------------------- */
+#include "neuralNet.h"
+#include "sampleMap.h"
+#include "rng.h"
+/* -------------------------------------------------------------------------- */
+
+/* Marks checkpoint files and their version */
+#define CHECKPOINT_MAGIC   "TSPC"
+#define CHECKPOINT_VERSION (1)
+
+/* -------------------------------------------------------------------------- */
+
+/* The state of training */
+typedef struct {
+  /* Iterations done so far, and in total, which defines the schedule */
+  unsigned long iteration
+              , maxLearn
+              , seed
+              ;
+
+  /* Fingerprint of the samples that are trained on */
+  unsigned long samples;
+  uint64_t hash;
+
+  NeuralNet net;
+  Rng rng;
+} Checkpoint;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Calculates a fingerprint of the given samples, which tells whether a
+ * checkpoint belongs to them.
+ *
+ * @param[in] s  The samples.
+ *
+ * @return The fingerprint.
+ */
+extern uint64_t checkpointHash(SampleMap s);
+
+/**
+ * Writes the checkpoint to the given file. The file is replaced atomically, it
+ * either holds the previous or the new checkpoint.
+ *
+ * @param[in] filename  Where to write the checkpoint.
+ * @param[in] c         The checkpoint.
+ *
+ * @return 0 on success.
+ */
+extern int checkpointWrite(char * filename, Checkpoint c);
+
+/**
+ * Reads a checkpoint from the given file.
+ *
+ * @param[in]  filename  File that holds the checkpoint.
+ * @param[out] c         The checkpoint, whose net must be freed.
+ *
+ * @return 0 on success.
+ */
+extern int checkpointRead(char * filename, Checkpoint * c);
+
+#endif
@@ -0,0 +1,285 @@
+/**
+ * @file
+ *
+ * Sends solve requests to tspsomd and prints the answers, one line of JSON
+ * per request. Meant for testing the server and measuring its latency.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "sampleMap.h"
+#include "mapReader.h"
+#include "instrument.h"
+/* -------------------------------------------------------------------------- */
+
+/* A type for the config */
+typedef struct {
+  /* Options of the request, 0 for the defaults of the server */
+  unsigned long maxLearn
+              , seed
+              ;
+
+  /* Number of times the request is sent */
+  unsigned long count;
+
+  Boolean sendCities
+        , noTour
+        , help
+        , error
+        ;
+
+  char * socketPath
+     , * filename
+     ;
+} Config;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_COUNT (1)
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the default config
+ *
+ * @return Default config.
+ */
+static Config getDefaultConfig(void)
+{
+  Config c;
+
+  c.maxLearn   = 0;
+  c.seed       = 0;
+  c.count      = DEFAULT_COUNT;
+  c.sendCities = FALSE;
+  c.noTour     = FALSE;
+  c.help       = FALSE;
+  c.error      = FALSE;
+  c.socketPath = NULL;
+  c.filename   = NULL;
+
+  return c;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "tspsomc, a client for tspsomd.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "Usage: tspsomc <socket> <tsp file> [options]\n");
+  fprintf(stream, "  Required arguments:\n");
+  fprintf(stream, "    socket         Path of the socket tspsomd listens on.\n");
+  fprintf(stream, "    tsp file       File that contains the tsp instance.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -l <number>    Set the number of learning cycles           (default: that of the server)\n");
+  fprintf(stream, "    -s <number>    Seed for the random number generator        (default: that of the server)\n");
+  fprintf(stream, "    -i             Send the cities instead of the file name\n");
+  fprintf(stream, "    -q             Leave the tour out of the answer\n");
+  fprintf(stream, "    -n <number>    Send the request this many times            (default: %i)\n", DEFAULT_COUNT);
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = getDefaultConfig();
+
+  /* First parameters are the socket and the instance */
+  c.socketPath = argv[1];
+  c.filename   = argv[2];
+  int i = 3;
+
+  while (i < argc && !c.error)
+  {
+    if (strcmp(argv[i], "-h") == 0)
+      c.help = TRUE;
+
+    else if (strcmp(argv[i], "-i") == 0)
+      c.sendCities = TRUE;
+
+    else if (strcmp(argv[i], "-q") == 0)
+      c.noTour = TRUE;
+
+    else if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-l") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.maxLearn) != 1 || !c.maxLearn;
+
+    else if (strcmp(argv[i], "-s") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.seed) != 1;
+
+    else if (strcmp(argv[i], "-n") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.count) != 1 || !c.count;
+
+    else
+      c.error = TRUE;
+
+    ++i;
+  }
+
+  if (c.error)
+    fprintf(stderr, "[ERROR] Invalid argument %s.\n", argv[i - 1]);
+
+  return c;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Connects to the socket at the given path.
+ *
+ * @param[in] path  Path of the socket.
+ *
+ * @return The connection, -1 in case of an error.
+ */
+static int connectTo(char * path)
+{
+  struct sockaddr_un address;
+
+  if (strlen(path) >= sizeof(address.sun_path))
+  {
+    fprintf(stderr, "[ERROR] Socket path %s is too long.\n", path);
+    return -1;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+
+  int connection = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (connection < 0 || connect(connection, (struct sockaddr *) &address, sizeof(address)))
+  {
+    perror("[ERROR] connectTo :: Could not connect");
+
+    if (connection >= 0)
+      close(connection);
+
+    return -1;
+  }
+
+  return connection;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  Config c = parseArgs(argc, argv);
+
+  if (c.help || c.error)
+  {
+    help(stderr);
+    return c.error;
+  }
+
+  /* The server resolves file names relative to its own working directory */
+  char path[PATH_MAX] = "";
+  SampleMap cities = { 0, 0, NULL, NULL };
+
+  if (c.sendCities)
+    cities = mapReaderRead(c.filename);
+  else if (!realpath(c.filename, path))
+    perror("[ERROR] main :: realpath failed");
+
+  if (c.sendCities ? !cities.samples : !path[0])
+    return 1;
+
+  int connection = connectTo(c.socketPath);
+
+  if (connection < 0)
+    return 1;
+
+  FILE * out = fdopen(connection, "w")
+     , * in  = fdopen(dup(connection), "r")
+     ;
+
+  char * answer = NULL;
+  size_t length = 0;
+  int error = !in || !out;
+
+  uint64_t total = 0
+         , start
+         ;
+
+  for (unsigned long request = 0; !error && request < c.count; ++request)
+  {
+    start = instrumentNow();
+
+    if (c.maxLearn)
+      fprintf(out, "iterations %lu\n", c.maxLearn);
+
+    if (c.seed)
+      fprintf(out, "seed %lu\n", c.seed);
+
+    if (c.noTour)
+      fprintf(out, "tour 0\n");
+
+    if (c.sendCities)
+    {
+      fprintf(out, "cities %lu\n", cities.items);
+      for (unsigned long i = 0; i < cities.items; ++i)
+        fprintf(out, "%.17g %.17g\n", cities.samples[i].x, cities.samples[i].y);
+    }
+    else
+      fprintf(out, "file %s\n", path);
+
+    error = fflush(out) || getline(&answer, &length, in) < 0;
+
+    if (!error)
+    {
+      total += instrumentNow() - start;
+      fputs(answer, stdout);
+      error = strstr(answer, "\"error\"") != NULL;
+    }
+    else
+      fprintf(stderr, "[ERROR] The server closed the connection.\n");
+  }
+
+  #ifdef INFO
+  if (!error)
+    fprintf(stderr, "[INFO ] Mean latency of %lu requests: %.3lf ms.\n", c.count, total / 1e6 / c.count);
+  #endif
+
+  /* Clean up... */
+  free(answer);
+
+  if (out)
+    fclose(out);
+
+  if (in)
+    fclose(in);
+
+  cities = sampleMapFree(cities);
+
+  return error;
+}
@@ -7,61 +7,294 @@
 /* -------------------------------------------------------------------------- */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
-#include <cairo.h>
 #include <math.h>
 /* -------------------------------------------------------------------------- */
 #include "drawer.h"
+#include "renderer.h"
+#include "instrument.h"
 /* -------------------------------------------------------------------------- */
 #define WIDTH  (1024)
 #define HEIGHT ( 768)
 #define RADIUS (0.005 * (WIDTH < HEIGHT ? WIDTH : HEIGHT))
+
+/* Number of dots that are filled at once */
+#define DRAWER_BATCH (4096)
+
+/* Segments of the ring shorter than this many pixels are merged into the next */
+#define DRAWER_LOD (1.0)
+
+/* Bytes of a bitmap with one bit per pixel */
+#define DRAWER_BITMAP ((WIDTH * HEIGHT + 7) / 8)
+/* -------------------------------------------------------------------------- */
+
+/* Pixels that have a dot, one bitmap per thread that renders */
+static __thread unsigned char drawerOccupied[DRAWER_BITMAP];
 /* -------------------------------------------------------------------------- */
 
-/* Scaling factor for projection in picture space */
-Vector scale;
+/**
+ * Projects positions from object space into picture space.
+ *
+ * @param[in]  drawer     The drawer.
+ * @param[in]  positions  Positions in object space.
+ * @param[in]  n          Number of positions.
+ * @param[out] projected  Space for n positions in picture space.
+ */
+static void drawerProject(Drawer drawer, Vector * positions, unsigned long n, Vector * projected)
+{
+  vectorProject( positions, n, drawer.bounds.topleft
+               , vectorMake(drawer.scale.x, -drawer.scale.y)
+               , vectorMake(2 * RADIUS, HEIGHT - 2 * RADIUS)
+               , projected
+               );
+}
+
+/**
+ * Tells on which sides of the picture a position lies, one bit per side.
+ *
+ * @param[in] p  Position in picture space.
+ *
+ * @return 0 for positions within the picture.
+ */
+static unsigned drawerOutside(Vector p)
+{
+  return (p.x < 0) | (p.x > WIDTH) << 1 | (p.y < 0) << 2 | (p.y > HEIGHT) << 3;
+}
+
+/**
+ * Adds circles around the given positions to the current path of cr, so that
+ * they are filled at once.
+ *
+ * @param[in] cr         Cairo context.
+ * @param[in] positions  Positions in picture space.
+ * @param[in] n          Number of positions.
+ */
+static void drawerAddDots(cairo_t * cr, Vector * positions, unsigned long n)
+{
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    cairo_new_sub_path(cr);
+    cairo_arc(cr, positions[i].x, positions[i].y, RADIUS, 0, 2 * M_PI);
+  }
+}
+
+/**
+ * Fills dots around the given positions, at most one per pixel. Dots whose
+ * pixel already has one would cover nearly the same pixels and dots whose
+ * centre lies outside of the picture are left out, so that the cost is bound
+ * by the size of the picture rather than the number of positions. The
+ * positions are projected into picture space one batch at a time.
+ *
+ * @param[in]     cr         Cairo context.
+ * @param[in]     drawer     The drawer.
+ * @param[in]     positions  Positions in object space.
+ * @param[in]     n          Number of positions.
+ * @param[in,out] occupied   Bitmap of the pixels that have a dot.
+ */
+static void drawerFillDots(cairo_t * cr, Drawer drawer, Vector * positions, unsigned long n, unsigned char * occupied)
+{
+  Vector projected[DRAWER_BATCH]
+       , batch[DRAWER_BATCH]
+       ;
+  unsigned long queued = 0;
+
+  for (unsigned long start = 0; start < n; start += DRAWER_BATCH)
+  {
+    unsigned long count = n - start < DRAWER_BATCH ? n - start : DRAWER_BATCH;
+
+    drawerProject(drawer, positions + start, count, projected);
+
+    for (unsigned long i = 0; i < count; ++i)
+    {
+      Vector p = projected[i];
+
+      if (!(p.x >= 0 && p.x < WIDTH && p.y >= 0 && p.y < HEIGHT))
+        continue;
+
+      unsigned long pixel = (unsigned long) p.y * WIDTH + (unsigned long) p.x;
+
+      if (occupied[pixel / 8] & 1 << pixel % 8)
+        continue;
+
+      occupied[pixel / 8] |= 1 << pixel % 8;
+      batch[queued++] = p;
+
+      if (queued == DRAWER_BATCH)
+      {
+        drawerAddDots(cr, batch, queued);
+        cairo_fill(cr);
+        queued = 0;
+      }
+    }
+  }
+
+  if (queued)
+  {
+    drawerAddDots(cr, batch, queued);
+    cairo_fill(cr);
+  }
+}
+
+/**
+ * Continues the ring in the current path of cr to the given position. The
+ * segment is left out if it lies on the same side outside the picture as the
+ * last position.
+ *
+ * @param[in]     cr       Cairo context.
+ * @param[in]     p        Position in picture space.
+ * @param[in,out] last     The last position of the ring.
+ * @param[in,out] outside  Sides of the picture the last position lies on.
+ */
+static void drawerRingTo(cairo_t * cr, Vector p, Vector * last, unsigned * outside)
+{
+  unsigned side = drawerOutside(p);
+
+  if (side & *outside)
+    cairo_move_to(cr, p.x, p.y);
+  else
+    cairo_line_to(cr, p.x, p.y);
+
+  *last    = p;
+  *outside = side;
+}
+
+/**
+ * Strokes the ring through the given positions, projecting them into picture
+ * space one batch at a time. Positions closer than a pixel to the last drawn
+ * one are passed over, the ring is closed with the segment back to the first.
+ *
+ * @param[in] cr         Cairo context.
+ * @param[in] drawer     The drawer.
+ * @param[in] positions  Positions in object space, in the order of the ring.
+ * @param[in] n          Number of positions, at least one.
+ */
+static void drawerStrokeRing(cairo_t * cr, Drawer drawer, Vector * positions, unsigned long n)
+{
+  Vector projected[DRAWER_BATCH]
+       , first
+       , last
+       ;
+  unsigned outside;
+
+  drawerProject(drawer, positions, 1, &first);
+
+  last    = first;
+  outside = drawerOutside(first);
+
+  cairo_move_to(cr, first.x, first.y);
+
+  for (unsigned long start = 1; start < n; start += DRAWER_BATCH)
+  {
+    unsigned long count = n - start < DRAWER_BATCH ? n - start : DRAWER_BATCH;
+
+    drawerProject(drawer, positions + start, count, projected);
 
-/* Memory for projected sample positions in picture space */
-Vector * samplePos = NULL;
+    for (unsigned long i = 0; i < count; ++i)
+    {
+      Vector p = projected[i];
+
+      if (fabs(p.x - last.x) < DRAWER_LOD && fabs(p.y - last.y) < DRAWER_LOD)
+        continue;
+
+      drawerRingTo(cr, p, &last, &outside);
+    }
+  }
+
+  drawerRingTo(cr, first, &last, &outside);
+
+  cairo_stroke(cr);
+}
 
 /* -------------------------------------------------------------------------- */
 
 /**
  * Prepares the data for rendering.
- * The samples are projected into picture space exactly once, since their
- * will remain fixed.
+ * The samples are rendered onto the background exactly once, since their
+ * positions will remain fixed.
  *
  * @param[in] sampleMap  Samples in object space.
  * @param[in] bounds     Bounding box around the samples in object space.
+ *
+ * @return Drawer for the samples, without background in case of an error.
  */
-extern void drawerPrepareData(SampleMap sampleMap, PositionBounds bounds)
+extern Drawer drawerMake(SampleMap sampleMap, PositionBounds bounds)
 {
-  /* Scaling factors for projection in picture space */
-  scale = vectorMake( (WIDTH  - 4 * RADIUS) / (bounds.bottomright.x - bounds.topleft.x)
-                    , (HEIGHT - 4 * RADIUS) / (bounds.bottomright.y - bounds.topleft.y));
+  Drawer drawer;
 
-  /* Allocate memory for projected samples in picture space */
-  samplePos = malloc(sampleMap.items * sizeof(Vector));
+  drawer.bounds = bounds;
+
+  /* Scaling factors for projection in picture space */
+  drawer.scale = vectorMake( (WIDTH  - 4 * RADIUS) / (bounds.bottomright.x - bounds.topleft.x)
+                           , (HEIGHT - 4 * RADIUS) / (bounds.bottomright.y - bounds.topleft.y));
 
-  if (!samplePos)
-    perror("[ERROR] drawerPrepareData :: malloc failed.");
+  /* Create the background */
+  drawer.samples = cairo_image_surface_create(CAIRO_FORMAT_RGB24, WIDTH, HEIGHT);
 
-  /* Project the samples into picture space */
-  for (unsigned sample = 0; sample < sampleMap.items; ++sample)
+  if (cairo_surface_status(drawer.samples) != CAIRO_STATUS_SUCCESS)
   {
-    samplePos[sample].x = scale.x * (sampleMap.samples[sample].x - bounds.topleft.x) + 2 * RADIUS;
-    samplePos[sample].y = HEIGHT - scale.y * (sampleMap.samples[sample].y - bounds.topleft.y) - 2 * RADIUS;
+    fprintf(stderr, "[ERROR] drawerMake :: Could not create background.\n");
+    cairo_surface_destroy(drawer.samples);
+    drawer.samples = NULL;
+    return drawer;
   }
+
+  memset(drawerOccupied, 0, DRAWER_BITMAP);
+
+  cairo_t * cr = cairo_create(drawer.samples);
+
+  cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+  cairo_paint(cr);
+
+  /* Render samples, i.e. the cities */
+  cairo_set_source_rgb(cr, 1.0, 0.0, 0.0);
+  drawerFillDots(cr, drawer, sampleMap.samples, sampleMap.items, drawerOccupied);
+
+  cairo_destroy(cr);
+
+  /* Render threads only read the background from now on */
+  cairo_surface_flush(drawer.samples);
+
+  return drawer;
+}
+
+/**
+ * Calculates the number of bytes the drawer occupies while rendering the given
+ * number of neurons. The samples are part of the background, which has a
+ * fixed size. Every thread that renders has a picture and a bitmap of its own,
+ * and the renderer keeps RENDERER_DEPTH snapshots of the neurons per thread.
+ * The thread that draws the background has a bitmap, too.
+ *
+ * @param[in] neurons  Number of neurons.
+ * @param[in] threads  Number of render threads, 0 for rendering while training.
+ *
+ * @return Memory footprint in bytes.
+ */
+extern unsigned long drawerFootprint(unsigned long neurons, unsigned threads)
+{
+  unsigned long pictures  = threads ? threads : 1
+              , snapshots = threads ? RENDERER_DEPTH * threads : 1
+              ;
+
+  return (1 + pictures) * 4UL * WIDTH * HEIGHT
+       + (threads + 1) * DRAWER_BITMAP
+       + snapshots * neurons * sizeof(Vector);
 }
 
 /**
  * Frees the allocated memory.
+ *
+ * @param[in] drawer  The drawer.
+ *
+ * @return Drawer without data.
  */
-extern void drawerCleanUp()
+extern Drawer drawerFree(Drawer drawer)
 {
-  if (samplePos)
-    free(samplePos);
-  samplePos = NULL;
+  if (drawer.samples)
+    cairo_surface_destroy(drawer.samples);
+  drawer.samples = NULL;
+
+  return drawer;
 }
 
 /**
@@ -69,89 +302,97 @@ extern void drawerCleanUp()
  * picture under filename. For that, the neurons are projected into from object
  * space into picture space with linear interpolation.
  *
+ * @param[in] drawer     Drawer for the samples.
  * @param[in] neuralNet  Neural net.
  * @param[in] sampleMap  Map that contains the samples.
- * @param[in] bounds     Bounding box around the samples.
  * @param[in] filename   Output filename.
  */
-extern void drawerDrawMap(NeuralNet neuralNet, SampleMap sampleMap, PositionBounds bounds, char * filename)
+extern void drawerDrawMap(Drawer drawer, NeuralNet neuralNet, SampleMap sampleMap, char * filename)
 {
-  assert(samplePos);
+  Vector * neurons = malloc(neuralNet.size * sizeof(Vector));
+
+  if (!neurons)
+  {
+    perror("[ERROR] drawerDrawMap :: malloc failed.");
+    return;
+  }
 
   #ifdef DEBUG
   fprintf(stderr, "[DEBUG] Rendering %s\n", filename);
   #endif
 
-  /* Memory for projected neuron positions */
-  Vector * neuronPos = malloc(neuralNet.size  * sizeof(Vector));
-
-  if (!neuronPos)
-    perror("[ERROR] drawerDrawMap :: malloc failed.");
-
-  /* Create image region and surface */
-  cairo_surface_t * surface = cairo_image_surface_create(CAIRO_FORMAT_ARGB32, WIDTH, HEIGHT);
-  cairo_t * cr = cairo_create(surface);
+  neuralNetPositions(neuralNet, neurons);
+  cairo_surface_t * surface = drawerDrawNeurons(drawer, neurons, neuralNet.size, NULL);
 
-  /* Render background */
-  cairo_rectangle(cr, 0, 0, WIDTH, HEIGHT);
-	cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
-	cairo_fill(cr);
+  free(neurons);
 
-  /* Project the neurons into picture space  */
-  Neuron neuron = neuralNet.neurons;
-  for (unsigned long i = 0; i < neuralNet.size; ++i)
+  if (surface)
   {
-    neuronPos[i].x = scale.x * (neuron->p.x - bounds.topleft.x) + 2 * RADIUS;
-    neuronPos[i].y = HEIGHT - scale.y * (neuron->p.y - bounds.topleft.y) - 2 * RADIUS;
+    instrumentBegin(encode);
+    cairo_surface_write_to_png(surface, filename);
+    instrumentEnd(PHASE_ENCODE, encode);
 
-    neuron = neuron->next;
+    cairo_surface_destroy(surface);
   }
+}
 
-  /* Render samples, i.e. the cities */
-  cairo_set_source_rgb(cr, 1.0, 0.0, 0.0);
-  for (unsigned sample = 0; sample < sampleMap.items; ++sample)
+/**
+ * Render the samples and the given neurons as a picture. The drawer is only
+ * read, so that several threads may render with it at once, each onto a
+ * picture of its own that it may reuse for one frame after the other.
+ *
+ * @param[in] drawer   Drawer for the samples.
+ * @param[in] neurons  Neuron positions in object space, in the order of the ring.
+ * @param[in] size     Number of neurons.
+ * @param[in] surface  Picture from a previous call to render onto, NULL for a
+ *                     new one. It is left as it is in case of an error.
+ *
+ * @return The picture, to be destroyed by the caller, NULL in case of an error.
+ */
+extern cairo_surface_t * drawerDrawNeurons(Drawer drawer, Vector * neurons, unsigned long size, cairo_surface_t * surface)
+{
+  assert(drawer.samples);
+
+  instrumentBegin(render);
+
+  memset(drawerOccupied, 0, DRAWER_BITMAP);
+
+  /* Create image region and surface, starting with the samples */
+  if (!surface)
   {
-    cairo_save(cr);
+    surface = cairo_image_surface_create(CAIRO_FORMAT_RGB24, WIDTH, HEIGHT);
+
+    if (cairo_surface_status(surface) != CAIRO_STATUS_SUCCESS)
     {
-      cairo_translate(cr, samplePos[sample].x, samplePos[sample].y);
-      cairo_scale(cr, RADIUS, RADIUS);
-      cairo_arc(cr, 0, 0, 1, 0, 2 * M_PI);
-      cairo_fill(cr);
+      fprintf(stderr, "[ERROR] drawerDrawNeurons :: Could not create picture.\n");
+      cairo_surface_destroy(surface);
+      return NULL;
     }
-    cairo_restore(cr);
   }
 
-  /* Render connections between neurons, i.e. the "topology" of the self organising map */
+  cairo_t * cr = cairo_create(surface);
+
+  cairo_set_source_surface(cr, drawer.samples, 0, 0);
+  cairo_paint(cr);
+
+  /* Render connections between neurons, i.e. the "topology" of the self
+     organising map. Neurons closer than a pixel to the last drawn one are
+     passed over and segments that lie on the same side outside the picture
+     are not drawn, the ring is closed with the segment back to the first. */
   cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
   cairo_set_line_width(cr, 0.5);
-  for (unsigned neuron = 0; neuron < neuralNet.size; ++neuron)
-  {
-    cairo_move_to(cr, neuronPos[neuron].x, neuronPos[neuron].y);
-    cairo_line_to(cr, neuronPos[(neuron + 1) % neuralNet.size].x, neuronPos[(neuron + 1) % neuralNet.size].y);
-  }
 
-  cairo_stroke(cr);
+  if (size)
+    drawerStrokeRing(cr, drawer, neurons, size);
 
   /* Render the neurons */
   cairo_set_source_rgb(cr, 0.0, 1.0, 0.0);
-  for (unsigned neuron = 0; neuron < neuralNet.size; ++neuron)
-  {
-    cairo_save(cr);
-    {
-      cairo_translate(cr, neuronPos[neuron].x, neuronPos[neuron].y);
-      cairo_scale(cr, RADIUS, RADIUS);
-      cairo_arc(cr, 0, 0, 1, 0, 2 * M_PI);
-      cairo_fill(cr);
-    }
-    cairo_restore(cr);
-  }
+  drawerFillDots(cr, drawer, neurons, size, drawerOccupied);
 
-  /* Clean up and free memory */
+  /* Clean up */
   cairo_destroy(cr);
-  cairo_surface_write_to_png(surface, filename);
-  cairo_surface_destroy(surface);
 
-  if (neuronPos)
-    free(neuronPos);
-  neuronPos = NULL;
+  instrumentEnd(PHASE_RENDER, render);
+
+  return surface;
 }
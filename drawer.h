@@ -8,36 +8,86 @@
 
 /* -------------------------------------------------------------------------- */
 #include <stdio.h>
+#include <cairo.h>
 /* -------------------------------------------------------------------------- */
 #include "neuralNet.h"
 #include "sampleMap.h"
 /* -------------------------------------------------------------------------- */
 
+/* What is needed to render the samples of one instance */
+typedef struct {
+  /* Bounding box around the samples in object space */
+  PositionBounds bounds;
+
+  /* Scaling factor for projection in picture space */
+  Vector scale;
+
+  /* Background with the samples, which every picture starts from */
+  cairo_surface_t * samples;
+} Drawer;
+
+/* -------------------------------------------------------------------------- */
+
 /**
  * Prepares the data for rendering.
- * The samples are projected into picture space exactly once, since their
- * will remain fixed.
+ * The samples are rendered onto the background exactly once, since their
+ * positions will remain fixed.
  *
  * @param[in] sampleMap  Samples in object space.
  * @param[in] bounds     Bounding box around the samples in object space.
+ *
+ * @return Drawer for the samples, without background in case of an error.
+ */
+extern Drawer drawerMake(SampleMap sampleMap, PositionBounds bounds);
+
+/**
+ * Calculates the number of bytes the drawer occupies while rendering the given
+ * number of neurons. The samples are part of the background, which has a
+ * fixed size. Every thread that renders has a picture and a bitmap of its own,
+ * and the renderer keeps RENDERER_DEPTH snapshots of the neurons per thread.
+ * The thread that draws the background has a bitmap, too.
+ *
+ * @param[in] neurons  Number of neurons.
+ * @param[in] threads  Number of render threads, 0 for rendering while training.
+ *
+ * @return Memory footprint in bytes.
  */
-extern void drawerPrepareData(SampleMap sampleMap, PositionBounds bounds);
+extern unsigned long drawerFootprint(unsigned long neurons, unsigned threads);
 
 /**
  * Frees the allocated memory.
+ *
+ * @param[in] drawer  The drawer.
+ *
+ * @return Drawer without data.
  */
-extern void drawerCleanUp();
+extern Drawer drawerFree(Drawer drawer);
 
 /**
  * Render the samples from sampleMap and the neurons of the neural net as a
  * picture under filename. For that, the neurons are projected into from object
  * space into picture space with linear interpolation.
  *
+ * @param[in] drawer     Drawer for the samples.
  * @param[in] neuralNet  Neural net.
  * @param[in] sampleMap  Map that contains the samples.
- * @param[in] bounds     Bounding box around the samples.
  * @param[in] filename   Output filename.
  */
-extern void drawerDrawMap(NeuralNet nn, SampleMap s, PositionBounds bounds, char * filename);
+extern void drawerDrawMap(Drawer drawer, NeuralNet nn, SampleMap s, char * filename);
+
+/**
+ * Render the samples and the given neurons as a picture. The drawer is only
+ * read, so that several threads may render with it at once, each onto a
+ * picture of its own that it may reuse for one frame after the other.
+ *
+ * @param[in] drawer   Drawer for the samples.
+ * @param[in] neurons  Neuron positions in object space, in the order of the ring.
+ * @param[in] size     Number of neurons.
+ * @param[in] surface  Picture from a previous call to render onto, NULL for a
+ *                     new one. It is left as it is in case of an error.
+ *
+ * @return The picture, to be destroyed by the caller, NULL in case of an error.
+ */
+extern cairo_surface_t * drawerDrawNeurons(Drawer drawer, Vector * neurons, unsigned long size, cairo_surface_t * surface);
 
 #endif
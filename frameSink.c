@@ -0,0 +1,558 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <zlib.h>
+/* -------------------------------------------------------------------------- */
+#include "frameSink.h"
+#include "instrument.h"
+/* -------------------------------------------------------------------------- */
+
+/* Length of the file names of PNG frames */
+#define FRAME_SINK_PNG_LENGTH (sizeof(FRAME_SINK_PNG_FORMAT) + 3 * sizeof(unsigned long))
+
+/* Bytes of the IDAT chunks of PNG files that are written as a stream */
+#define PNG_STREAM_CHUNK (1 << 16)
+
+/* -------------------------------------------------------------------------- */
+
+/* The kinds of sinks */
+typedef enum { SINK_PNG, SINK_FASTPNG, SINK_PPM, SINK_RAW, SINK_CONTAINER } FrameSinkFormat;
+
+struct FrameSinkData {
+  FrameSinkFormat format;
+
+  /* The stream, NULL for PNG files */
+  FILE * file;
+
+  /* Pixels of one frame in the format of the stream */
+  unsigned char * pixels;
+
+  /* Frames numbered so far, the next frame to write to the stream and the
+     frames written to it */
+  unsigned long numbered
+              , next
+              , written
+              ;
+
+  int error;
+
+  pthread_mutex_t lock;
+  pthread_cond_t turn;
+};
+
+struct PngStreamData {
+  FILE * file;
+
+  uint32_t width
+         , height
+         , rows
+         ;
+
+  /* One filtered row, and the compressed data of the next IDAT chunk */
+  unsigned char * row
+              , * packed
+              ;
+
+  z_stream zip;
+
+  int error;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Converts a row of pixels to RGB or RGBA.
+ *
+ * @param[in]  row      The row, RGB24 or ARGB32.
+ * @param[in]  width    Number of pixels.
+ * @param[out] pixels   Space for width * channels bytes.
+ * @param[in]  channels 3 for RGB, 4 for RGBA.
+ *
+ * @return Position after the converted row.
+ */
+static unsigned char * convertRow(const uint32_t * row, unsigned long width, unsigned char * pixels, int channels)
+{
+  for (unsigned long x = 0; x < width; ++x)
+  {
+    *pixels++ = row[x] >> 16;
+    *pixels++ = row[x] >>  8;
+    *pixels++ = row[x];
+
+    if (channels == 4)
+      *pixels++ = 0xff;
+  }
+
+  return pixels;
+}
+
+/**
+ * Converts the pixels of a surface to RGB or RGBA, row by row from the top.
+ *
+ * @param[in]  surface  The surface, RGB24 or ARGB32.
+ * @param[out] pixels   Space for width * height * channels bytes.
+ * @param[in]  channels 3 for RGB, 4 for RGBA.
+ */
+static void convertPixels(cairo_surface_t * surface, unsigned char * pixels, int channels)
+{
+  cairo_surface_flush(surface);
+
+  unsigned char * data = cairo_image_surface_get_data(surface);
+  int width  = cairo_image_surface_get_width(surface)
+    , height = cairo_image_surface_get_height(surface)
+    , stride = cairo_image_surface_get_stride(surface)
+    ;
+
+  for (int y = 0; y < height; ++y)
+    pixels = convertRow((const uint32_t *) (data + (size_t) y * stride), width, pixels, channels);
+}
+
+/**
+ * Writes a chunk of a PNG file.
+ *
+ * @param[in] f       The file.
+ * @param[in] type    Type of the chunk, four characters.
+ * @param[in] data    Data of the chunk.
+ * @param[in] length  Length of the data.
+ *
+ * @return 0 on success.
+ */
+static int pngChunk(FILE * f, const char * type, const unsigned char * data, uint32_t length)
+{
+  unsigned char header[8] = { length >> 24, length >> 16, length >> 8, length
+                            , type[0], type[1], type[2], type[3] };
+
+  uLong crc = crc32(crc32(0, NULL, 0), header + 4, 4);
+
+  /* No data would reset the crc */
+  if (length)
+    crc = crc32(crc, data, length);
+
+  unsigned char trailer[4] = { crc >> 24, crc >> 16, crc >> 8, crc };
+
+  return fwrite(header, sizeof(header), 1, f) != 1
+      || (length && fwrite(data, length, 1, f) != 1)
+      || fwrite(trailer, sizeof(trailer), 1, f) != 1;
+}
+
+/**
+ * Compresses the input of the stream of a PNG file and writes what comes out
+ * as IDAT chunks, each as large as the buffer.
+ *
+ * @param[in] png    The PNG file.
+ * @param[in] flush  Z_NO_FLUSH while there are rows to come, Z_FINISH after.
+ *
+ * @return 0 on success.
+ */
+static int pngDeflate(PngStream png, int flush)
+{
+  for (;;)
+  {
+    int status = deflate(&png->zip, flush);
+
+    if (status == Z_STREAM_ERROR)
+      return 1;
+
+    /* The buffer is written once it is full and at the end */
+    uint32_t packed = PNG_STREAM_CHUNK - png->zip.avail_out;
+
+    if (!png->zip.avail_out || status == Z_STREAM_END)
+    {
+      if (packed && pngChunk(png->file, "IDAT", png->packed, packed))
+        return 1;
+
+      png->zip.next_out  = png->packed;
+      png->zip.avail_out = PNG_STREAM_CHUNK;
+    }
+
+    if (status == Z_STREAM_END || (flush != Z_FINISH && !png->zip.avail_in && png->zip.avail_out))
+      return 0;
+  }
+}
+
+/**
+ * Writes a surface as RGB PNG.
+ *
+ * @param[in] surface   The surface.
+ * @param[in] filename  Output filename.
+ *
+ * @return 0 on success.
+ */
+static int pngWrite(cairo_surface_t * surface, char * filename)
+{
+  PngStream png = pngStreamOpen( filename
+                               , cairo_image_surface_get_width(surface)
+                               , cairo_image_surface_get_height(surface));
+
+  if (!png)
+    return 1;
+
+  cairo_surface_flush(surface);
+
+  int error = pngStreamRows( png
+                           , cairo_image_surface_get_data(surface)
+                           , cairo_image_surface_get_stride(surface)
+                           , cairo_image_surface_get_height(surface));
+
+  png = pngStreamClose(png);
+
+  return error;
+}
+
+/**
+ * Appends a frame to the stream of a sink.
+ *
+ * @param[in] sink       The sink.
+ * @param[in] surface    The frame.
+ * @param[in] iteration  Iteration the frame shows.
+ *
+ * @return 0 on success.
+ */
+static int streamWrite(FrameSink sink, cairo_surface_t * surface, unsigned long iteration)
+{
+  uint64_t width    = cairo_image_surface_get_width(surface)
+         , height   = cairo_image_surface_get_height(surface)
+         , channels = sink->format == SINK_RAW ? 4 : 3
+         , length   = width * height * channels
+         ;
+
+  /* Every frame has the same size, which is known with the first one */
+  if (!sink->pixels && !(sink->pixels = malloc(length)))
+  {
+    perror("[ERROR] streamWrite :: malloc failed.");
+    return 1;
+  }
+
+  convertPixels(surface, sink->pixels, channels);
+
+  int error = 0;
+
+  if (sink->format == SINK_PPM)
+    error = fprintf(sink->file, "P6\n%lu %lu\n255\n", (unsigned long) width, (unsigned long) height) < 0;
+
+  else if (sink->format == SINK_CONTAINER)
+  {
+    uint64_t header[4] = { FRAME_SINK_VERSION, width, height, channels }
+           , frame     = iteration
+           ;
+
+    if (!sink->written)
+      error = fwrite(FRAME_SINK_MAGIC, 4, 1, sink->file) != 1
+           || fwrite(header, sizeof(header), 1, sink->file) != 1;
+
+    error = error || fwrite(&frame, sizeof(frame), 1, sink->file) != 1;
+  }
+
+  error = error || fwrite(sink->pixels, length, 1, sink->file) != 1;
+
+  if (!error)
+    ++sink->written;
+
+  return error;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens a sink as given by spec: png or fastpng for one file per frame, or
+ * ppm, raw or tspf, optionally followed by a colon and a target, which is a
+ * file, - for stdout (the default) or fd:<n> for an open file descriptor.
+ *
+ * @param[in] spec  The sink.
+ *
+ * @return The sink, NULL in case of an error.
+ */
+extern FrameSink frameSinkOpen(char * spec)
+{
+  static const char * formats[] = { "png", "fastpng", "ppm", "raw", "tspf" };
+
+  size_t length = strcspn(spec, ":");
+  char * target = spec[length] ? spec + length + 1 : "-";
+  int fd;
+
+  FrameSink sink = calloc(1, sizeof(*sink));
+
+  if (!sink)
+  {
+    perror("[ERROR] frameSinkOpen :: calloc failed.");
+    return NULL;
+  }
+
+  for (sink->format = SINK_PNG; sink->format <= SINK_CONTAINER; ++sink->format)
+    if (strlen(formats[sink->format]) == length && !strncmp(spec, formats[sink->format], length))
+      break;
+
+  if (sink->format > SINK_CONTAINER || (sink->format <= SINK_FASTPNG && spec[length]))
+  {
+    fprintf(stderr, "[ERROR] Unknown frame format %s.\n", spec);
+    free(sink);
+    return NULL;
+  }
+
+  if (sink->format > SINK_FASTPNG)
+  {
+    if (strcmp(target, "-") == 0)
+      sink->file = stdout;
+    else if (sscanf(target, "fd:%d", &fd) == 1)
+      sink->file = fdopen(fd, "w");
+    else
+      sink->file = fopen(target, "wb");
+
+    if (!sink->file)
+    {
+      fprintf(stderr, "[ERROR] Could not open frame target %s.\n", target);
+      free(sink);
+      return NULL;
+    }
+  }
+
+  pthread_mutex_init(&sink->lock, NULL);
+  pthread_cond_init(&sink->turn, NULL);
+
+  return sink;
+}
+
+/**
+ * Numbers the next frame. Frames must be numbered in the order they are to be
+ * written and every number must be written, if only without a frame.
+ *
+ * @param[in] sink  The sink.
+ *
+ * @return Number of the frame.
+ */
+extern unsigned long frameSinkNext(FrameSink sink)
+{
+  return __atomic_fetch_add(&sink->numbered, 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Writes a frame, after all frames with lower numbers for streams. Safe to
+ * call from several threads.
+ *
+ * @param[in] sink       The sink.
+ * @param[in] surface    The frame, NULL to skip its number.
+ * @param[in] frame      Number of the frame.
+ * @param[in] iteration  Iteration the frame shows.
+ *
+ * @return 0 on success.
+ */
+extern int frameSinkWrite(FrameSink sink, cairo_surface_t * surface, unsigned long frame, unsigned long iteration)
+{
+  char filename[FRAME_SINK_PNG_LENGTH];
+  int error = 0;
+
+  instrumentBegin(encode);
+
+  /* Files are independent of each other */
+  if (sink->format <= SINK_FASTPNG)
+  {
+    if (!surface)
+      return 0;
+
+    snprintf(filename, sizeof(filename), FRAME_SINK_PNG_FORMAT, iteration);
+
+    if (sink->format == SINK_PNG)
+      error = cairo_surface_write_to_png(surface, filename) != CAIRO_STATUS_SUCCESS;
+    else
+      error = pngWrite(surface, filename);
+  }
+
+  /* Streams take one frame after the other */
+  else
+  {
+    pthread_mutex_lock(&sink->lock);
+
+    while (sink->next != frame)
+      pthread_cond_wait(&sink->turn, &sink->lock);
+
+    if (surface && !sink->error)
+      error = sink->error = streamWrite(sink, surface, iteration);
+
+    ++sink->next;
+
+    pthread_cond_broadcast(&sink->turn);
+    pthread_mutex_unlock(&sink->lock);
+  }
+
+  if (surface)
+  {
+    instrumentEnd(PHASE_ENCODE, encode);
+  }
+
+  if (error)
+    fprintf(stderr, "[ERROR] Could not write frame of iteration %lu.\n", iteration);
+
+  return error;
+}
+
+/**
+ * Closes the sink.
+ *
+ * @param[in] sink  The sink.
+ *
+ * @return NULL.
+ */
+extern FrameSink frameSinkClose(FrameSink sink)
+{
+  if (sink->file)
+  {
+    if (fflush(sink->file))
+      fprintf(stderr, "[ERROR] Could not write frames.\n");
+
+    if (sink->file != stdout)
+      fclose(sink->file);
+  }
+
+  pthread_cond_destroy(&sink->turn);
+  pthread_mutex_destroy(&sink->lock);
+
+  free(sink->pixels);
+  free(sink);
+
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Starts a PNG file of the given size, which is then written a few rows at a
+ * time. The rows are stored as RGB after the sub filter, i.e. the difference
+ * to the pixel on the left, and compressed at the fastest level of zlib,
+ * which suits the mostly flat pictures of the net.
+ *
+ * @param[in] filename  Output filename.
+ * @param[in] width     Width of the picture.
+ * @param[in] height    Height of the picture.
+ *
+ * @return The PNG file, NULL in case of an error.
+ */
+extern PngStream pngStreamOpen(char * filename, unsigned long width, unsigned long height)
+{
+  static const unsigned char signature[8] = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n' };
+
+  if (!width || !height || width > PNG_STREAM_SIZE || height > PNG_STREAM_SIZE)
+  {
+    fprintf(stderr, "[ERROR] A PNG file cannot have %lu x %lu pixels.\n", width, height);
+    return NULL;
+  }
+
+  PngStream png = calloc(1, sizeof(*png));
+
+  if (!png)
+  {
+    perror("[ERROR] pngStreamOpen :: calloc failed.");
+    return NULL;
+  }
+
+  png->width  = width;
+  png->height = height;
+  png->row    = malloc(1 + 3 * (size_t) width);
+  png->packed = malloc(PNG_STREAM_CHUNK);
+
+  if (!png->row || !png->packed || deflateInit(&png->zip, Z_BEST_SPEED) != Z_OK)
+  {
+    perror("[ERROR] pngStreamOpen :: malloc failed.");
+    free(png->packed);
+    free(png->row);
+    free(png);
+    return NULL;
+  }
+
+  png->zip.next_out  = png->packed;
+  png->zip.avail_out = PNG_STREAM_CHUNK;
+
+  unsigned char header[13] = { width  >> 24, width  >> 16, width  >> 8, width
+                             , height >> 24, height >> 16, height >> 8, height
+                             , 8, 2, 0, 0, 0 };
+
+  png->file = fopen(filename, "wb");
+
+  if (!png->file
+   || fwrite(signature, sizeof(signature), 1, png->file) != 1
+   || pngChunk(png->file, "IHDR", header, sizeof(header)))
+  {
+    fprintf(stderr, "[ERROR] Could not open %s.\n", filename);
+    return pngStreamClose(png);
+  }
+
+  return png;
+}
+
+/**
+ * Appends rows to a PNG file, which is complete once all of its rows have
+ * been written.
+ *
+ * @param[in] png     The PNG file.
+ * @param[in] data    Pixels in the RGB24 format of cairo, from the top.
+ * @param[in] stride  Bytes from one row of data to the next.
+ * @param[in] rows    Number of rows.
+ *
+ * @return 0 on success.
+ */
+extern int pngStreamRows(PngStream png, const unsigned char * data, unsigned long stride, unsigned long rows)
+{
+  if (rows > png->height - png->rows)
+    png->error = 1;
+
+  size_t length = 1 + 3 * (size_t) png->width;
+
+  for (unsigned long y = 0; !png->error && y < rows; ++y)
+  {
+    unsigned char * row = png->row;
+
+    row[0] = 1;
+    convertRow((const uint32_t *) (data + y * stride), png->width, row + 1, 3);
+
+    for (size_t x = length - 1; x > 3; --x)
+      row[x] -= row[x - 3];
+
+    png->zip.next_in  = row;
+    png->zip.avail_in = length;
+
+    png->error = pngDeflate(png, Z_NO_FLUSH);
+  }
+
+  png->rows += rows;
+
+  /* The last row ends the file */
+  if (!png->error && png->rows == png->height)
+  {
+    png->error = pngDeflate(png, Z_FINISH)
+              || pngChunk(png->file, "IEND", NULL, 0);
+
+    png->error = fclose(png->file) || png->error;
+    png->file  = NULL;
+  }
+
+  return png->error;
+}
+
+/**
+ * Closes a PNG file, which remains incomplete if not all of its rows have
+ * been written.
+ *
+ * @param[in] png  The PNG file.
+ *
+ * @return NULL.
+ */
+extern PngStream pngStreamClose(PngStream png)
+{
+  if (png->file)
+    fclose(png->file);
+
+  deflateEnd(&png->zip);
+
+  free(png->packed);
+  free(png->row);
+  free(png);
+
+  return NULL;
+}
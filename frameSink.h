@@ -0,0 +1,136 @@
+/**
+ * @file
+ *
+ * Where rendered frames go. Frames are either written as one PNG file each,
+ * with cairo's encoder or a faster one that compresses less, or appended to a
+ * single stream:
+ *
+ *   ppm    Binary PPM images one after another, e.g. for ffmpeg's image2pipe.
+ *   raw    RGBA pixels, 4 bytes per pixel, e.g. for ffmpeg's rawvideo.
+ *   tspf   A container of uncompressed frames, see FRAME_SINK_MAGIC.
+ *
+ * Streams get their frames in the order they were numbered by frameSinkNext,
+ * no matter in which order the render threads finish them.
+ *
+ * Pictures too large to be held in memory are written as PNG streams instead,
+ * a band of rows after the other.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __FRAME_SINK_H__
+#define __FRAME_SINK_H__
+
+/* -------------------------------------------------------------------------- */
+#include <cairo.h>
+/* -------------------------------------------------------------------------- */
+
+/* File names of frames written as PNG files, by iteration */
+#define FRAME_SINK_PNG_FORMAT "./img/%lu.png"
+
+/**
+ * Frame containers start with this magic, followed by the version, the width
+ * and the height of the frames and the bytes per pixel as 64 bit integers.
+ * Every frame consists of its iteration as a 64 bit integer followed by its
+ * pixels as RGB, row by row from the top, all in the byte order of the
+ * machine. All frames have the same size, so that frame k starts at byte
+ * 40 + k * (8 + width * height * 3).
+ */
+#define FRAME_SINK_MAGIC   "TSPF"
+#define FRAME_SINK_VERSION (1)
+
+/* Largest width and height of a PNG file */
+#define PNG_STREAM_SIZE (0x7fffffffUL)
+
+/* -------------------------------------------------------------------------- */
+
+/* Where frames go */
+typedef struct FrameSinkData * FrameSink;
+
+/* A PNG file that is written a few rows at a time */
+typedef struct PngStreamData * PngStream;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens a sink as given by spec: png or fastpng for one file per frame, or
+ * ppm, raw or tspf, optionally followed by a colon and a target, which is a
+ * file, - for stdout (the default) or fd:<n> for an open file descriptor.
+ *
+ * @param[in] spec  The sink.
+ *
+ * @return The sink, NULL in case of an error.
+ */
+extern FrameSink frameSinkOpen(char * spec);
+
+/**
+ * Numbers the next frame. Frames must be numbered in the order they are to be
+ * written and every number must be written, if only without a frame.
+ *
+ * @param[in] sink  The sink.
+ *
+ * @return Number of the frame.
+ */
+extern unsigned long frameSinkNext(FrameSink sink);
+
+/**
+ * Writes a frame, after all frames with lower numbers for streams. Safe to
+ * call from several threads.
+ *
+ * @param[in] sink       The sink.
+ * @param[in] surface    The frame, NULL to skip its number.
+ * @param[in] frame      Number of the frame.
+ * @param[in] iteration  Iteration the frame shows.
+ *
+ * @return 0 on success.
+ */
+extern int frameSinkWrite(FrameSink sink, cairo_surface_t * surface, unsigned long frame, unsigned long iteration);
+
+/**
+ * Closes the sink.
+ *
+ * @param[in] sink  The sink.
+ *
+ * @return NULL.
+ */
+extern FrameSink frameSinkClose(FrameSink sink);
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Starts a PNG file of the given size, which is then written a few rows at a
+ * time. The rows are stored as RGB after the sub filter, i.e. the difference
+ * to the pixel on the left, and compressed at the fastest level of zlib,
+ * which suits the mostly flat pictures of the net.
+ *
+ * @param[in] filename  Output filename.
+ * @param[in] width     Width of the picture.
+ * @param[in] height    Height of the picture.
+ *
+ * @return The PNG file, NULL in case of an error.
+ */
+extern PngStream pngStreamOpen(char * filename, unsigned long width, unsigned long height);
+
+/**
+ * Appends rows to a PNG file, which is complete once all of its rows have
+ * been written.
+ *
+ * @param[in] png     The PNG file.
+ * @param[in] data    Pixels in the RGB24 format of cairo, from the top.
+ * @param[in] stride  Bytes from one row of data to the next.
+ * @param[in] rows    Number of rows.
+ *
+ * @return 0 on success.
+ */
+extern int pngStreamRows(PngStream png, const unsigned char * data, unsigned long stride, unsigned long rows);
+
+/**
+ * Closes a PNG file, which remains incomplete if not all of its rows have
+ * been written.
+ *
+ * @param[in] png  The PNG file.
+ *
+ * @return NULL.
+ */
+extern PngStream pngStreamClose(PngStream png);
+
+#endif
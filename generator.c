@@ -0,0 +1,293 @@
+/**
+ * @file
+ *
+ * Generates synthetic instances of the tsp for scaling benchmarks.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <string.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "rng.h"
+#include "sampleMap.h"
+#include "mapWriter.h"
+/* -------------------------------------------------------------------------- */
+
+/* How the cities are distributed */
+typedef enum { UNIFORM, CLUSTER, GRID } Distribution;
+
+/* A type for the config */
+typedef struct {
+  unsigned long cities
+              , clusters
+              , seed
+              ;
+
+  /* Side length of the square the cities are placed in */
+  double width;
+
+  /* Jitter of grid cities relative to the grid spacing */
+  double jitter;
+
+  Distribution distribution;
+
+  Boolean binary
+        , help
+        , error
+        ;
+
+  char * filename;
+} Config;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_CITIES       (   1000)
+#define DEFAULT_CLUSTERS     (      0)
+#define DEFAULT_SEED         (      1)
+#define DEFAULT_WIDTH        (1000000)
+#define DEFAULT_JITTER       (    0.1)
+#define DEFAULT_DISTRIBUTION (UNIFORM)
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the default config
+ *
+ * @return Default config.
+ */
+static Config getDefaultConfig(void)
+{
+  Config c;
+
+  c.cities       = DEFAULT_CITIES;
+  c.clusters     = DEFAULT_CLUSTERS;
+  c.seed         = DEFAULT_SEED;
+  c.width        = DEFAULT_WIDTH;
+  c.jitter       = DEFAULT_JITTER;
+  c.distribution = DEFAULT_DISTRIBUTION;
+  c.binary       = FALSE;
+  c.help         = FALSE;
+  c.error        = FALSE;
+  c.filename     = NULL;
+
+  return c;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "tspgen, a program for generating instances of the traveling salesman problem in 2D eucledian space.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "Usage: tspgen <tsp file> [options]\n");
+  fprintf(stream, "  Required arguments:\n");
+  fprintf(stream, "    tsp file       File to write the instance to, - for stdout.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -n <number>    Number of cities                            (default: %i)\n", DEFAULT_CITIES);
+  fprintf(stream, "    -t <type>      Distribution: uniform, cluster or grid      (default: uniform)\n");
+  fprintf(stream, "    -c <number>    Number of clusters                          (default: sqrt(cities) / 4)\n");
+  fprintf(stream, "    -j <number>    Jitter of grid cities, relative to spacing  (default: %.1lf)\n", DEFAULT_JITTER);
+  fprintf(stream, "    -w <number>    Side length of the square of cities         (default: %i)\n", DEFAULT_WIDTH);
+  fprintf(stream, "    -s <number>    Seed                                        (default: %i)\n", DEFAULT_SEED);
+  fprintf(stream, "    -b             Write the binary format\n");
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = getDefaultConfig();
+
+  /* First parameter is the output file name */
+  c.filename = argv[1];
+  int i = 2;
+
+  while (i < argc && !c.error)
+  {
+    if (strcmp(argv[i], "-h") == 0)
+      c.help = TRUE;
+
+    else if (strcmp(argv[i], "-b") == 0)
+      c.binary = TRUE;
+
+    else if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-n") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.cities) != 1;
+
+    else if (strcmp(argv[i], "-c") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.clusters) != 1;
+
+    else if (strcmp(argv[i], "-s") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.seed) != 1;
+
+    else if (strcmp(argv[i], "-w") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.width) != 1;
+
+    else if (strcmp(argv[i], "-j") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.jitter) != 1;
+
+    else if (strcmp(argv[i], "-t") == 0)
+    {
+      ++i;
+
+      if (strcmp(argv[i], "uniform") == 0)
+        c.distribution = UNIFORM;
+      else if (strcmp(argv[i], "cluster") == 0)
+        c.distribution = CLUSTER;
+      else if (strcmp(argv[i], "grid") == 0)
+        c.distribution = GRID;
+      else
+        c.error = TRUE;
+    }
+
+    else
+      c.error = TRUE;
+
+    ++i;
+  }
+
+  if (c.error)
+    fprintf(stderr, "[ERROR] Invalid option: %s.\n", argv[i - 1]);
+
+  return c;
+}
+
+/**
+ * Places the cities uniformly at random in the square.
+ *
+ * @param[in]     c    Config.
+ * @param[in,out] rng  Random number generator.
+ * @param[in]     s    Sample map to fill.
+ *
+ * @return The filled sample map.
+ */
+static SampleMap generateUniform(Config c, Rng * rng, SampleMap s)
+{
+  while (s.items < c.cities)
+    s = sampleMapPut(s, vectorMake(c.width * rngUniform(rng), c.width * rngUniform(rng)));
+
+  return s;
+}
+
+/**
+ * Places the cities in gaussian clusters around uniformly distributed centres.
+ * Cities that fall outside of the square are drawn again.
+ *
+ * @param[in]     c    Config.
+ * @param[in,out] rng  Random number generator.
+ * @param[in]     s    Sample map to fill.
+ *
+ * @return The filled sample map.
+ */
+static SampleMap generateCluster(Config c, Rng * rng, SampleMap s)
+{
+  unsigned long clusters = c.clusters ? c.clusters : (unsigned long) ceil(sqrt(c.cities) / 4);
+
+  double sigma = c.width / (4 * sqrt(clusters));
+
+  Vector * centres = malloc(clusters * sizeof(Vector))
+       , p
+       ;
+
+  if (!centres)
+  {
+    perror("[ERROR] generateCluster :: malloc failed.");
+    exit(1);
+  }
+
+  for (unsigned long i = 0; i < clusters; ++i)
+    centres[i] = vectorMake(c.width * rngUniform(rng), c.width * rngUniform(rng));
+
+  while (s.items < c.cities)
+  {
+    p = vectorAdd( centres[rngIndex(rng, clusters)]
+                 , vectorMake(sigma * rngGaussian(rng), sigma * rngGaussian(rng))
+                 );
+
+    if (p.x >= 0 && p.y >= 0 && p.x < c.width && p.y < c.width)
+      s = sampleMapPut(s, p);
+  }
+
+  free(centres);
+
+  return s;
+}
+
+/**
+ * Places the cities on a square grid, row by row, and moves each of them by a
+ * uniformly distributed jitter relative to the grid spacing.
+ *
+ * @param[in]     c    Config.
+ * @param[in,out] rng  Random number generator.
+ * @param[in]     s    Sample map to fill.
+ *
+ * @return The filled sample map.
+ */
+static SampleMap generateGrid(Config c, Rng * rng, SampleMap s)
+{
+  unsigned long side = (unsigned long) ceil(sqrt(c.cities));
+
+  double spacing = c.width / side;
+
+  while (s.items < c.cities)
+    s = sampleMapPut(s, vectorMake( spacing * (s.items % side + 0.5 + c.jitter * (rngUniform(rng) - 0.5))
+                                  , spacing * (s.items / side + 0.5 + c.jitter * (rngUniform(rng) - 0.5))
+                                  ));
+
+  return s;
+}
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  Config c = parseArgs(argc, argv);
+
+  if (c.help || c.error)
+  {
+    help(stderr);
+    return c.error;
+  }
+
+  Rng rng = rngMake(c.seed);
+
+  SampleMap s = sampleMapMake(c.cities);
+
+  if (!s.samples)
+    return 1;
+
+  switch (c.distribution)
+  {
+    case UNIFORM : s = generateUniform(c, &rng, s); break;
+    case CLUSTER : s = generateCluster(c, &rng, s); break;
+    case GRID    : s = generateGrid(c, &rng, s);    break;
+  }
+
+  int error = mapWriterWrite(c.filename, s, c.binary);
+
+  s = sampleMapFree(s);
+
+  return error;
+}
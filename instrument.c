@@ -0,0 +1,410 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <time.h>
+#include <string.h>
+#ifndef MACOSX
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+#endif
+/* -------------------------------------------------------------------------- */
+#include "instrument.h"
+#include "trace.h"
+/* -------------------------------------------------------------------------- */
+
+/* Names of the phases */
+static const char * names[PHASE_COUNT] =
+  { "load"
+  , "bounds"
+  , "train"
+  , "bmu"
+  , "update"
+  , "grow"
+  , "prune"
+  , "render"
+  , "encode"
+  };
+
+/* Names of the hardware counters */
+static const char * counterNames[COUNTER_COUNT] =
+  { "cycles"
+  , "instructions"
+  , "l1dMisses"
+  , "llcMisses"
+  , "dtlbMisses"
+  };
+
+/* Number of runs and time spent per phase */
+static uint64_t calls[PHASE_COUNT]
+              , nanos[PHASE_COUNT]
+              ;
+
+/* Hardware counter events per phase, and the runs they were counted for */
+static uint64_t counts[PHASE_COUNT][COUNTER_COUNT]
+              , counted[PHASE_COUNT]
+              ;
+
+/* Set on the thread that opened the counters, the only thread they count */
+static __thread int owner;
+
+/**
+ * The counters form one perf event group that is read with a single system
+ * call. slots holds the position of each counter in the group, -1 if it is
+ * not available.
+ */
+static int group = -1
+         , members
+         , slots[COUNTER_COUNT]
+         , fds[COUNTER_COUNT]
+         ;
+
+/* -------------------------------------------------------------------------- */
+
+#ifndef MACOSX
+/**
+ * Opens a counter as member of the group, or as its leader if there is no
+ * group yet.
+ *
+ * @param[in] type    Type of the event.
+ * @param[in] config  The event.
+ *
+ * @return File descriptor of the counter, -1 on failure.
+ */
+static int counterOpen(uint32_t type, uint64_t config)
+{
+  struct perf_event_attr attr;
+
+  memset(&attr, 0, sizeof(attr));
+  attr.size           = sizeof(attr);
+  attr.type           = type;
+  attr.config         = config;
+  attr.read_format    = PERF_FORMAT_GROUP;
+  attr.disabled       = group < 0;
+  attr.exclude_kernel = 1;
+  attr.exclude_hv     = 1;
+
+  return syscall(__NR_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/**
+ * Encodes a read miss in the given cache for perf_event_open.
+ *
+ * @param[in] cache  The cache.
+ *
+ * @return The event.
+ */
+static uint64_t cacheReadMiss(uint64_t cache)
+{
+  return cache
+       | (PERF_COUNT_HW_CACHE_OP_READ     <<  8)
+       | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)
+       ;
+}
+#endif
+
+/**
+ * Reads all counters of the group.
+ *
+ * @param[out] counters  Current value of every counter, 0 if not available.
+ */
+static void countersRead(uint64_t * counters)
+{
+  uint64_t values[1 + COUNTER_COUNT] = { 0 };
+
+  #ifndef MACOSX
+  if (read(group, values, (1 + members) * sizeof(uint64_t)) < 0)
+    values[0] = 0;
+  #endif
+
+  for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+    counters[counter] = slots[counter] >= 0 && slots[counter] < (int) values[0]
+                      ? values[1 + slots[counter]]
+                      : 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Reads the monotonic clock.
+ *
+ * @return Time in nanoseconds.
+ */
+extern uint64_t instrumentNow(void)
+{
+  struct timespec t;
+
+  clock_gettime(CLOCK_MONOTONIC, &t);
+
+  return (uint64_t) t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+/**
+ * Reads the monotonic clock and, if they are open, the hardware counters.
+ *
+ * @return The current mark.
+ */
+extern InstrumentMark instrumentMark(void)
+{
+  InstrumentMark res;
+
+  if (group >= 0 && owner)
+    countersRead(res.counters);
+
+  res.time = instrumentNow();
+
+  return res;
+}
+
+/**
+ * Accounts one run of a phase that started at the given mark. Safe to call
+ * from several threads.
+ *
+ * @param[in] phase  The phase.
+ * @param[in] start  Mark taken when the phase started.
+ */
+extern void instrumentAdd(Phase phase, InstrumentMark start)
+{
+  InstrumentMark end = instrumentMark();
+
+  __atomic_fetch_add(&calls[phase], 1,                     __ATOMIC_RELAXED);
+  __atomic_fetch_add(&nanos[phase], end.time - start.time, __ATOMIC_RELAXED);
+
+  /* The group counts the thread that opened it, runs on other threads would
+     be charged with its events */
+  if (group >= 0 && owner)
+  {
+    __atomic_fetch_add(&counted[phase], 1, __ATOMIC_RELAXED);
+
+    for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+      __atomic_fetch_add(&counts[phase][counter], end.counters[counter] - start.counters[counter], __ATOMIC_RELAXED);
+  }
+
+  /* Training is traced in blocks by the caller */
+  if (phase != PHASE_TRAIN && phase != PHASE_BMU && phase != PHASE_UPDATE)
+    traceEvent(names[phase], start.time, end.time);
+}
+
+/**
+ * Starts collecting hardware counters for the calling thread. Counters that
+ * the CPU or the kernel do not provide stay unavailable. Only runs of phases
+ * on the calling thread are counted.
+ *
+ * @return 0 if at least one counter is available.
+ */
+extern int instrumentCountersOpen(void)
+{
+  for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+  {
+    slots[counter] = -1;
+    fds[counter]   = -1;
+  }
+
+  members = 0;
+
+  #ifndef MACOSX
+  uint32_t types[COUNTER_COUNT] =
+    { PERF_TYPE_HARDWARE
+    , PERF_TYPE_HARDWARE
+    , PERF_TYPE_HW_CACHE
+    , PERF_TYPE_HW_CACHE
+    , PERF_TYPE_HW_CACHE
+    };
+
+  uint64_t configs[COUNTER_COUNT] =
+    { PERF_COUNT_HW_CPU_CYCLES
+    , PERF_COUNT_HW_INSTRUCTIONS
+    , cacheReadMiss(PERF_COUNT_HW_CACHE_L1D)
+    , cacheReadMiss(PERF_COUNT_HW_CACHE_LL)
+    , cacheReadMiss(PERF_COUNT_HW_CACHE_DTLB)
+    };
+
+  for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+  {
+    fds[counter] = counterOpen(types[counter], configs[counter]);
+
+    if (fds[counter] < 0)
+      continue;
+
+    if (group < 0)
+      group = fds[counter];
+
+    slots[counter] = members++;
+  }
+
+  if (group < 0)
+    return 1;
+
+  ioctl(group, PERF_EVENT_IOC_RESET,  PERF_IOC_FLAG_GROUP);
+  ioctl(group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+
+  owner = 1;
+
+  return 0;
+  #else
+  return 1;
+  #endif
+}
+
+/**
+ * Stops collecting hardware counters.
+ */
+extern void instrumentCountersClose(void)
+{
+  if (group < 0)
+    return;
+
+  #ifndef MACOSX
+  ioctl(group, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+
+  /* Members first, the leader last */
+  for (int counter = COUNTER_COUNT - 1; counter >= 0; --counter)
+    if (fds[counter] >= 0 && fds[counter] != group)
+      close(fds[counter]);
+
+  close(group);
+  #endif
+
+  group = -1;
+  owner = 0;
+}
+
+/**
+ * Tells whether a hardware counter is collected.
+ *
+ * @param[in] counter  The counter.
+ *
+ * @return Nonzero if the counter is available.
+ */
+extern int instrumentCounterAvailable(Counter counter)
+{
+  return group >= 0 && slots[counter] >= 0;
+}
+
+/**
+ * Returns the name of a phase.
+ *
+ * @param[in] phase  The phase.
+ *
+ * @return Name of the phase.
+ */
+extern const char * instrumentName(Phase phase)
+{
+  return names[phase];
+}
+
+/**
+ * Returns the name of a hardware counter.
+ *
+ * @param[in] counter  The counter.
+ *
+ * @return Name of the counter.
+ */
+extern const char * instrumentCounterName(Counter counter)
+{
+  return counterNames[counter];
+}
+
+/**
+ * Returns how often a phase ran.
+ *
+ * @param[in] phase  The phase.
+ *
+ * @return Number of runs.
+ */
+extern uint64_t instrumentCalls(Phase phase)
+{
+  return __atomic_load_n(&calls[phase], __ATOMIC_RELAXED);
+}
+
+/**
+ * Returns the time spent in a phase.
+ *
+ * @param[in] phase  The phase.
+ *
+ * @return Time in nanoseconds.
+ */
+extern uint64_t instrumentNanos(Phase phase)
+{
+  return __atomic_load_n(&nanos[phase], __ATOMIC_RELAXED);
+}
+
+/**
+ * Returns how many runs of a phase the hardware counters were collected for,
+ * i.e. the runs on the thread that opened them.
+ *
+ * @param[in] phase  The phase.
+ *
+ * @return Number of counted runs.
+ */
+extern uint64_t instrumentCounted(Phase phase)
+{
+  return __atomic_load_n(&counted[phase], __ATOMIC_RELAXED);
+}
+
+/**
+ * Returns the events a hardware counter counted during a phase.
+ *
+ * @param[in] phase    The phase.
+ * @param[in] counter  The counter.
+ *
+ * @return Number of events.
+ */
+extern uint64_t instrumentCounter(Phase phase, Counter counter)
+{
+  return __atomic_load_n(&counts[phase][counter], __ATOMIC_RELAXED);
+}
+
+/**
+ * Prints the time spent in each phase and its share of the given wall time,
+ * followed by the hardware counters if they are collected, together with the
+ * runs they were collected for.
+ *
+ * @param[in] stream  Where to print the breakdown.
+ * @param[in] wall    Wall time in nanoseconds.
+ */
+extern void instrumentPrint(FILE * stream, uint64_t wall)
+{
+  fprintf(stream, "Phase       calls      total ms     mean µs  share\n");
+
+  for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    fprintf(stream, "%-8s %8lu %13.3lf %11.3lf %5.1lf%%\n"
+                  , names[phase]
+                  , (unsigned long) instrumentCalls(phase)
+                  , instrumentNanos(phase) / 1e6
+                  , instrumentCalls(phase) ? instrumentNanos(phase) / 1e3 / instrumentCalls(phase) : 0.0
+                  , wall ? 100.0 * instrumentNanos(phase) / wall : 0.0
+                  );
+
+  if (group < 0)
+    return;
+
+  fprintf(stream, "Counters only include runs on the thread that opened them, not those on\n"
+                  "render, poster or batch worker threads.\n");
+
+  fprintf(stream, "Phase    counted");
+  for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+    fprintf(stream, " %14s", counterNames[counter]);
+  fprintf(stream, "    IPC\n");
+
+  for (int phase = 0; phase < PHASE_COUNT; ++phase)
+  {
+    fprintf(stream, "%-8s %7lu", names[phase], (unsigned long) instrumentCounted(phase));
+
+    for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+      if (instrumentCounterAvailable(counter))
+        fprintf(stream, " %14lu", (unsigned long) instrumentCounter(phase, counter));
+      else
+        fprintf(stream, " %14s", "n/a");
+
+    if (instrumentCounterAvailable(COUNTER_INSTRUCTIONS) && instrumentCounter(phase, COUNTER_CYCLES))
+      fprintf(stream, " %6.2lf\n", (double) instrumentCounter(phase, COUNTER_INSTRUCTIONS) / instrumentCounter(phase, COUNTER_CYCLES));
+    else
+      fprintf(stream, " %6s\n", "n/a");
+  }
+}
@@ -0,0 +1,190 @@
+/**
+ * @file
+ *
+ * Lightweight per-phase timers. Every phase accumulates the number of times it
+ * ran and the time spent in it, measured with the monotonic clock. Without
+ * INSTRUMENT defined, the timers compile to nothing.
+ *
+ * Training is timed in blocks of iterations. The phases that run in every
+ * iteration, the search for the best matching unit and the update, would
+ * cost two clock reads each per iteration and are only timed with
+ * INSTRUMENT_ITERATIONS defined as well.
+ *
+ * Optionally, hardware counters are collected per phase as well. They are
+ * read with perf_event_open on Linux and count the thread that opened them,
+ * so only runs of phases on that thread are counted. Runs on other threads,
+ * e.g. rendering on the render thread, add no counter events.
+ *
+ * While tracing, every run of a phase is recorded as trace event, except for
+ * those that run once per iteration.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __INSTRUMENT_H__
+#define __INSTRUMENT_H__
+
+/* -------------------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdint.h>
+/* -------------------------------------------------------------------------- */
+
+/* The instrumented phases */
+typedef enum {
+  PHASE_LOAD,
+  PHASE_BOUNDS,
+  PHASE_TRAIN,
+  PHASE_BMU,
+  PHASE_UPDATE,
+  PHASE_GROW,
+  PHASE_PRUNE,
+  PHASE_RENDER,
+  PHASE_ENCODE,
+  PHASE_COUNT
+} Phase;
+
+/* The hardware counters */
+typedef enum {
+  COUNTER_CYCLES,
+  COUNTER_INSTRUCTIONS,
+  COUNTER_L1D_MISSES,
+  COUNTER_LLC_MISSES,
+  COUNTER_DTLB_MISSES,
+  COUNTER_COUNT
+} Counter;
+
+/* A point in time together with the hardware counters at that time */
+typedef struct {
+  uint64_t time;
+  uint64_t counters[COUNTER_COUNT];
+} InstrumentMark;
+
+/* -------------------------------------------------------------------------- */
+#ifdef INSTRUMENT
+#define instrumentBegin(t)      InstrumentMark t = instrumentMark()
+#define instrumentEnd(phase, t) instrumentAdd((phase), (t))
+#else
+#define instrumentBegin(t)
+#define instrumentEnd(phase, t)
+#endif
+
+#if defined(INSTRUMENT) && defined(INSTRUMENT_ITERATIONS)
+#define instrumentIterationBegin(t)      instrumentBegin(t)
+#define instrumentIterationEnd(phase, t) instrumentEnd(phase, t)
+#else
+#define instrumentIterationBegin(t)
+#define instrumentIterationEnd(phase, t)
+#endif
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Reads the monotonic clock.
+ *
+ * @return Time in nanoseconds.
+ */
+extern uint64_t instrumentNow(void);
+
+/**
+ * Reads the monotonic clock and, if they are open, the hardware counters.
+ *
+ * @return The current mark.
+ */
+extern InstrumentMark instrumentMark(void);
+
+/**
+ * Accounts one run of a phase that started at the given mark. Safe to call
+ * from several threads.
+ *
+ * @param[in] phase  The phase.
+ * @param[in] start  Mark taken when the phase started.
+ */
+extern void instrumentAdd(Phase phase, InstrumentMark start);
+
+/**
+ * Starts collecting hardware counters for the calling thread. Counters that
+ * the CPU or the kernel do not provide stay unavailable. Only runs of phases
+ * on the calling thread are counted.
+ *
+ * @return 0 if at least one counter is available.
+ */
+extern int instrumentCountersOpen(void);
+
+/**
+ * Stops collecting hardware counters.
+ */
+extern void instrumentCountersClose(void);
+
+/**
+ * Tells whether a hardware counter is collected.
+ *
+ * @param[in] counter  The counter.
+ *
+ * @return Nonzero if the counter is available.
+ */
+extern int instrumentCounterAvailable(Counter counter);
+
+/**
+ * Returns the name of a hardware counter.
+ *
+ * @param[in] counter  The counter.
+ *
+ * @return Name of the counter.
+ */
+extern const char * instrumentCounterName(Counter counter);
+
+/**
+ * Returns how many runs of a phase the hardware counters were collected for,
+ * i.e. the runs on the thread that opened them.
+ *
+ * @param[in] phase  The phase.
+ *
+ * @return Number of counted runs.
+ */
+extern uint64_t instrumentCounted(Phase phase);
+
+/**
+ * Returns the events a hardware counter counted during a phase.
+ *
+ * @param[in] phase    The phase.
+ * @param[in] counter  The counter.
+ *
+ * @return Number of events.
+ */
+extern uint64_t instrumentCounter(Phase phase, Counter counter);
+
+/**
+ * Returns the name of a phase.
+ *
+ * @param[in] phase  The phase.
+ *
+ * @return Name of the phase.
+ */
+extern const char * instrumentName(Phase phase);
+
+/**
+ * Returns how often a phase ran.
+ *
+ * @param[in] phase  The phase.
+ *
+ * @return Number of runs.
+ */
+extern uint64_t instrumentCalls(Phase phase);
+
+/**
+ * Returns the time spent in a phase.
+ *
+ * @param[in] phase  The phase.
+ *
+ * @return Time in nanoseconds.
+ */
+extern uint64_t instrumentNanos(Phase phase);
+
+/**
+ * Prints the time spent in each phase and its share of the given wall time,
+ * followed by the hardware counters if they are collected.
+ *
+ * @param[in] stream  Where to print the breakdown.
+ * @param[in] wall    Wall time in nanoseconds.
+ */
+extern void instrumentPrint(FILE * stream, uint64_t wall);
+
+#endif
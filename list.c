@@ -4,7 +4,9 @@
  * Listenelemente sind ganzzahlige Werte groesser gleich Null.
  * Listen koennen jeden Wert nur einmal enthalten.
  * Listen sind aufsteigend sortiert.
- * Listen sind als rekursive Struktur implementiert (einfach verkette Listen).
+ * Listen sind als rekursive Struktur implementiert (einfach verkette Listen),
+ * die Operationen darauf sind iterativ.
+ * Die Knoten aller Listen stammen aus einer gemeinsamen Arena.
  *
  * @author Christopher Blöcker
  */
@@ -17,6 +19,70 @@
 
 /* ########################################################################## */
 
+/** Anzahl der Knoten des ersten Blocks, jeder weitere ist doppelt so gross. */
+#define LIST_CHUNK (1024)
+
+/** Groesster Block, in Zweierpotenzen von LIST_CHUNK. */
+#define LIST_CHUNK_MAX (10)
+
+/** Arena, aus der die Knoten aller Listen stammen. */
+static struct
+{
+  /** Bloecke von Knoten, ueber den ersten Knoten jedes Blocks verkettet. */
+  List chunks;
+  /** Anzahl der Bloecke. */
+  unsigned long count;
+  /** Noch nie vergebene Knoten des letzten Blocks. */
+  List fresh;
+  unsigned long left;
+  /** Geloeschte Knoten, ueber next verkettet. */
+  List free;
+} arena;
+
+/* ########################################################################## */
+
+/**
+ * Liefert einen Knoten aus der Arena, bevorzugt aus der Freiliste. Ist kein
+ * Knoten mehr frei, wird ein neuer Block angelegt.
+ *
+ * @return Knoten.
+ */
+static List nodeMake (void)
+{
+  List res = arena.free;
+
+  if (res)
+  {
+    arena.free = res->next;
+    return res;
+  }
+
+  if (!arena.left)
+  {
+    unsigned long nodes = LIST_CHUNK << (arena.count < LIST_CHUNK_MAX ? arena.count : LIST_CHUNK_MAX);
+    List chunk = malloc(nodes * sizeof(*chunk));
+
+    if (!chunk)
+    {
+      perror("[ERROR] nodeMake :: malloc failed.");
+      exit(1);
+    }
+
+    /* Der erste Knoten verkettet die Bloecke */
+    chunk->next   = arena.chunks;
+    arena.chunks  = chunk;
+    arena.fresh   = chunk + 1;
+    arena.left    = nodes - 1;
+    ++arena.count;
+  }
+
+  --arena.left;
+
+  return arena.fresh++;
+}
+
+/* ########################################################################## */
+
 /**
  * Erzeugt eine leere Liste.
  *
@@ -88,7 +154,8 @@ extern List list_removeHead (List l)
   
   res = list_tail(l);
   
-  free(l);
+  l->next    = arena.free;
+  arena.free = l;
 
   return res;
 }
@@ -103,10 +170,7 @@ extern List list_removeHead (List l)
  */
 extern List list_cons (Element e, List l)
 {
-  List res = NULL;
-  res = calloc(sizeof(*l), 1);
-  
-  if (!res) exit(1);
+  List res = nodeMake();
 
   res->value = e;
   res->next = l;
@@ -114,6 +178,30 @@ extern List list_cons (Element e, List l)
   return res;
 }
 
+/**
+ * Erzeugt eine Liste aus den Elementen eines aufsteigend sortierten Feldes
+ * ohne doppelte Elemente.
+ *
+ * @param[in] elems Feld der Elemente.
+ * @param[in] n Anzahl der Elemente.
+ *
+ * @return Liste der Elemente.
+ */
+extern List list_fromSorted (const Element * elems, unsigned long n)
+{
+  List res = list_mkEmpty();
+
+  /* Vom Ende her, damit jedes Element an den Kopf kommt */
+  while (n--)
+  {
+    assert(list_isEmpty(res) || !list_geElement(elems[n], list_head(res)));
+
+    res = list_cons(elems[n], res);
+  }
+
+  return res;
+}
+
 /**
  * Liefert die Laenge der Liste l.
  *
@@ -123,7 +211,12 @@ extern List list_cons (Element e, List l)
  */
 extern unsigned long list_length (List l)
 {
-  return (list_isEmpty(l)) ? 0 : 1 + list_length(list_tail(l));
+  unsigned long res = 0;
+
+  for (; !list_isEmpty(l); l = list_tail(l))
+    ++res;
+
+  return res;
 }
 
 /**
@@ -136,7 +229,10 @@ extern unsigned long list_length (List l)
  */
 extern Element list_at (List l, unsigned long i)
 {
-  return (i == 0) ? list_head(l) : list_at(list_tail(l), i - 1);
+  for (; i > 0; --i)
+    l = list_tail(l);
+
+  return list_head(l);
 }
 
 /**
@@ -149,7 +245,11 @@ extern Element list_at (List l, unsigned long i)
  */
 extern int list_isIn (Element e, List l)
 {
-  return (list_isEmpty(l)) ? 0 : (list_eqElement(list_head(l), e)) ? 1 : list_isIn(e, list_tail(l));
+  /* Die Suche endet beim ersten Element, das nicht kleiner als e ist */
+  while (!list_isEmpty(l) && !list_geElement(list_head(l), e))
+    l = list_tail(l);
+
+  return !list_isEmpty(l) && list_eqElement(list_head(l), e);
 }
 
 /**
@@ -162,10 +262,15 @@ extern int list_isIn (Element e, List l)
  */
 extern List list_insertElem (Element e, List l)
 {
-  if (list_isEmpty(l)) return list_cons(e, l);
-  if (list_eqElement(list_head(l), e)) return l;
-  if (list_geElement(list_head(l), e)) return list_cons(e, l);
-  l->next = list_insertElem(e, list_tail(l));
+  List * p = &l;
+
+  /* p zeigt auf den Verweis auf den ersten Knoten, der nicht kleiner als e ist */
+  while (!list_isEmpty(*p) && !list_geElement(list_head(*p), e))
+    p = &(*p)->next;
+
+  if (list_isEmpty(*p) || !list_eqElement(list_head(*p), e))
+    *p = list_cons(e, *p);
+
   return l;
 }
 
@@ -179,10 +284,14 @@ extern List list_insertElem (Element e, List l)
  */
 extern List list_removeElem (Element e, List l)
 {
-  if (list_isEmpty(l)) return l;
-  if (list_geElement(list_head(l), e) && !list_eqElement(list_head(l), e)) return l;
-  if (list_eqElement(list_head(l), e)) return list_removeHead(l);
-  l->next = list_removeElem(e, list_tail(l));
+  List * p = &l;
+
+  while (!list_isEmpty(*p) && !list_geElement(list_head(*p), e))
+    p = &(*p)->next;
+
+  if (!list_isEmpty(*p) && list_eqElement(list_head(*p), e))
+    *p = list_removeHead(*p);
+
   return l;
 }
 
@@ -196,6 +305,35 @@ extern List list_removeElem (Element e, List l)
 extern List list_removeAllElems (List l)
 {
   if (list_isEmpty(l)) return l;
-  return list_removeAllElems(list_removeHead(l));
+
+  /* Die ganze Liste wird vor die Freiliste gehaengt */
+  List last = l;
+
+  while (!list_isEmpty(list_tail(last)))
+    last = list_tail(last);
+
+  last->next = arena.free;
+  arena.free = l;
+
+  return list_mkEmpty();
+}
+
+/**
+ * Gibt den Speicher der Arena frei. Alle Listen werden dadurch ungueltig.
+ */
+extern void list_freeArena (void)
+{
+  while (arena.chunks)
+  {
+    List chunk = arena.chunks;
+
+    arena.chunks = chunk->next;
+    free(chunk);
+  }
+
+  arena.count = 0;
+  arena.fresh = NULL;
+  arena.left  = 0;
+  arena.free  = NULL;
 }
 
@@ -4,7 +4,12 @@
  * Listenelemente sind ganzzahlige Werte groesser gleich Null.
  * Listen koennen jeden Wert nur einmal enthalten.
  * Listen sind aufsteigend sortiert.
- * Listen sind als rekursive Struktur implementiert (einfach verkette Listen).
+ * Listen sind als rekursive Struktur implementiert (einfach verkette Listen),
+ * die Operationen darauf sind iterativ, so dass auch lange Listen keinen
+ * Stapelueberlauf verursachen.
+ * Die Knoten aller Listen stammen aus einer gemeinsamen Arena, die sie
+ * blockweise anlegt. Geloeschte Knoten kommen in eine Freiliste und werden
+ * wiederverwendet. Die Bibliothek ist daher nicht threadsicher.
  *
  * @author Martin Egge, Christian Uhlig, Uwe Schmidt
  */
@@ -108,6 +113,17 @@ extern List list_removeHead (List l);
  */
 extern List list_cons (Element e, List l);
 
+/**
+ * Erzeugt eine Liste aus den Elementen eines aufsteigend sortierten Feldes
+ * ohne doppelte Elemente.
+ *
+ * @param[in] elems Feld der Elemente.
+ * @param[in] n Anzahl der Elemente.
+ *
+ * @return Liste der Elemente.
+ */
+extern List list_fromSorted (const Element * elems, unsigned long n);
+
 /**
  * Liefert die Laenge der Liste l.
  *
@@ -166,4 +182,9 @@ extern List list_removeElem (Element e, List l);
  */
 extern List list_removeAllElems (List l);
 
+/**
+ * Gibt den Speicher der Arena frei. Alle Listen werden dadurch ungueltig.
+ */
+extern void list_freeArena (void);
+
 #endif
@@ -0,0 +1,298 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+/* -------------------------------------------------------------------------- */
+#include "liveView.h"
+/* -------------------------------------------------------------------------- */
+
+/* The shared memory segment */
+typedef struct {
+  char magic[4];
+  uint32_t version;
+
+  uint64_t pid
+         , capacity
+         ;
+
+  /* Odd while the writer changes the net */
+  uint64_t sequence;
+
+  uint64_t iteration
+         , size
+         ;
+
+  Vector neurons[];
+} LiveViewSegment;
+
+struct LiveViewData {
+  LiveViewSegment * segment;
+  size_t bytes;
+
+  /* Name of the segment the writer removes, NULL for readers */
+  char * name;
+
+  /* The copy of a reader, and the sequence it was taken at */
+  Vector * neurons;
+  unsigned long capacity;
+  uint64_t sequence;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the segment with the given name, e.g. "/tspsom", with room for the
+ * given number of neurons. An existing segment of that name is replaced.
+ *
+ * @param[in] name      Name of the segment.
+ * @param[in] capacity  Most neurons the net will have.
+ *
+ * @return The live view, NULL in case of an error.
+ */
+extern LiveView liveViewCreate(char * name, unsigned long capacity)
+{
+  LiveView view = calloc(1, sizeof(*view));
+
+  if (!view || !(view->name = strdup(name)))
+  {
+    perror("[ERROR] liveViewCreate :: calloc failed.");
+    free(view);
+    return NULL;
+  }
+
+  view->bytes = sizeof(LiveViewSegment) + capacity * sizeof(Vector);
+
+  /* Readers of a segment left behind keep their mapping of it */
+  shm_unlink(name);
+
+  int fd = shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0644);
+
+  if (fd < 0 || ftruncate(fd, view->bytes)
+   || (view->segment = mmap(NULL, view->bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0)) == MAP_FAILED)
+  {
+    fprintf(stderr, "[ERROR] Could not create live view %s: %s.\n", name, strerror(errno));
+
+    if (fd >= 0)
+    {
+      close(fd);
+      shm_unlink(name);
+    }
+
+    free(view->name);
+    free(view);
+    return NULL;
+  }
+
+  close(fd);
+
+  view->segment->version  = LIVE_VIEW_VERSION;
+  view->segment->pid      = getpid();
+  view->segment->capacity = capacity;
+  memcpy(view->segment->magic, LIVE_VIEW_MAGIC, 4);
+
+  return view;
+}
+
+/**
+ * Publishes the net, which costs a copy of the positions of its neurons.
+ *
+ * @param[in] view       The live view.
+ * @param[in] nn         Neural net.
+ * @param[in] iteration  Iteration of training.
+ *
+ * @return 0 on success, 1 if the net has outgrown the segment.
+ */
+extern int liveViewPublish(LiveView view, NeuralNet nn, unsigned long iteration)
+{
+  LiveViewSegment * segment = view->segment;
+  uint64_t sequence = segment->sequence;
+
+  if (nn.size > segment->capacity)
+    return 1;
+
+  /* Readers that see the odd sequence or a later one drop their copy */
+  __atomic_store_n(&segment->sequence, sequence + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  __atomic_store_n(&segment->iteration, iteration, __ATOMIC_RELAXED);
+  __atomic_store_n(&segment->size, nn.size, __ATOMIC_RELAXED);
+  neuralNetPositions(nn, segment->neurons);
+
+  __atomic_store_n(&segment->sequence, sequence + 2, __ATOMIC_RELEASE);
+
+  return 0;
+}
+
+/**
+ * Opens an existing segment for reading.
+ *
+ * @param[in] name  Name of the segment.
+ *
+ * @return The live view, NULL in case of an error.
+ */
+extern LiveView liveViewOpen(char * name)
+{
+  LiveView view = calloc(1, sizeof(*view));
+  struct stat status;
+
+  if (!view)
+  {
+    perror("[ERROR] liveViewOpen :: calloc failed.");
+    return NULL;
+  }
+
+  int fd = shm_open(name, O_RDONLY, 0);
+
+  if (fd < 0 || fstat(fd, &status))
+  {
+    fprintf(stderr, "[ERROR] Could not open live view %s: %s.\n", name, strerror(errno));
+
+    if (fd >= 0)
+      close(fd);
+
+    free(view);
+    return NULL;
+  }
+
+  view->bytes   = status.st_size;
+  view->segment = view->bytes < sizeof(LiveViewSegment)
+                ? MAP_FAILED
+                : mmap(NULL, view->bytes, PROT_READ, MAP_SHARED, fd, 0);
+
+  close(fd);
+
+  if (view->segment == MAP_FAILED)
+  {
+    fprintf(stderr, "[ERROR] %s is not a live view.\n", name);
+    free(view);
+    return NULL;
+  }
+
+  if (memcmp(view->segment->magic, LIVE_VIEW_MAGIC, 4)
+   || view->segment->version != LIVE_VIEW_VERSION
+   || view->segment->capacity > (view->bytes - sizeof(LiveViewSegment)) / sizeof(Vector))
+  {
+    fprintf(stderr, "[ERROR] %s is not a live view.\n", name);
+    return liveViewClose(view);
+  }
+
+  return view;
+}
+
+/**
+ * Copies the net, if it has been published again since the last copy. The
+ * copy belongs to the live view and remains valid until the next one.
+ *
+ * @param[in]  view      The live view.
+ * @param[out] snapshot  The copy.
+ *
+ * @return 0 for a new copy, 1 if the net has not changed, -1 in case of an
+ *         error.
+ */
+extern int liveViewRead(LiveView view, LiveViewSnapshot * snapshot)
+{
+  LiveViewSegment * segment = view->segment;
+
+  for (;;)
+  {
+    uint64_t before = __atomic_load_n(&segment->sequence, __ATOMIC_ACQUIRE);
+
+    if (before == view->sequence)
+      return 1;
+
+    /* A writer that died while publishing leaves the sequence odd */
+    if (before & 1)
+    {
+      if (!liveViewWriting(view))
+        return 1;
+
+      sched_yield();
+      continue;
+    }
+
+    uint64_t iteration = __atomic_load_n(&segment->iteration, __ATOMIC_RELAXED)
+           , size      = __atomic_load_n(&segment->size, __ATOMIC_RELAXED)
+           ;
+
+    if (size > segment->capacity)
+      continue;
+
+    if (size > view->capacity)
+    {
+      Vector * grown = realloc(view->neurons, size * sizeof(Vector));
+
+      if (!grown)
+      {
+        perror("[ERROR] liveViewRead :: realloc failed.");
+        return -1;
+      }
+
+      view->neurons  = grown;
+      view->capacity = size;
+    }
+
+    memcpy(view->neurons, segment->neurons, size * sizeof(Vector));
+
+    /* The copy is kept if the writer has not started since */
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+    if (__atomic_load_n(&segment->sequence, __ATOMIC_RELAXED) == before)
+    {
+      view->sequence = before;
+
+      snapshot->iteration = iteration;
+      snapshot->size      = size;
+      snapshot->neurons   = view->neurons;
+
+      return 0;
+    }
+  }
+}
+
+/**
+ * Tells whether the process that publishes into the segment still runs.
+ *
+ * @param[in] view  The live view.
+ *
+ * @return Whether the writer runs.
+ */
+extern int liveViewWriting(LiveView view)
+{
+  return !kill(view->segment->pid, 0) || errno == EPERM;
+}
+
+/**
+ * Unmaps the segment. The writer removes it, readers that still have it
+ * mapped keep the last net.
+ *
+ * @param[in] view  The live view.
+ *
+ * @return NULL.
+ */
+extern LiveView liveViewClose(LiveView view)
+{
+  munmap(view->segment, view->bytes);
+
+  if (view->name)
+    shm_unlink(view->name);
+
+  free(view->name);
+  free(view->neurons);
+  free(view);
+
+  return NULL;
+}
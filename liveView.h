@@ -0,0 +1,111 @@
+/**
+ * @file
+ *
+ * A live view publishes the net into a POSIX shared memory segment, from
+ * which other processes read it while training goes on. Training only copies
+ * the positions of the neurons into the segment, reading and rendering are up
+ * to the readers.
+ *
+ * The segment is guarded by a seqlock: the writer makes the sequence odd
+ * before it changes the net and even again after, a reader copies the net and
+ * keeps the copy only if the sequence was the same even number before and
+ * after. Readers never block the writer.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __LIVE_VIEW_H__
+#define __LIVE_VIEW_H__
+
+/* -------------------------------------------------------------------------- */
+#include "neuralNet.h"
+#include "vector.h"
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Segments start with this magic, followed by the version, the process id of
+ * the writer and the number of neurons the segment has room for, then the
+ * sequence, the iteration and the number of neurons of the net and the
+ * positions of the neurons in the order of the ring.
+ */
+#define LIVE_VIEW_MAGIC   "TSPV"
+#define LIVE_VIEW_VERSION (1)
+
+/* -------------------------------------------------------------------------- */
+
+/* A segment that the net is published into or read from */
+typedef struct LiveViewData * LiveView;
+
+/* A copy of the net */
+typedef struct {
+  unsigned long iteration;
+
+  /* Positions of the neurons in the order of the ring */
+  unsigned long size;
+  Vector * neurons;
+} LiveViewSnapshot;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the segment with the given name, e.g. "/tspsom", with room for the
+ * given number of neurons. An existing segment of that name is replaced.
+ *
+ * @param[in] name      Name of the segment.
+ * @param[in] capacity  Most neurons the net will have.
+ *
+ * @return The live view, NULL in case of an error.
+ */
+extern LiveView liveViewCreate(char * name, unsigned long capacity);
+
+/**
+ * Publishes the net, which costs a copy of the positions of its neurons.
+ *
+ * @param[in] view       The live view.
+ * @param[in] nn         Neural net.
+ * @param[in] iteration  Iteration of training.
+ *
+ * @return 0 on success, 1 if the net has outgrown the segment.
+ */
+extern int liveViewPublish(LiveView view, NeuralNet nn, unsigned long iteration);
+
+/**
+ * Opens an existing segment for reading.
+ *
+ * @param[in] name  Name of the segment.
+ *
+ * @return The live view, NULL in case of an error.
+ */
+extern LiveView liveViewOpen(char * name);
+
+/**
+ * Copies the net, if it has been published again since the last copy. The
+ * copy belongs to the live view and remains valid until the next one.
+ *
+ * @param[in]  view      The live view.
+ * @param[out] snapshot  The copy.
+ *
+ * @return 0 for a new copy, 1 if the net has not changed, -1 in case of an
+ *         error.
+ */
+extern int liveViewRead(LiveView view, LiveViewSnapshot * snapshot);
+
+/**
+ * Tells whether the process that publishes into the segment still runs.
+ *
+ * @param[in] view  The live view.
+ *
+ * @return Whether the writer runs.
+ */
+extern int liveViewWriting(LiveView view);
+
+/**
+ * Unmaps the segment. The writer removes it, readers that still have it
+ * mapped keep the last net.
+ *
+ * @param[in] view  The live view.
+ *
+ * @return NULL.
+ */
+extern LiveView liveViewClose(LiveView view);
+
+#endif
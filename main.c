@@ -10,26 +10,71 @@
 #include <time.h>
 #include <assert.h>
 #include <string.h>
+#include <ctype.h>
+#include <sys/resource.h>
+#include <signal.h>
+#include <unistd.h>
 /* -------------------------------------------------------------------------- */
 #include "types.h"
 #include "sampleMap.h"
 #include "mapReader.h"
+#include "mapStream.h"
+#include "mapMerger.h"
 #include "neuralNet.h"
 #include "drawer.h"
+#include "tour.h"
+#include "solver.h"
+#include "instrument.h"
+#include "trace.h"
+#include "telemetry.h"
+#include "frameSink.h"
+#include "trajectory.h"
+#include "poster.h"
+#include "liveView.h"
 /* -------------------------------------------------------------------------- */
 
 /* A type for the config */
 typedef struct {
-  unsigned maxLearn
-         , print
-         , debugLevel
+  unsigned long maxLearn
+              , print
+              , memory
+              , seed
+              , interval
+              , checkpointInterval
+              , snapshotInterval
+              , publishInterval
+              , posterWidth
+              , posterHeight
+              ;
+
+  unsigned debugLevel
+         , renderThreads
          ;
 
+  /* Maximum number of neurons per sample, 0 for the default */
+  double ratio;
+
+  /* Distance below which cities are merged into one sample */
+  double epsilon;
+
   Boolean help
         , error
+        , stream
+        , counters
         ;
 
-  char * filename;
+  char * filename
+       , * tourFile
+       , * reportFile
+       , * traceFile
+       , * telemetry
+       , * frames
+       , * checkpointFile
+       , * resumeFile
+       , * trajectoryFile
+       , * posterFile
+       , * liveView
+       ;
 } Config;
 
 typedef struct timespec TimeSpec;
@@ -38,15 +83,51 @@ typedef struct timespec TimeSpec;
 #define DEFAULT_MAXLEARN   (10000)
 #define DEFAULT_PRINT      ( 1000)
 #define DEFAULT_DEBUGLEVEL (    0)
+#define DEFAULT_RATIO      (    0)
+#define DEFAULT_MEMORY     (    0)
+#define DEFAULT_EPSILON    (    0)
+#define DEFAULT_SEED       (    0)
+#define DEFAULT_INTERVAL   ( 1000)
+#define DEFAULT_CHECKPOINT (    0)
+#define DEFAULT_SNAPSHOT   ( 1000)
+#define DEFAULT_PUBLISH    ( 1000)
+#define DEFAULT_RENDER     (    2)
+#define DEFAULT_POSTER     (16384)
+#define DEFAULT_FRAMES     "png"
 #define DEFAULT_HELP       (FALSE)
 /* -------------------------------------------------------------------------- */
 
+/* Number of training iterations that are traced as one event */
+#define TRACE_BLOCK (1024)
+
+/* -------------------------------------------------------------------------- */
+
+/* Signal that requested a checkpoint, 0 if none */
+static volatile sig_atomic_t checkpointSignal = 0;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Calculates the time between start and end.
+ *
+ * @param[in] start  Earlier point in time.
+ * @param[in] end    Later point in time.
+ *
+ * @return Time between start and end.
+ */
 TimeSpec diff(TimeSpec start, TimeSpec end)
 {
   TimeSpec res;
 
-  res.tv_sec  = abs(end.tv_sec  - start.tv_sec);
-  res.tv_nsec = abs(end.tv_nsec - start.tv_nsec);
+  res.tv_sec  = end.tv_sec  - start.tv_sec;
+  res.tv_nsec = end.tv_nsec - start.tv_nsec;
+
+  /* Borrow a second if the nanoseconds underflow */
+  if (res.tv_nsec < 0)
+  {
+    --res.tv_sec;
+    res.tv_nsec += 1000000000;
+  }
 
   return res;
 }
@@ -63,9 +144,32 @@ Config getDefaultConfig(void)
   c.maxLearn   = DEFAULT_MAXLEARN;
   c.print      = DEFAULT_PRINT;
   c.debugLevel = DEFAULT_DEBUGLEVEL;
+  c.ratio      = DEFAULT_RATIO;
+  c.memory     = DEFAULT_MEMORY;
+  c.epsilon    = DEFAULT_EPSILON;
+  c.seed       = DEFAULT_SEED;
+  c.interval   = DEFAULT_INTERVAL;
+  c.checkpointInterval = DEFAULT_CHECKPOINT;
+  c.snapshotInterval = DEFAULT_SNAPSHOT;
+  c.publishInterval = DEFAULT_PUBLISH;
+  c.renderThreads = DEFAULT_RENDER;
+  c.posterWidth  = DEFAULT_POSTER;
+  c.posterHeight = DEFAULT_POSTER;
   c.help       = FALSE;
+  c.stream     = FALSE;
+  c.counters   = FALSE;
   c.error      = FALSE;
   c.filename = '\0';
+  c.tourFile = NULL;
+  c.reportFile = NULL;
+  c.traceFile = NULL;
+  c.telemetry = NULL;
+  c.frames = DEFAULT_FRAMES;
+  c.checkpointFile = NULL;
+  c.resumeFile = NULL;
+  c.trajectoryFile = NULL;
+  c.posterFile = NULL;
+  c.liveView = NULL;
 
   return c;
 }
@@ -85,8 +189,31 @@ void help(FILE* stream)
   fprintf(stream, "\n");
   fprintf(stream, "  Options:\n");
   fprintf(stream, "    -l <number>    Set the number of learning cycles           (default: %i)\n", DEFAULT_MAXLEARN);
-  fprintf(stream, "    -p <number>    Rendering images after how many iterations  (default: %i)\n", DEFAULT_PRINT);
+  fprintf(stream, "    -p <number>    Rendering images after how many iterations  (default: %i, 0 for none)\n", DEFAULT_PRINT);
+  fprintf(stream, "    -j <number>    Number of threads that render images        (default: %i, 0 while training)\n", DEFAULT_RENDER);
+  fprintf(stream, "    -f <format>    Images as png, fastpng, ppm, raw or tspf    (default: %s)\n", DEFAULT_FRAMES);
+  fprintf(stream, "                   ppm, raw and tspf stream to -, fd:<n> or a file given after a colon\n");
   fprintf(stream, "    -d <number>    Set the debug level.                        (default: %i)\n", DEFAULT_DEBUGLEVEL);
+  fprintf(stream, "    -r <number>    Maximum number of neurons per city          (default: log(cities))\n");
+  fprintf(stream, "    -M <number>    Memory budget in MiB, limits the net size   (default: unlimited)\n");
+  fprintf(stream, "    -e <number>    Merge cities in grid cells of this diagonal (default: %i)\n", DEFAULT_EPSILON);
+  fprintf(stream, "    -o <file>      Write the tour through all cities to file\n");
+  fprintf(stream, "    -S             Start training while the cities are read\n");
+  fprintf(stream, "    -s <number>    Seed for the random number generator        (default: time)\n");
+  fprintf(stream, "    -J <file>      Write a summary of the run as JSON to file\n");
+  fprintf(stream, "    -P             Collect hardware counters for every phase\n");
+  fprintf(stream, "    -T <file>      Write a Chrome trace of the run to file\n");
+  fprintf(stream, "    -t <file>      Write training progress as JSON lines to file, - or fd:<n>\n");
+  fprintf(stream, "    -i <number>    Write training progress after how many iterations (default: %i)\n", DEFAULT_INTERVAL);
+  fprintf(stream, "    -c <file>      Write checkpoints of training to file\n");
+  fprintf(stream, "    -C <number>    Write a checkpoint after how many iterations (default: %i, 0 for on signal only)\n", DEFAULT_CHECKPOINT);
+  fprintf(stream, "    -R <file>      Resume training from the checkpoint in file\n");
+  fprintf(stream, "    -L <file>      Write snapshots of the net to a trajectory log, - or fd:<n>\n");
+  fprintf(stream, "    -I <number>    Write a snapshot after how many iterations  (default: %i)\n", DEFAULT_SNAPSHOT);
+  fprintf(stream, "    -V <name>      Publish the net to a shared memory segment for tspview, e.g. /tspsom\n");
+  fprintf(stream, "    -v <number>    Publish the net after how many iterations   (default: %i)\n", DEFAULT_PUBLISH);
+  fprintf(stream, "    -g <file>      Render the final net as a large PNG to file\n");
+  fprintf(stream, "    -G <w>x<h>     Size of that picture in pixels              (default: %ix%i)\n", DEFAULT_POSTER, DEFAULT_POSTER);
 }
 
 /**
@@ -114,10 +241,76 @@ static Config parseArgs(int argc, char * argv[])
       c.help = TRUE;
 
     else if (strcmp(argv[i], "-l") == 0)
-      c.error = sscanf(argv[++i], "%u", &c.maxLearn) != 1;
+      c.error = sscanf(argv[++i], "%lu", &c.maxLearn) != 1;
 
     else if (strcmp(argv[i], "-p") == 0)
-      c.error = sscanf(argv[++i], "%u", &c.print) != 1;
+      c.error = sscanf(argv[++i], "%lu", &c.print) != 1;
+
+    else if (strcmp(argv[i], "-j") == 0)
+      c.error = sscanf(argv[++i], "%u", &c.renderThreads) != 1;
+
+    else if (strcmp(argv[i], "-f") == 0)
+      c.frames = argv[++i];
+
+    else if (strcmp(argv[i], "-r") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.ratio) != 1;
+
+    else if (strcmp(argv[i], "-M") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.memory) != 1;
+
+    else if (strcmp(argv[i], "-e") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.epsilon) != 1;
+
+    else if (strcmp(argv[i], "-o") == 0)
+      c.tourFile = argv[++i];
+
+    else if (strcmp(argv[i], "-S") == 0)
+      c.stream = TRUE;
+
+    else if (strcmp(argv[i], "-s") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.seed) != 1;
+
+    else if (strcmp(argv[i], "-J") == 0)
+      c.reportFile = argv[++i];
+
+    else if (strcmp(argv[i], "-P") == 0)
+      c.counters = TRUE;
+
+    else if (strcmp(argv[i], "-T") == 0)
+      c.traceFile = argv[++i];
+
+    else if (strcmp(argv[i], "-t") == 0)
+      c.telemetry = argv[++i];
+
+    else if (strcmp(argv[i], "-i") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.interval) != 1 || !c.interval;
+
+    else if (strcmp(argv[i], "-c") == 0)
+      c.checkpointFile = argv[++i];
+
+    else if (strcmp(argv[i], "-C") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.checkpointInterval) != 1;
+
+    else if (strcmp(argv[i], "-R") == 0)
+      c.resumeFile = argv[++i];
+
+    else if (strcmp(argv[i], "-L") == 0)
+      c.trajectoryFile = argv[++i];
+
+    else if (strcmp(argv[i], "-I") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.snapshotInterval) != 1 || !c.snapshotInterval;
+
+    else if (strcmp(argv[i], "-V") == 0)
+      c.liveView = argv[++i];
+
+    else if (strcmp(argv[i], "-v") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.publishInterval) != 1 || !c.publishInterval;
+
+    else if (strcmp(argv[i], "-g") == 0)
+      c.posterFile = argv[++i];
+
+    else if (strcmp(argv[i], "-G") == 0)
+      c.error = sscanf(argv[++i], "%lux%lu", &c.posterWidth, &c.posterHeight) != 2 || !c.posterWidth || !c.posterHeight;
 
     else
     {
@@ -132,6 +325,211 @@ static Config parseArgs(int argc, char * argv[])
   return c;
 }
 
+/**
+ * Publishes the net to the live view. A net that has outgrown the segment is
+ * reported and the view is closed, since it cannot be published any more.
+ *
+ * @param[in] view       The live view.
+ * @param[in] nn         Neural net.
+ * @param[in] iteration  Iteration of training.
+ * @param[in] name       Name of the shared memory segment.
+ *
+ * @return The live view, or NULL if it has been closed.
+ */
+static LiveView publish(LiveView view, NeuralNet nn, unsigned long iteration, char * name)
+{
+  if (!liveViewPublish(view, nn, iteration))
+    return view;
+
+  fprintf(stderr, "[ERROR] The net of %lu neurons has outgrown the live view %s. No longer publishing.\n", nn.size, name);
+
+  return liveViewClose(view);
+}
+
+/**
+ * Determines how many neurons the net may grow to. Without a memory budget
+ * this is given by the neuron to city ratio, otherwise the ratio is capped by
+ * what fits into the budget besides the samples and the renderer. Cities that
+ * are merged are kept besides the weighted samples and the merger, which are
+ * counted for as many samples as cities, since at most that many remain.
+ *
+ * @param[in] c      Config.
+ * @param[in] items  Number of cities.
+ * @param[in] merge  Whether the cities are merged into samples.
+ *
+ * @return Maximum number of neurons.
+ */
+static unsigned long maxNeurons(Config c, unsigned long items, Boolean merge)
+{
+  unsigned long res = neuralNetMaxSize(items, c.ratio)
+              , budget
+              , fixed
+              , perNeuron
+              ;
+
+  if (c.memory)
+  {
+    budget    = c.memory << 20;
+    fixed     = sampleMapFootprint(items, FALSE) + drawerFootprint(0, c.renderThreads) + neuralNetFootprint(0);
+
+    if (merge)
+      fixed += sampleMapFootprint(items, TRUE) + mapMergerFootprint(items, items);
+
+    perNeuron = neuralNetFootprint(1) - neuralNetFootprint(0)
+              + drawerFootprint(1, c.renderThreads) - drawerFootprint(0, c.renderThreads);
+
+    if (budget <= fixed)
+      res = 1;
+    else if ((budget - fixed) / perNeuron < res)
+      res = (budget - fixed) / perNeuron;
+  }
+
+  return res;
+}
+
+/**
+ * Finds the next iteration after the given one at which something is due,
+ * i.e. rendering, telemetry, a snapshot, a checkpoint, the end of a traced
+ * block, checking for signals or the end of training.
+ *
+ * @param[in] c          Config.
+ * @param[in] time       Iterations done so far.
+ * @param[in] telemetry  Whether telemetry is written.
+ *
+ * @return The next iteration at which something is due.
+ */
+static unsigned long nextDue(Config c, unsigned long time, Boolean telemetry)
+{
+  unsigned long periods[] = { TRACE_BLOCK
+                            , c.print
+                            , telemetry ? c.interval : 0
+                            , c.checkpointFile ? c.checkpointInterval : 0
+                            , c.trajectoryFile ? c.snapshotInterval : 0
+                            , c.liveView ? c.publishInterval : 0
+                            }
+              , res = c.maxLearn
+              ;
+
+  for (unsigned long i = 0; i < sizeof(periods) / sizeof(periods[0]); ++i)
+    if (periods[i] && (time / periods[i] + 1) * periods[i] < res)
+      res = (time / periods[i] + 1) * periods[i];
+
+  return res;
+}
+
+/**
+ * Closes the stream once all cities have arrived and finds their final
+ * bounding box.
+ *
+ * @param[in]  stream  The stream.
+ * @param[out] cities  All cities.
+ * @param[out] bounds  Bounding box around all cities.
+ *
+ * @return NULL.
+ */
+static MapStream streamFinish(MapStream stream, SampleMap * cities, PositionBounds * bounds)
+{
+  instrumentBegin(t);
+
+  if (mapStreamClose(stream, cities) || !cities->items)
+  {
+    fprintf(stderr, "[ERROR] Reading the cities failed. Exiting.\n");
+    exit(1);
+  }
+
+  instrumentEnd(PHASE_LOAD, t);
+
+  #ifdef INFO
+  fprintf(stderr, "[INFO ] All %lu cities have arrived.\n", cities->items);
+  #endif
+
+  *bounds = solverBounds(*cities);
+
+  return NULL;
+}
+
+/**
+ * Requests a checkpoint, which is written after the current iteration.
+ *
+ * @param[in] signal  The signal.
+ */
+static void checkpointRequest(int signal)
+{
+  checkpointSignal = signal;
+}
+
+/**
+ * Writes a summary of the run as a single line JSON object to the report file.
+ *
+ * @param[in] c           Config.
+ * @param[in] cities      Number of cities.
+ * @param[in] samples     Number of samples after merging.
+ * @param[in] neurons     Number of neurons.
+ * @param[in] seconds     Wall time of the run.
+ * @param[in] netLength   Length of the neural net.
+ * @param[in] cityLength  Length of the tour through all cities.
+ */
+static void writeReport(Config c, unsigned long cities, unsigned long samples, unsigned long neurons, double seconds, double netLength, double cityLength)
+{
+  struct rusage usage;
+  long peakRss;
+
+  FILE * f = fopen(c.reportFile, "w");
+
+  if (!f)
+  {
+    fprintf(stderr, "[ERROR] Could not open report file %s.\n", c.reportFile);
+    return;
+  }
+
+  /* Peak resident set size in kB, macOS reports bytes */
+  getrusage(RUSAGE_SELF, &usage);
+  peakRss = usage.ru_maxrss;
+  #ifdef MACOSX
+  peakRss /= 1024;
+  #endif
+
+  fprintf(f, "{\"file\": ");
+  telemetryWriteString(f, c.filename);
+  fprintf(f, ", \"cities\": %lu, \"samples\": %lu, \"iterations\": %lu, \"seed\": %lu"
+             ", \"neurons\": %lu, \"seconds\": %.6lf, \"iterationsPerSecond\": %.1lf, \"peakRssKb\": %ld"
+             ", \"netLength\": %.6lf, \"tourLength\": %.6lf"
+          , cities, samples, c.maxLearn, c.seed
+          , neurons, seconds, c.maxLearn / seconds, peakRss
+          , netLength, cityLength);
+
+  /* Seconds spent per phase */
+  #ifdef INSTRUMENT
+  fprintf(f, ", \"phases\": {");
+  for (int phase = 0; phase < PHASE_COUNT; ++phase)
+    fprintf(f, "%s\"%s\": %.6lf", phase ? ", " : "", instrumentName(phase), instrumentNanos(phase) / 1e9);
+  fprintf(f, "}");
+
+  /* Hardware counters per phase, null where not available */
+  if (c.counters)
+  {
+    fprintf(f, ", \"counters\": {");
+    for (int phase = 0; phase < PHASE_COUNT; ++phase)
+      for (int counter = 0; counter < COUNTER_COUNT; ++counter)
+      {
+        const char * name = instrumentCounterName(counter);
+
+        fprintf(f, "%s\"%s%c%s\": ", phase || counter ? ", " : "", instrumentName(phase), toupper(name[0]), name + 1);
+
+        if (instrumentCounterAvailable(counter))
+          fprintf(f, "%lu", (unsigned long) instrumentCounter(phase, counter));
+        else
+          fprintf(f, "null");
+      }
+    fprintf(f, "}");
+  }
+  #endif
+
+  fprintf(f, "}\n");
+
+  fclose(f);
+}
+
 /**
  *
  */
@@ -145,87 +543,406 @@ int main(int argc, char * argv[])
          , elapsed
          ;
 
-  clock_gettime(CLOCK_REALTIME, &start);
+  clock_gettime(CLOCK_MONOTONIC, &start);
 
-  if (argc > 1)
+  if (c.counters)
   {
-    /* dirty... */
-    char filename[100];
+    #ifdef INSTRUMENT
+    if (instrumentCountersOpen())
+      fprintf(stderr, "[ERROR] Hardware counters are not available.\n");
+    #else
+    fprintf(stderr, "[ERROR] Hardware counters need a build with INSTRUMENT=yes.\n");
+    #endif
+  }
 
+  if (c.traceFile)
+  {
+    #ifdef INSTRUMENT
+    traceOpen();
+    traceThreadName("main");
+    #else
+    fprintf(stderr, "[ERROR] Tracing needs a build with INSTRUMENT=yes.\n");
+    #endif
+  }
+
+  if (argc > 1)
+  {
     #ifdef DEBUG
     fprintf(stderr, "[DEBUG] Reading Samples from %s.\n", c.filename);
     #endif
 
-    /* Read samples from input file (the city positions) */
-    SampleMap s = mapReaderRead(c.filename);
-
-    /* Find the bounding box around the given samples */
+    SampleMap cities;
+    MapStream stream = NULL;
     PositionBounds bounds;
-    bounds.topleft     = s.samples[0];
-    bounds.bottomright = s.samples[0];
 
-    for (unsigned sample = 1; sample < s.items; ++sample)
+    /* Read the city positions from input file, or start reading them */
+    instrumentBegin(load);
+
+    if (c.stream)
     {
-      if (s.samples[sample].x < bounds.topleft.x)
-        bounds.topleft.x = s.samples[sample].x;
+      stream = mapStreamOpen(c.filename);
+
+      if (stream)
+      {
+        mapStreamWait(stream);
+        cities = mapStreamSamples(stream);
+        bounds = mapStreamBounds(stream);
+      }
+      else
+        cities.items = 0;
+    }
+    else
+      cities = mapReaderRead(c.filename);
 
-      if (s.samples[sample].y < bounds.topleft.y)
-        bounds.topleft.y = s.samples[sample].y;
+    instrumentEnd(PHASE_LOAD, load);
 
-      if (s.samples[sample].x > bounds.bottomright.x)
-        bounds.bottomright.x = s.samples[sample].x;
+    if (!cities.items)
+    {
+      fprintf(stderr, "[ERROR] No samples read from %s. Exiting.\n", c.filename);
+      exit(1);
+    }
 
-      if (s.samples[sample].y > bounds.bottomright.y)
-        bounds.bottomright.y = s.samples[sample].y;
+    /* The order of streamed cities and thus training depends on timing */
+    if (stream && (c.checkpointFile || c.resumeFile))
+    {
+      fprintf(stderr, "[ERROR] Checkpoints cannot be used while streaming. Exiting.\n");
+      exit(1);
     }
 
+    if (!c.seed)
+      c.seed = time(NULL);
+
+    /* Merge coincident cities into weighted samples, which needs all of them */
+    SolverOptions options = solverDefaultOptions();
+
+    options.iterations = c.maxLearn;
+    options.epsilon    = stream ? -1 : c.epsilon;
+    options.maxNeurons = maxNeurons(c, stream ? mapStreamSize(stream) : cities.items, options.epsilon >= 0);
+    options.seed       = c.seed;
+
+    Solver solver = solverMake(cities, options);
+
+    if (!solver)
+      exit(1);
+
+    /* Render in the background, so that training does not wait for it */
+    solverRenderThreads(solver, c.renderThreads);
+
+    SampleMap s = solverSamples(solver);
+
+    if (!stream)
+      bounds = solverBounds(s);
+
     #ifdef INFO
-    fprintf(stderr, "[INFO ] Samples read.\n");
+    if (stream)
+      fprintf(stderr, "[INFO ] Streaming %lu cities, %lu have arrived.\n", mapStreamSize(stream), cities.items);
+    else
+    {
+      fprintf(stderr, "[INFO ] Samples read.\n");
+      fprintf(stderr, "[INFO ] Merged %lu cities into %lu samples.\n", cities.items, s.items);
+    }
     fprintf(stderr, "[INFO ] Bounds are :: left   : %lf\n",  bounds.topleft.x);
     fprintf(stderr, "[INFO ]               right  : %lf\n",  bounds.bottomright.x);
     fprintf(stderr, "[INFO ]               top    : %lf\n",  bounds.topleft.y);
     fprintf(stderr, "[INFO ]               bottom : %lf.\n", bounds.bottomright.y);
     fprintf(stderr, "[INFO ] Learning after %lu cycles.\n",  (unsigned long) neuralNetLearnAfter(s.items));
     fprintf(stderr, "[INFO ] Learning threshold is %lf.\n",  neuralNetGrowThres(s.items));
+    fprintf(stderr, "[INFO ] Net grows up to %lu neurons.\n", options.maxNeurons);
+    fprintf(stderr, "[INFO ] Memory :: cities  : %lu bytes\n", sampleMapFootprint(stream ? mapStreamSize(stream) : cities.items, FALSE));
+    if (s.samples != cities.samples)
+    {
+      fprintf(stderr, "[INFO ]           samples : %lu bytes\n", sampleMapFootprint(s.items, TRUE));
+      fprintf(stderr, "[INFO ]           merger  : %lu bytes\n", mapMergerFootprint(cities.items, s.items));
+    }
+    fprintf(stderr, "[INFO ]           net     : %lu bytes\n", neuralNetFootprint(options.maxNeurons));
+    fprintf(stderr, "[INFO ]           drawer  : %lu bytes\n", drawerFootprint(options.maxNeurons, c.renderThreads));
     #endif
 
-    /* Create the neural net, i.e. the self organising map */
-    NeuralNet nn = neuralNetMake(bounds);
+    /* Continue with the net, schedule and random numbers of the checkpoint */
+    if (c.resumeFile)
+    {
+      if (solverResume(solver, c.resumeFile))
+        exit(1);
+
+      c.maxLearn = solverOptions(solver).iterations;
+      c.seed     = solverOptions(solver).seed;
+
+      #ifdef INFO
+      fprintf(stderr, "[INFO ] Resuming after %lu of %lu iterations with %lu neurons.\n", solverIteration(solver), c.maxLearn, solverNet(solver).size);
+      #endif
+    }
 
     #ifdef DEBUG
     fprintf(stderr, "[DEBUG] Created neural net\n");
     #endif
 
-    srand(time(NULL));
+    /* SIGUSR1 writes a checkpoint, SIGTERM writes one and stops */
+    if (c.checkpointFile)
+    {
+      signal(SIGUSR1, checkpointRequest);
+      signal(SIGTERM, checkpointRequest);
+    }
 
-    /* Prepare paingin */
-    drawerPrepareData(s, bounds);
+    /* Where the images go */
+    FrameSink frames = NULL;
+
+    if (c.print && !(frames = frameSinkOpen(c.frames)))
+      exit(1);
 
-    /* Initial "solution" */
-    drawerDrawMap(nn, s, bounds, "./img/0.png");
+    /* Initial "solution", streamed cities are painted once all have arrived */
+    if (!stream && c.print && !c.resumeFile)
+      solverRender(solver, frames);
+
+    /* Snapshots for later, appended to those before the checkpoint */
+    Trajectory trajectory = NULL;
+
+    if (c.trajectoryFile && !(trajectory = trajectoryOpen(c.trajectoryFile, c.resumeFile != NULL)))
+      exit(1);
+
+    if (trajectory && !c.resumeFile)
+      trajectoryWrite(trajectory, solverNet(solver), 0, neuralNetLearningRate(solverProgress(solver)));
+
+    /* The net as it trains, for viewers in other processes. Growing stops at
+       the maximum size of the net, which a checkpoint brings along. */
+    LiveView view = NULL;
+
+    if (c.liveView && !(view = liveViewCreate(c.liveView, solverNet(solver).maxSize)))
+      exit(1);
+
+    if (view)
+      view = publish(view, solverNet(solver), solverIteration(solver), c.liveView);
 
     #ifdef DEBUG
     fprintf(stderr, "[DEBUG] Training ...\n");
     #endif
 
+    /* Report training progress in the background */
+    Telemetry telemetry = NULL;
+    TelemetryRecord record = { 0, 0, 0.0, 0.0, 0.0, 0.0 };
+    uint64_t reported = instrumentNow();
+    unsigned long reportedIteration = solverIteration(solver);
+    double reportedError = solverNet(solver).error;
+
+    if (c.telemetry && !(telemetry = telemetryOpen(c.telemetry)))
+      exit(1);
+
     /* Train the neural net and render images */
-    unsigned time;
-    for (time = 1; time <= c.maxLearn; ++time)
+    #ifdef INSTRUMENT
+    uint64_t block = instrumentNow();
+    #endif
+
+    unsigned long time;
+    while ((time = solverIteration(solver)) < c.maxLearn)
     {
+      /* Train on the cities that have arrived so far */
+      if (stream)
+      {
+        int done = mapStreamDone(stream);
+
+        cities = mapStreamSamples(stream);
+
+        if (done)
+          stream = streamFinish(stream, &cities, &bounds);
+
+        solverUpdate(solver, cities, bounds);
+      }
+
+      /* Train until something is due, one iteration at a time while streaming */
+      long trained = solverStep(solver, stream ? 1 : nextDue(c, time, telemetry != NULL) - time);
+
+      if (trained < 0)
+      {
+        fprintf(stderr, "[ERROR] The net could not grow any further. Exiting.\n");
+        exit(1);
+      }
+
+      time += trained;
+
       #ifdef DEBUG
-      fprintf(stderr, "[DEBUG] cycle %i from %i :: %.2lf%% done\n", time, c.maxLearn, 100.0 * time / c.maxLearn);
+      fprintf(stderr, "[DEBUG] cycle %lu from %lu :: %.2lf%% done\n", time, c.maxLearn, 100.0 * time / c.maxLearn);
+      #endif
+
+      NeuralNet nn = solverNet(solver);
+
+      if (telemetry && !(time % c.interval))
+      {
+        uint64_t now = instrumentNow();
+        unsigned long span = time - reportedIteration;
+
+        record.iteration           = time;
+        record.neurons             = nn.size;
+        record.learningRate        = neuralNetLearningRate(solverProgress(solver));
+        record.error               = (nn.error - reportedError) / span;
+        record.length              = neuralNetLength(nn);
+        record.iterationsPerSecond = span / ((now - reported) / 1e9);
+
+        telemetryPut(telemetry, record);
+        reported          = now;
+        reportedIteration = time;
+        reportedError     = nn.error;
+      }
+
+      Boolean render   = !stream && c.print && !(time % c.print)
+            , snapshot = trajectory && !(time % c.snapshotInterval)
+            ;
+
+      /* Trace training in blocks, which end before rendering and snapshots */
+      #ifdef INSTRUMENT
+      if (traceOn && (render || snapshot || !(time % TRACE_BLOCK) || time == c.maxLearn))
+        block = traceSpan("train", block);
+      #endif
+
+      if (snapshot)
+        trajectoryWrite(trajectory, nn, time, neuralNetLearningRate(solverProgress(solver)));
+
+      if (view && (!(time % c.publishInterval) || time == c.maxLearn))
+        view = publish(view, nn, time, c.liveView);
+
+      if (render)
+        solverRender(solver, frames);
+
+      #ifdef INSTRUMENT
+      if (render || snapshot)
+        block = instrumentNow();
       #endif
 
-      sprintf(filename, "./img/%i.png", time);
+      /* Checkpoint on the interval or when a signal requested it */
+      if (c.checkpointFile
+       && ((c.checkpointInterval && !(time % c.checkpointInterval)) || checkpointSignal))
+      {
+        if (solverCheckpoint(solver, c.checkpointFile))
+          exit(1);
+
+        #ifdef INFO
+        fprintf(stderr, "[INFO ] Wrote checkpoint after %lu iterations to %s.\n", time, c.checkpointFile);
+        #endif
+
+        /* Terminate as the signal would have, once the checkpoint is safe */
+        if (checkpointSignal == SIGTERM)
+        {
+          if (telemetry)
+            telemetry = telemetryClose(telemetry);
+
+          solverRenderWait(solver);
 
-      nn = neuralNetTrain(nn, s, (double) (c.maxLearn - time) / c.maxLearn);
+          if (frames)
+            frames = frameSinkClose(frames);
 
-      if (!(time % c.print))
-        drawerDrawMap(nn, s, bounds, filename);
+          if (trajectory)
+            trajectory = trajectoryClose(trajectory);
+
+          if (view)
+            view = liveViewClose(view);
+
+          signal(SIGTERM, SIG_DFL);
+          raise(SIGTERM);
+        }
+
+        checkpointSignal = 0;
+      }
     }
 
+    if (telemetry)
+      telemetry = telemetryClose(telemetry);
+
+    solverRenderWait(solver);
+
+    if (frames)
+      frames = frameSinkClose(frames);
+
+    if (trajectory)
+      trajectory = trajectoryClose(trajectory);
+
+    if (view)
+      view = liveViewClose(view);
+
+    /* Training may have finished before all cities have arrived */
+    if (stream)
+    {
+      stream = streamFinish(stream, &cities, &bounds);
+      solverUpdate(solver, cities, bounds);
+    }
+
+    s = solverSamples(solver);
+
+    double netLength  = neuralNetLength(solverNet(solver))
+         , cityLength = 0.0
+         ;
+
     #ifdef INFO
-    fprintf(stderr, "[INFO ] Length of tour : %lf.\n", neuralNetLength(nn));
+    fprintf(stderr, "[INFO ] Length of tour : %lf.\n", netLength);
+    #endif
+
+    /* Render the final net in tiles on all cpus, training is over */
+    if (c.posterFile)
+    {
+      NeuralNet nn = solverNet(solver);
+      Vector * neurons = malloc(nn.size * sizeof(Vector));
+      long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+
+      if (!neurons)
+      {
+        perror("[ERROR] main :: malloc failed.");
+        exit(1);
+      }
+
+      #ifdef INFO
+      fprintf(stderr, "[INFO ] Rendering a poster of %lu x %lu pixels, %lu bytes.\n"
+                    , c.posterWidth, c.posterHeight, posterFootprint(c.posterWidth, nn.size, s.items));
+      #endif
+
+      neuralNetPositions(nn, neurons);
+
+      int error = posterDraw( s, bounds, neurons, nn.size
+                            , c.posterWidth, c.posterHeight
+                            , cpus > 0 ? cpus : 1, c.posterFile
+                            );
+
+      free(neurons);
+
+      if (error)
+        exit(1);
+    }
+
+    /* Visit the cities in the order of the ring */
+    if (c.tourFile || c.reportFile)
+    {
+      unsigned long * tour = malloc(cities.items * sizeof(unsigned long));
+
+      if (!tour)
+      {
+        perror("[ERROR] main :: malloc failed.");
+        exit(1);
+      }
+
+      /* solverTour reports why it failed */
+      if ((cityLength = solverTour(solver, tour)) < 0)
+        exit(1);
+
+      #ifdef INFO
+      fprintf(stderr, "[INFO ] Length of city tour : %lf.\n", cityLength);
+      #endif
+
+      if (c.tourFile)
+        tourWrite(c.tourFile, tour, cities.items);
+
+      free(tour);
+    }
+
+    if (c.reportFile)
+    {
+      clock_gettime(CLOCK_MONOTONIC, &end);
+      elapsed = diff(start, end);
+      writeReport( c, cities.items, s.items, solverNet(solver).size
+                 , elapsed.tv_sec + elapsed.tv_nsec / 1e9
+                 , netLength, cityLength
+                 );
+    }
+
+    /* All other threads have finished */
+    #ifdef INSTRUMENT
+    if (c.traceFile)
+      traceWrite(c.traceFile);
     #endif
 
     #ifdef DEBUG
@@ -233,14 +950,13 @@ int main(int argc, char * argv[])
     #endif
 
     /* Clean up... */
-    drawerCleanUp();
-    nn = neuralNetFree(nn);
-    s = sampleMapFree(s);
+    solver = solverFree(solver);
+    cities = sampleMapFree(cities);
   }
   else
     help(stderr);
 
-  clock_gettime(CLOCK_REALTIME, &end);
+  clock_gettime(CLOCK_MONOTONIC, &end);
   elapsed = diff(start, end);
 
   /* Print a summary */
@@ -250,5 +966,13 @@ int main(int argc, char * argv[])
                 , (elapsed.tv_nsec / 1000) % 1000
                 , elapsed.tv_nsec % 1000);
 
+  #ifdef INSTRUMENT
+  if (argc > 1)
+    instrumentPrint(stderr, (uint64_t) elapsed.tv_sec * 1000000000 + elapsed.tv_nsec);
+
+  instrumentCountersClose();
+  traceClose();
+  #endif
+
   return 0;
 }
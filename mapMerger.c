@@ -0,0 +1,208 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+/* -------------------------------------------------------------------------- */
+#include "mapMerger.h"
+/* -------------------------------------------------------------------------- */
+
+/* A city along with the key it is merged by */
+typedef struct {
+  Vector key;
+
+  unsigned long city;
+} MergeKey;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Orders merge keys lexicographically, cities with equal keys by index.
+ *
+ * @param[in] a  First merge key.
+ * @param[in] b  Second merge key.
+ *
+ * @return <0, 0 or >0 if a is less, equal or greater than b.
+ */
+static int mergeKeyCompare(const void * a, const void * b)
+{
+  const MergeKey * u = a
+               , * v = b
+               ;
+
+  if (u->key.x != v->key.x)
+    return u->key.x < v->key.x ? -1 : 1;
+
+  if (u->key.y != v->key.y)
+    return u->key.y < v->key.y ? -1 : 1;
+
+  return (u->city > v->city) - (u->city < v->city);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Merges cities that are coincident, or that fall into the same cell of a
+ * grid whose diagonal is epsilon, into weighted samples. The weight of a
+ * sample is the number of cities it stands for and its position is their
+ * centroid. Merged cities are at most epsilon apart, but cities closer than
+ * epsilon in neighbouring cells are not merged.
+ *
+ * @param[in]  s        The cities.
+ * @param[in]  epsilon  Diagonal of the grid cells, 0 for only merging
+ *                      coincident cities.
+ * @param[out] merge    Which cities have been merged into which sample.
+ *
+ * @return The merged sample map, or s itself if no cities have been merged.
+ */
+extern SampleMap mapMergerMerge(SampleMap s, double epsilon, MapMerge * merge)
+{
+  /* Cells with a diagonal of epsilon */
+  double cell = epsilon / M_SQRT2;
+
+  unsigned long groups = 0;
+
+  MergeKey * keys = malloc(s.items * sizeof(MergeKey));
+
+  SampleMap res;
+
+  merge->cities  = s.items;
+  merge->groups  = s.items;
+  merge->first   = NULL;
+  merge->members = NULL;
+
+  if (!keys)
+  {
+    perror("[ERROR] mapMergerMerge :: malloc failed.");
+    return s;
+  }
+
+  /* Sort the cities by their position or the cell they fall into */
+  for (unsigned long city = 0; city < s.items; ++city)
+  {
+    keys[city].city = city;
+    keys[city].key  = cell > 0
+                    ? vectorMake(floor(s.samples[city].x / cell), floor(s.samples[city].y / cell))
+                    : s.samples[city];
+  }
+
+  qsort(keys, s.items, sizeof(MergeKey), mergeKeyCompare);
+
+  for (unsigned long i = 0; i < s.items; ++i)
+    if (!i || keys[i].key.x != keys[i - 1].key.x || keys[i].key.y != keys[i - 1].key.y)
+      ++groups;
+
+  /* Nothing to merge, keep the sample map as it is */
+  if (groups == s.items)
+  {
+    free(keys);
+    return s;
+  }
+
+  res             = sampleMapMake(groups);
+  res.weights     = malloc(groups * sizeof(unsigned long));
+  merge->groups   = groups;
+  merge->first    = malloc((groups + 1) * sizeof(unsigned long));
+  merge->members  = malloc(s.items * sizeof(unsigned long));
+
+  if (!res.samples || !res.weights || !merge->first || !merge->members)
+  {
+    perror("[ERROR] mapMergerMerge :: malloc failed.");
+
+    free(keys);
+    res    = sampleMapFree(res);
+    *merge = mapMergerFree(*merge);
+
+    merge->cities = s.items;
+    merge->groups = s.items;
+
+    return s;
+  }
+
+  /* Every run of equal keys becomes one sample at the centroid of its cities */
+  for (unsigned long i = 0, j; i < s.items; i = j)
+  {
+    Vector sum = vectorMake(0, 0);
+
+    merge->first[res.items] = i;
+
+    for (j = i; j < s.items && keys[j].key.x == keys[i].key.x && keys[j].key.y == keys[i].key.y; ++j)
+    {
+      merge->members[j] = keys[j].city;
+      sum = vectorAdd(sum, s.samples[keys[j].city]);
+    }
+
+    res.weights[res.items] = j;
+    res = sampleMapPut(res, vectorScale(sum, 1.0 / (j - i)));
+  }
+
+  merge->first[groups] = s.items;
+
+  free(keys);
+
+  return res;
+}
+
+/**
+ * Expands a tour over merged samples into a tour over all cities. The cities
+ * that have been merged into a sample are visited one after another.
+ *
+ * @param[in]  merge  Which cities have been merged into which sample.
+ * @param[in]  tour   Tour over the merged samples.
+ * @param[out] res    Tour over all cities, with space for merge.cities entries.
+ */
+extern void mapMergerExpand(MapMerge merge, unsigned long * tour, unsigned long * res)
+{
+  unsigned long city = 0;
+
+  for (unsigned long i = 0; i < merge.groups; ++i)
+  {
+    if (!merge.first)
+      res[city++] = tour[i];
+    else
+      for (unsigned long j = merge.first[tour[i]]; j < merge.first[tour[i] + 1]; ++j)
+        res[city++] = merge.members[j];
+  }
+}
+
+/**
+ * Calculates the number of bytes a merge of the given number of cities into
+ * the given number of samples occupies, without the merged sample map.
+ *
+ * @param[in] cities  Number of cities before merging.
+ * @param[in] groups  Number of samples after merging.
+ *
+ * @return Memory footprint in bytes.
+ */
+extern unsigned long mapMergerFootprint(unsigned long cities, unsigned long groups)
+{
+  return sizeof(MapMerge) + (groups + 1 + cities) * sizeof(unsigned long);
+}
+
+/**
+ * Frees the memory used by the given merge.
+ *
+ * @param[in] merge  Merge that should be freed.
+ *
+ * @return Empty merge.
+ */
+extern MapMerge mapMergerFree(MapMerge merge)
+{
+  if (merge.first)
+    free(merge.first);
+
+  if (merge.members)
+    free(merge.members);
+
+  merge.cities  = 0;
+  merge.groups  = 0;
+  merge.first   = NULL;
+  merge.members = NULL;
+
+  return merge;
+}
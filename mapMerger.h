@@ -0,0 +1,76 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __MAP_MERGER_H__
+#define __MAP_MERGER_H__
+
+/* -------------------------------------------------------------------------- */
+#include "sampleMap.h"
+/* -------------------------------------------------------------------------- */
+
+/* Which cities have been merged into which sample */
+typedef struct {
+  /* Number of cities before merging */
+  unsigned long cities;
+
+  /* Number of samples after merging */
+  unsigned long groups;
+
+  /* Sample g consists of the cities members[first[g]] to members[first[g+1]-1] */
+  unsigned long * first;
+
+  /* The cities, grouped by the sample they have been merged into */
+  unsigned long * members;
+} MapMerge;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Merges cities that are coincident, or that fall into the same cell of a
+ * grid whose diagonal is epsilon, into weighted samples. The weight of a
+ * sample is the number of cities it stands for and its position is their
+ * centroid. Merged cities are at most epsilon apart, but cities closer than
+ * epsilon in neighbouring cells are not merged.
+ *
+ * @param[in]  s        The cities.
+ * @param[in]  epsilon  Diagonal of the grid cells, 0 for only merging
+ *                      coincident cities.
+ * @param[out] merge    Which cities have been merged into which sample.
+ *
+ * @return The merged sample map, or s itself if no cities have been merged.
+ */
+extern SampleMap mapMergerMerge(SampleMap s, double epsilon, MapMerge * merge);
+
+/**
+ * Expands a tour over merged samples into a tour over all cities. The cities
+ * that have been merged into a sample are visited one after another.
+ *
+ * @param[in]  merge  Which cities have been merged into which sample.
+ * @param[in]  tour   Tour over the merged samples.
+ * @param[out] res    Tour over all cities, with space for merge.cities entries.
+ */
+extern void mapMergerExpand(MapMerge merge, unsigned long * tour, unsigned long * res);
+
+/**
+ * Calculates the number of bytes a merge of the given number of cities into
+ * the given number of samples occupies, without the merged sample map.
+ *
+ * @param[in] cities  Number of cities before merging.
+ * @param[in] groups  Number of samples after merging.
+ *
+ * @return Memory footprint in bytes.
+ */
+extern unsigned long mapMergerFootprint(unsigned long cities, unsigned long groups);
+
+/**
+ * Frees the memory used by the given merge.
+ *
+ * @param[in] merge  Merge that should be freed.
+ *
+ * @return Empty merge.
+ */
+extern MapMerge mapMergerFree(MapMerge merge);
+
+#endif
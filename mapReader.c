@@ -6,64 +6,158 @@
 
 /* -------------------------------------------------------------------------- */
 #include <stdio.h>
+#include <stdint.h>
+#include <string.h>
 /* -------------------------------------------------------------------------- */
 #include "mapReader.h"
 /* -------------------------------------------------------------------------- */
 
 /**
- * Read the samples, i.e. city positions, from the given file name and return
- * them.
+ * Opens the given file and reads the number of samples in it. The format,
+ * text or binary, is detected from the first bytes. The file name "-" refers
+ * to stdin.
  *
  * @param[in] filename  File that contains the samples.
  *
- * @return SampleMap.
+ * @return The reader, with file set to NULL in case of an error.
  */
-extern SampleMap mapReaderRead(char * filename)
+extern MapReader mapReaderOpen(char * filename)
 {
-  /* Error and number of samples to read */
-  int error = 0
-    , n
-    ;
-
-  /* Sample position */
-  Vector p;
+  /* Error */
+  int error = 0;
 
   /* Dummies for parsing */
-  char space
-     , newline
+  char newline
+     , magic[sizeof(MAP_BINARY_MAGIC)] = { 0 }
      ;
 
-  /* Resulting sample map */
-  SampleMap res;
+  int first;
+  uint64_t items;
 
-  FILE * f = fopen(filename, "r");
-  error = !f;
+  MapReader res = { NULL, 0, 0, 0 };
+
+  res.file = strcmp(filename, "-") ? fopen(filename, "rb") : stdin;
+  error = !res.file;
 
-  /* Read number of samples */
   if (error)
     fprintf(stderr, "mapReaderRead :: Error opening file %s\n.", filename);
+
+  /* Text files start with the number of samples, binary files with the magic */
+  else if ((first = getc(res.file)) == MAP_BINARY_MAGIC[0])
+  {
+    magic[0]   = first;
+    res.binary = 1;
+    error      = fread(magic + 1, 1, sizeof(magic) - 2, res.file) != sizeof(magic) - 2
+              || strcmp(magic, MAP_BINARY_MAGIC)
+              || fread(&items, sizeof(items), 1, res.file) != 1;
+    res.items  = items;
+  }
+
+  /* Read number of samples */
   else
-    error = fscanf(f, "%i%c", &n, &newline) != 2 || newline != '\n';
+    error = ungetc(first, res.file) == EOF
+         || fscanf(res.file, "%lu%c", &res.items, &newline) != 2
+         || newline != '\n';
 
-  /* Create sample map for the given number of samples */
   if (error)
+  {
     fprintf(stderr, "mapReaderRead :: Error reading sample count.\n");
+    res = mapReaderClose(res);
+  }
+
+  return res;
+}
+
+/**
+ * Reads the next sample from the file.
+ *
+ * @param[in,out] reader  The reader.
+ * @param[out]    p       The sample.
+ *
+ * @return 0 on success, 1 if there are no more samples or in case of an error.
+ */
+extern int mapReaderNext(MapReader * reader, Vector * p)
+{
+  /* Error */
+  int error = reader->read >= reader->items;
+
+  /* Dummies for parsing */
+  char space
+     , newline
+     ;
+
+  if (!error && reader->binary)
+    error = fread(p, sizeof(Vector), 1, reader->file) != 1;
+
+  else if (!error)
+    error = fscanf(reader->file, "%lf%c%lf%c", &p->x, &space, &p->y, &newline) != 4
+          || space != ' '
+          || newline != '\n';
+
+  if (error)
+    fprintf(stderr, "mapReaderRead :: Error reading sample %lu.\n", reader->read);
   else
-    res = sampleMapMake(n);
+    ++reader->read;
+
+  return error;
+}
+
+/**
+ * Closes the file of the given reader.
+ *
+ * @param[in] reader  The reader.
+ *
+ * @return The closed reader.
+ */
+extern MapReader mapReaderClose(MapReader reader)
+{
+  if (reader.file && reader.file != stdin)
+    fclose(reader.file);
+
+  reader.file = NULL;
+
+  return reader;
+}
+
+/**
+ * Read the samples, i.e. city positions, from the given file name and return
+ * them.
+ *
+ * @param[in] filename  File that contains the samples.
+ *
+ * @return SampleMap.
+ */
+extern SampleMap mapReaderRead(char * filename)
+{
+  /* Sample position */
+  Vector p;
+
+  MapReader reader = mapReaderOpen(filename);
+
+  /* Error */
+  int error = !reader.file;
+
+  /* Resulting sample map */
+  SampleMap res = { 0, 0, NULL, NULL };
+
+  /* Create sample map for the given number of samples */
+  if (!error)
+  {
+    res   = sampleMapMake(reader.items);
+    error = !res.samples && reader.items;
+  }
 
   /* Read the samples and put them into the sample map */
-  for (int i = 0; i < n && !error; ++i)
+  while (!error && reader.read < reader.items)
   {
-    error = fscanf(f, "%lf%c%lf%c", &p.x, &space, &p.y, &newline) != 4
-          || space != ' '
-          || newline != '\n';
+    error = mapReaderNext(&reader, &p);
 
-    if (error)
-      fprintf(stderr, "mapReaderRead :: Error reading sample %i.\n", i);
-    else
+    if (!error)
       res = sampleMapPut(res, p);
   }
 
+  reader = mapReaderClose(reader);
+
   /* Clear allocated memory in case of an error */
   if (error)
     res = sampleMapFree(res);
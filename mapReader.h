@@ -6,10 +6,69 @@
 #ifndef __MAP_READER_H__
 #define __MAP_READER_H__
 
+/* -------------------------------------------------------------------------- */
+#include <stdio.h>
 /* -------------------------------------------------------------------------- */
 #include "sampleMap.h"
+#include "vector.h"
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Binary instance files start with this magic, followed by the number of
+ * samples as a 64 bit integer and the samples as pairs of doubles, all in the
+ * byte order of the machine.
+ */
+#define MAP_BINARY_MAGIC "TSPB"
+
+/* -------------------------------------------------------------------------- */
+
+/* An instance file that is being read */
+typedef struct {
+  /* The file, NULL if it could not be opened */
+  FILE * file;
+
+  /* Whether the file is in the binary format */
+  int binary;
+
+  /* Number of samples in the file */
+  unsigned long items;
+
+  /* Number of samples read so far */
+  unsigned long read;
+} MapReader;
+
 /* -------------------------------------------------------------------------- */
 
+/**
+ * Opens the given file and reads the number of samples in it. The format,
+ * text or binary, is detected from the first bytes. The file name "-" refers
+ * to stdin.
+ *
+ * @param[in] filename  File that contains the samples.
+ *
+ * @return The reader, with file set to NULL in case of an error.
+ */
+extern MapReader mapReaderOpen(char * filename);
+
+/**
+ * Reads the next sample from the file.
+ *
+ * @param[in,out] reader  The reader.
+ * @param[out]    p       The sample.
+ *
+ * @return 0 on success, 1 if there are no more samples or in case of an error.
+ */
+extern int mapReaderNext(MapReader * reader, Vector * p);
+
+/**
+ * Closes the file of the given reader.
+ *
+ * @param[in] reader  The reader.
+ *
+ * @return The closed reader.
+ */
+extern MapReader mapReaderClose(MapReader reader);
+
  /**
   * Read the samples, i.e. city positions, from the given file name and return
   * them.
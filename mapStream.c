@@ -0,0 +1,284 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+/* -------------------------------------------------------------------------- */
+#include "mapStream.h"
+#include "mapReader.h"
+#include "instrument.h"
+#include "trace.h"
+/* -------------------------------------------------------------------------- */
+
+/* Number of samples that are read before they are handed to the trainer */
+#define MAP_STREAM_BATCH (1024)
+
+/* -------------------------------------------------------------------------- */
+
+struct MapStreamData {
+  MapReader reader;
+
+  /* The samples, allocated for all samples in the file up front */
+  SampleMap samples;
+
+  /* Number of samples the trainer may use, written by the reader thread only */
+  unsigned long published;
+
+  /* Bounding box around the published samples */
+  PositionBounds bounds;
+
+  int done
+    , error
+    ;
+
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t arrived;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Makes the samples that have been read so far available to the trainer.
+ *
+ * @param[in] stream  The stream.
+ * @param[in] bounds  Bounding box around the samples read so far.
+ * @param[in] done    Whether reading has finished.
+ */
+static void mapStreamPublish(MapStream stream, PositionBounds bounds, int done)
+{
+  pthread_mutex_lock(&stream->lock);
+
+  stream->bounds = bounds;
+  __atomic_store_n(&stream->done, done, __ATOMIC_RELEASE);
+  __atomic_store_n(&stream->published, stream->samples.items, __ATOMIC_RELEASE);
+
+  pthread_cond_broadcast(&stream->arrived);
+  pthread_mutex_unlock(&stream->lock);
+}
+
+/**
+ * Reads the samples and publishes them batch by batch.
+ *
+ * @param[in] arg  The stream.
+ *
+ * @return NULL.
+ */
+static void * mapStreamRun(void * arg)
+{
+  MapStream stream = arg;
+
+  PositionBounds bounds;
+  Vector p;
+
+  #ifdef INSTRUMENT
+  uint64_t batch = instrumentNow();
+  traceThreadName("reader");
+  #endif
+
+  while (!stream->error && stream->reader.read < stream->reader.items)
+  {
+    stream->error = mapReaderNext(&stream->reader, &p);
+
+    if (stream->error)
+      break;
+
+    /* Only this thread writes beyond the published samples */
+    stream->samples.samples[stream->samples.items++] = p;
+
+    if (stream->samples.items == 1)
+    {
+      bounds.topleft     = p;
+      bounds.bottomright = p;
+    }
+    else
+    {
+      if (p.x < bounds.topleft.x)     bounds.topleft.x     = p.x;
+      if (p.y < bounds.topleft.y)     bounds.topleft.y     = p.y;
+      if (p.x > bounds.bottomright.x) bounds.bottomright.x = p.x;
+      if (p.y > bounds.bottomright.y) bounds.bottomright.y = p.y;
+    }
+
+    if (!(stream->samples.items % MAP_STREAM_BATCH))
+    {
+      mapStreamPublish(stream, bounds, 0);
+
+      #ifdef INSTRUMENT
+      batch = traceSpan("read", batch);
+      #endif
+    }
+  }
+
+  stream->reader = mapReaderClose(stream->reader);
+
+  mapStreamPublish(stream, stream->samples.items ? bounds : stream->bounds, 1);
+
+  #ifdef INSTRUMENT
+  traceSpan("read", batch);
+  #endif
+
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens the given file, reads the number of samples in it and starts a thread
+ * that reads the samples in the background. The file name "-" refers to stdin.
+ *
+ * @param[in] filename  File that contains the samples.
+ *
+ * @return The stream, NULL in case of an error.
+ */
+extern MapStream mapStreamOpen(char * filename)
+{
+  MapStream stream = calloc(1, sizeof(*stream));
+
+  if (!stream)
+  {
+    perror("[ERROR] mapStreamOpen :: malloc failed.");
+    return NULL;
+  }
+
+  stream->reader = mapReaderOpen(filename);
+
+  if (!stream->reader.file)
+  {
+    free(stream);
+    return NULL;
+  }
+
+  stream->samples = sampleMapMake(stream->reader.items);
+
+  if (!stream->samples.samples)
+  {
+    stream->reader = mapReaderClose(stream->reader);
+    free(stream);
+    return NULL;
+  }
+
+  pthread_mutex_init(&stream->lock, NULL);
+  pthread_cond_init(&stream->arrived, NULL);
+
+  if (pthread_create(&stream->thread, NULL, mapStreamRun, stream))
+  {
+    perror("[ERROR] mapStreamOpen :: pthread_create failed.");
+
+    stream->reader  = mapReaderClose(stream->reader);
+    stream->samples = sampleMapFree(stream->samples);
+    pthread_cond_destroy(&stream->arrived);
+    pthread_mutex_destroy(&stream->lock);
+    free(stream);
+
+    return NULL;
+  }
+
+  return stream;
+}
+
+/**
+ * Returns the total number of samples the stream will deliver.
+ *
+ * @param[in] stream  The stream.
+ *
+ * @return Number of samples in the file.
+ */
+extern unsigned long mapStreamSize(MapStream stream)
+{
+  return stream->samples.size;
+}
+
+/**
+ * Blocks until at least one sample has arrived or the stream is done.
+ *
+ * @param[in] stream  The stream.
+ */
+extern void mapStreamWait(MapStream stream)
+{
+  pthread_mutex_lock(&stream->lock);
+
+  while (!stream->published && !stream->done)
+    pthread_cond_wait(&stream->arrived, &stream->lock);
+
+  pthread_mutex_unlock(&stream->lock);
+}
+
+/**
+ * Returns the samples that have arrived so far. The samples remain valid until
+ * the stream is closed, later calls return more of them.
+ *
+ * @param[in] stream  The stream.
+ *
+ * @return Sample map containing the samples that have arrived.
+ */
+extern SampleMap mapStreamSamples(MapStream stream)
+{
+  SampleMap res;
+
+  /* The reader thread goes on counting items, so take only the published ones */
+  res.size    = stream->samples.size;
+  res.samples = stream->samples.samples;
+  res.weights = stream->samples.weights;
+  res.items   = __atomic_load_n(&stream->published, __ATOMIC_ACQUIRE);
+
+  return res;
+}
+
+/**
+ * Returns the bounding box around the samples that have arrived so far.
+ *
+ * @param[in] stream  The stream.
+ *
+ * @return Bounding box.
+ */
+extern PositionBounds mapStreamBounds(MapStream stream)
+{
+  PositionBounds res;
+
+  pthread_mutex_lock(&stream->lock);
+  res = stream->bounds;
+  pthread_mutex_unlock(&stream->lock);
+
+  return res;
+}
+
+/**
+ * Checks whether all samples have arrived, or reading them has failed.
+ *
+ * @param[in] stream  The stream.
+ *
+ * @return 1 if the stream is done, 0 otherwise.
+ */
+extern int mapStreamDone(MapStream stream)
+{
+  return __atomic_load_n(&stream->done, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Waits for the background thread to finish and closes the stream.
+ *
+ * @param[in]  stream  The stream.
+ * @param[out] s       All samples, owned by the caller from now on.
+ *
+ * @return 0 if all samples have been read, 1 in case of an error.
+ */
+extern int mapStreamClose(MapStream stream, SampleMap * s)
+{
+  int error;
+
+  pthread_join(stream->thread, NULL);
+
+  *s    = stream->samples;
+  error = stream->error;
+
+  pthread_cond_destroy(&stream->arrived);
+  pthread_mutex_destroy(&stream->lock);
+  free(stream);
+
+  return error;
+}
@@ -0,0 +1,83 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __MAP_STREAM_H__
+#define __MAP_STREAM_H__
+
+/* -------------------------------------------------------------------------- */
+#include "neuralNet.h"
+#include "sampleMap.h"
+/* -------------------------------------------------------------------------- */
+
+/* Samples that are read in the background while training already runs */
+typedef struct MapStreamData * MapStream;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens the given file, reads the number of samples in it and starts a thread
+ * that reads the samples in the background. The file name "-" refers to stdin.
+ *
+ * @param[in] filename  File that contains the samples.
+ *
+ * @return The stream, NULL in case of an error.
+ */
+extern MapStream mapStreamOpen(char * filename);
+
+/**
+ * Returns the total number of samples the stream will deliver.
+ *
+ * @param[in] stream  The stream.
+ *
+ * @return Number of samples in the file.
+ */
+extern unsigned long mapStreamSize(MapStream stream);
+
+/**
+ * Blocks until at least one sample has arrived or the stream is done.
+ *
+ * @param[in] stream  The stream.
+ */
+extern void mapStreamWait(MapStream stream);
+
+/**
+ * Returns the samples that have arrived so far. The samples remain valid until
+ * the stream is closed, later calls return more of them.
+ *
+ * @param[in] stream  The stream.
+ *
+ * @return Sample map containing the samples that have arrived.
+ */
+extern SampleMap mapStreamSamples(MapStream stream);
+
+/**
+ * Returns the bounding box around the samples that have arrived so far.
+ *
+ * @param[in] stream  The stream.
+ *
+ * @return Bounding box.
+ */
+extern PositionBounds mapStreamBounds(MapStream stream);
+
+/**
+ * Checks whether all samples have arrived, or reading them has failed.
+ *
+ * @param[in] stream  The stream.
+ *
+ * @return 1 if the stream is done, 0 otherwise.
+ */
+extern int mapStreamDone(MapStream stream);
+
+/**
+ * Waits for the background thread to finish and closes the stream.
+ *
+ * @param[in]  stream  The stream.
+ * @param[out] s       All samples, owned by the caller from now on.
+ *
+ * @return 0 if all samples have been read, 1 in case of an error.
+ */
+extern int mapStreamClose(MapStream stream, SampleMap * s);
+
+#endif
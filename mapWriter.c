@@ -0,0 +1,59 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+/* -------------------------------------------------------------------------- */
+#include "mapWriter.h"
+#include "mapReader.h"
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Writes the samples, i.e. city positions, to the given file, either in the
+ * text format or in the binary format understood by mapReaderRead. The file
+ * name "-" refers to stdout.
+ *
+ * @param[in] filename  Output filename.
+ * @param[in] s         The samples.
+ * @param[in] binary    Whether to write the binary format.
+ *
+ * @return 0 on success, 1 otherwise.
+ */
+extern int mapWriterWrite(char * filename, SampleMap s, int binary)
+{
+  int error = 0;
+
+  uint64_t items = s.items;
+
+  FILE * f = strcmp(filename, "-") ? fopen(filename, binary ? "wb" : "w") : stdout;
+
+  if (!f)
+  {
+    fprintf(stderr, "mapWriterWrite :: Error opening file %s.\n", filename);
+    return 1;
+  }
+
+  if (binary)
+    error = fwrite(MAP_BINARY_MAGIC, 1, sizeof(MAP_BINARY_MAGIC) - 1, f) != sizeof(MAP_BINARY_MAGIC) - 1
+         || fwrite(&items, sizeof(items), 1, f) != 1
+         || fwrite(s.samples, sizeof(Vector), s.items, f) != s.items;
+  else
+  {
+    error = fprintf(f, "%lu\n", s.items) < 0;
+
+    for (unsigned long i = 0; i < s.items && !error; ++i)
+      error = fprintf(f, "%.17g %.17g\n", s.samples[i].x, s.samples[i].y) < 0;
+  }
+
+  error |= f == stdout ? fflush(f) != 0 : fclose(f) != 0;
+
+  if (error)
+    fprintf(stderr, "mapWriterWrite :: Error writing file %s.\n", filename);
+
+  return error;
+}
@@ -0,0 +1,26 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __MAP_WRITER_H__
+#define __MAP_WRITER_H__
+
+/* -------------------------------------------------------------------------- */
+#include "sampleMap.h"
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Writes the samples, i.e. city positions, to the given file, either in the
+ * text format or in the binary format understood by mapReaderRead. The file
+ * name "-" refers to stdout.
+ *
+ * @param[in] filename  Output filename.
+ * @param[in] s         The samples.
+ * @param[in] binary    Whether to write the binary format.
+ *
+ * @return 0 on success, 1 otherwise.
+ */
+extern int mapWriterWrite(char * filename, SampleMap s, int binary);
+
+#endif
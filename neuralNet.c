@@ -7,12 +7,14 @@
 /* -------------------------------------------------------------------------- */
 #include <stdlib.h>
 #include <stdio.h>
+#include <string.h>
 #include <assert.h>
 #include <time.h>
 #include <math.h>
 #include <float.h>
 /* -------------------------------------------------------------------------- */
 #include "neuralNet.h"
+#include "instrument.h"
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -68,14 +70,17 @@ static int neuralNetInv(NeuralNet neuralNet)
 /**
  * Creates a neuron and returns it.
  *
- * @return Neuron.
+ * @return Neuron, NULL if it could not be allocated.
  */
 static Neuron neuronMake()
 {
   Neuron res = malloc(sizeof(*res));
 
   if (!res)
-    perror("neuronMake :: malloc failed.");
+  {
+    perror("[ERROR] neuronMake :: malloc failed.");
+    return NULL;
+  }
 
   /* The neuron has not been activated yet */
   res->hits = 0;
@@ -88,15 +93,14 @@ static Neuron neuronMake()
  *
  * @param[in] neuron  Neuron after which the new neuron should be inserted.
  *
- * @return The newly created neuron.
+ * @return The newly created neuron, NULL if it could not be allocated.
  */
 static Neuron neuronInsert(Neuron neuron)
 {
   Neuron newNeuron = neuronMake();
 
-  #ifdef DEBUG
-  fprintf(stderr, "[DEBUG] Adding Neuron at (%.2lf, %.2lf).\n", neuron->p.x, neuron->p.y);
-  #endif
+  if (!newNeuron)
+    return NULL;
 
   neuron->hits = 0;
 
@@ -126,10 +130,6 @@ static Neuron neuronInsert(Neuron neuron)
  */
 static Neuron neuronRemoveNext(Neuron neuron)
 {
-  #ifdef DEBUG
-  fprintf(stderr, "[DEBUG] Removing Neuron at (%.2lf, %.2lf).\n", neuron->p.x, neuron->p.y);
-  #endif
-
   Neuron tmp = neuron->next;
 
   /* Update neighbourhood */
@@ -142,67 +142,85 @@ static Neuron neuronRemoveNext(Neuron neuron)
 }
 
 /**
- * Let's the neural net grow by creating new neurons.
+ * Free the memory that is used bei the given neuron and its successors.
  *
- * @param[in] neuralNet      Neural net that should grow.
- * @param[in] growThreshold  Defines how often a neuron must have been activated
- *                           in order to grow new neighbouring neurons.
+ * @param[in] neuron  Neuron that should be freed.
  *
- * @return New neural net after growing new neurons.
+ * @return NULL.
  */
-static NeuralNet neuralNetGrow(NeuralNet neuralNet, double growThreshold)
+static Neuron neuronsFree(Neuron neuron)
 {
-  Neuron neuron = neuralNet.neurons;
+  Neuron tmp;
 
-  /**
-   * Insert a new neuron if the current neuron has been activated enough times.
-   * Continue with all other neurons thereafter.
-   */
-  if (neuron->hits >= growThreshold)
+  /* Iteratively, nets with millions of neurons would overflow the stack */
+  while (neuron)
   {
-    neuron = neuronInsert(neuron);
-    ++neuralNet.size;
+    tmp    = neuron;
+    neuron = neuron->next;
+
+    free(tmp);
   }
 
-  neuron = neuron->next;
+  return NULL;
+}
 
-  /* Grow neighbouring neurons for the rest of the neurons */
-  while (neuron != neuralNet.neurons)
+/**
+ * Makes room in the arrays of the net for the given number of neurons.
+ *
+ * @param[in,out] neuralNet  Neural net.
+ * @param[in]     size       Number of neurons the arrays must hold.
+ *
+ * @return 0 on success, 1 if memory could not be allocated. The arrays keep
+ *         their contents either way.
+ */
+static int neuralNetReserve(NeuralNet * neuralNet, unsigned long size)
+{
+  if (size <= neuralNet->capacity)
+    return 0;
+
+  /* Growing at most doubles the net */
+  unsigned long capacity = size > 2 * neuralNet->capacity ? size : 2 * neuralNet->capacity;
+
+  Vector * positions = realloc(neuralNet->positions, capacity * sizeof(Vector));
+  if (positions)
+    neuralNet->positions = positions;
+
+  Neuron * ring = realloc(neuralNet->ring, capacity * sizeof(Neuron));
+  if (ring)
+    neuralNet->ring = ring;
+
+  if (!positions || !ring)
   {
-    if (neuron->hits >= growThreshold)
-    {
-      neuron = neuronInsert(neuron);
-      ++neuralNet.size;
-    }
-    else
-    {
-      neuron = neuron->next;
-    }
+    perror("[ERROR] neuralNetReserve :: realloc failed.");
+    return 1;
   }
 
-  neuralNet.learned = 0;
-
-  /* The neural net must remain valid after growing */
-  assert(neuralNetInv(neuralNet));
+  neuralNet->capacity = capacity;
 
-  return neuralNet;
+  return 0;
 }
 
 /**
- * Recursively free the memory that is used bei the given neuron and its successors.
+ * Numbers the neurons along the ring, starting with neuralNet.neurons, and
+ * copies them and their positions into the arrays of the net, which must have
+ * room for all neurons.
  *
- * @param[in] neuron  Neuron that should be freed.
+ * @param[in] neuralNet  Neural net whose ring has changed.
  *
- * @return NULL.
+ * @return Neural net with arrays that match the ring.
  */
-static Neuron neuronsFree(Neuron neuron)
+static NeuralNet neuralNetIndex(NeuralNet neuralNet)
 {
-  if (neuron->next)
-    neuronsFree(neuron->next);
+  Neuron neuron = neuralNet.neurons;
 
-  free(neuron);
+  for (unsigned long i = 0; i < neuralNet.size; ++i, neuron = neuron->next)
+  {
+    neuron->index          = i;
+    neuralNet.positions[i] = neuron->p;
+    neuralNet.ring[i]      = neuron;
+  }
 
-  return NULL;
+  return neuralNet;
 }
 
 /* -------------------------------------------------------------------------- */
@@ -211,11 +229,13 @@ static Neuron neuronsFree(Neuron neuron)
  * Creates a neural net with exactly one neuron. The single neuron of the net
  * is positioned in the middle of the region given by bounds.
  *
- * @param[in] bounds  Bounding box for the neural net.
+ * @param[in] bounds   Bounding box for the neural net.
+ * @param[in] maxSize  Maximum number of neurons the net may grow to.
  *
- * @return Neural net with one neuron.
+ * @return Neural net with one neuron, or without neurons if it could not be
+ *         allocated.
  */
-extern NeuralNet neuralNetMake(PositionBounds bounds)
+extern NeuralNet neuralNetMake(PositionBounds bounds, unsigned long maxSize)
 {
   /* Create the neural net */
   NeuralNet neuralNet;
@@ -223,6 +243,20 @@ extern NeuralNet neuralNetMake(PositionBounds bounds)
 
   neuralNet.size    = 1;
   neuralNet.learned = 0;
+  neuralNet.maxSize = maxSize;
+  neuralNet.error   = 0.0;
+
+  neuralNet.positions = NULL;
+  neuralNet.ring      = NULL;
+  neuralNet.capacity  = 0;
+  neuralNet.failed    = 0;
+
+  if (!neuron)
+  {
+    neuralNet.size    = 0;
+    neuralNet.neurons = NULL;
+    return neuralNet;
+  }
 
   /* Initialise neuron */
   neuron->p = vectorAdd( bounds.topleft
@@ -238,7 +272,87 @@ extern NeuralNet neuralNetMake(PositionBounds bounds)
 
   neuralNet.neurons = neuron;
 
-  return neuralNet;
+  if (neuralNetReserve(&neuralNet, 1))
+    return neuralNetFree(neuralNet);
+
+  return neuralNetIndex(neuralNet);
+}
+
+/**
+ * Creates a neural net whose neurons are at the given positions, connected in
+ * the given order.
+ *
+ * @param[in] positions  Positions of the neurons along the ring.
+ * @param[in] n          Number of neurons, at least 1.
+ * @param[in] maxSize    Maximum number of neurons the net may grow to.
+ *
+ * @return Neural net with n neurons, or without neurons if they could not be
+ *         allocated.
+ */
+extern NeuralNet neuralNetMakeFrom(Vector * positions, unsigned long n, unsigned long maxSize)
+{
+  NeuralNet neuralNet;
+  Neuron neuron = neuronMake();
+
+  assert(n > 0);
+
+  neuralNet.size    = n;
+  neuralNet.learned = 0;
+  neuralNet.maxSize = maxSize;
+  neuralNet.error   = 0.0;
+  neuralNet.neurons = neuron;
+
+  neuralNet.positions = NULL;
+  neuralNet.ring      = NULL;
+  neuralNet.capacity  = 0;
+  neuralNet.failed    = 0;
+
+  if (!neuron)
+  {
+    neuralNet.size = 0;
+    return neuralNet;
+  }
+
+  neuron->p    = positions[0];
+  neuron->next = neuron;
+  neuron->prev = neuron;
+
+  /* Insert the remaining neurons after the last one */
+  for (unsigned long i = 1; i < n; ++i)
+  {
+    Neuron newNeuron = neuronMake();
+
+    if (!newNeuron)
+      return neuralNetFree(neuralNet);
+
+    newNeuron->p          = positions[i];
+    newNeuron->next       = neuron->next;
+    newNeuron->prev       = neuron;
+    newNeuron->next->prev = newNeuron;
+    neuron->next          = newNeuron;
+
+    neuron = newNeuron;
+  }
+
+  assert(neuralNetInv(neuralNet));
+
+  if (neuralNetReserve(&neuralNet, n))
+    return neuralNetFree(neuralNet);
+
+  return neuralNetIndex(neuralNet);
+}
+
+/**
+ * Calculates the number of bytes a neural net with the given number of neurons
+ * occupies.
+ *
+ * @param[in] size  Number of neurons.
+ *
+ * @return Memory footprint in bytes.
+ */
+extern unsigned long neuralNetFootprint(unsigned long size)
+{
+  return sizeof(NeuralNet) + size * (sizeof(struct NeuronData) + sizeof(Vector) + sizeof(Neuron));
 }
 
 /**
@@ -258,11 +372,123 @@ extern NeuralNet neuralNetFree(NeuralNet neuralNet)
     neuronsFree(neuralNet.neurons);
   }
 
-  neuralNet.neurons = NULL;
+  free(neuralNet.positions);
+  free(neuralNet.ring);
+
+  neuralNet.neurons   = NULL;
+  neuralNet.positions = NULL;
+  neuralNet.ring      = NULL;
+  neuralNet.capacity  = 0;
 
   return neuralNet;
 }
 
+/**
+ * Let's the neural net grow by creating new neurons, but never beyond its
+ * maximum size.
+ *
+ * @param[in] neuralNet      Neural net that should grow.
+ * @param[in] growThreshold  Defines how often a neuron must have been activated
+ *                           in order to grow new neighbouring neurons.
+ *
+ * @return New neural net after growing new neurons. If memory runs out, failed
+ *         is set and the net keeps the neurons grown so far.
+ */
+extern NeuralNet neuralNetGrow(NeuralNet neuralNet, double growThreshold)
+{
+  Neuron neuron = neuralNet.neurons
+       , inserted
+       ;
+  unsigned long neurons = neuralNet.size;
+
+  /* Growing at most doubles the net. Making room first leaves the net as it
+     was if memory runs out. */
+  if (neuralNetReserve(&neuralNet, 2 * neurons < neuralNet.maxSize ? 2 * neurons : neuralNet.maxSize))
+  {
+    neuralNet.failed = 1;
+    return neuralNet;
+  }
+
+  /**
+   * Insert a new neuron after every neuron that has been activated enough
+   * times, until the net has reached its maximum size.
+   */
+  for (; neurons > 0 && neuralNet.size < neuralNet.maxSize; --neurons)
+  {
+    if (neuron->hits >= growThreshold)
+    {
+      if (!(inserted = neuronInsert(neuron)))
+      {
+        neuralNet.failed = 1;
+        break;
+      }
+
+      neuron = inserted;
+      ++neuralNet.size;
+    }
+
+    neuron = neuron->next;
+  }
+
+  neuralNet.learned = 0;
+
+  /* The neural net must remain valid after growing */
+  assert(neuralNetInv(neuralNet));
+
+  return neuralNetIndex(neuralNet);
+}
+
+/**
+ * Finds the neuron that is closest to the given sample, i.e. the best matching
+ * unit.
+ *
+ * @param[in] neuralNet  Neural net.
+ * @param[in] sample     The sample.
+ *
+ * @return The neuron closest to sample.
+ */
+extern Neuron neuralNetNearest(NeuralNet neuralNet, Vector sample)
+{
+  return neuralNet.ring[vectorNearest(sample, neuralNet.positions, neuralNet.size)];
+}
+
+/**
+ * Moves the activated neuron and its neighbours towards the sample. How far a
+ * neuron moves depends on its distance to the activated neuron along the ring
+ * and on the progression of training time.
+ *
+ * @param[in] neuralNet      Neural net.
+ * @param[in] nearestNeuron  The activated neuron.
+ * @param[in] sample         The sample.
+ * @param[in] time           Progression of training time, used for learning rate decay.
+ */
+extern void neuralNetAdapt(NeuralNet neuralNet, Neuron nearestNeuron, Vector sample, double time)
+{
+  unsigned long size = neuralNet.size
+              , moved
+              ;
+  double rates[2 * SPREAD + 1];
+
+  for (int i = -SPREAD; i <= SPREAD; ++i)
+    rates[i + SPREAD] = NEURONMOVE(abs(i), time);
+
+  /* The neurons from SPREAD + 1 before the activated one on, in one piece
+     unless they wrap around the end of the arrays */
+  unsigned long first = (nearestNeuron->index + (SPREAD + 1) * (size - 1)) % size;
+
+  for (unsigned long i = 0; i < 2 * SPREAD + 1; i += moved)
+  {
+    unsigned long start = (first + i) % size;
+
+    moved = size - start < 2 * SPREAD + 1 - i ? size - start : 2 * SPREAD + 1 - i;
+
+    vectorToward(neuralNet.positions + start, moved, sample, rates + i);
+
+    for (unsigned long j = start; j < start + moved; ++j)
+      neuralNet.ring[j]->p = neuralNet.positions[j];
+  }
+}
+
 /**
  * Trains the neural net based on the given samples. Time states how much time
  * of the learning has passed already and is used for learning rate decay.
@@ -270,57 +496,37 @@ extern NeuralNet neuralNetFree(NeuralNet neuralNet)
  * @param[in] neuralNet  Neural net that should be trained.
  * @param[in] samples    The samples that should be used for training.
  * @param[in] time       Progression of training time, used for learning rate decay.
+ * @param[in] rng        Random number generator that picks the samples.
  *
  * @return Neural net after training.
  */
-extern NeuralNet neuralNetTrain(NeuralNet neuralNet, SampleMap samples, double time)
+extern NeuralNet neuralNetTrain(NeuralNet neuralNet, SampleMap samples, double time, Rng * rng)
 {
   /* Pick a sample, this is where it gets "nondeterministic" */
-  Vector sample = samples.samples[random() % samples.items];
+  Vector sample = samples.samples[sampleMapPick(samples, rngIndex(rng, sampleMapWeight(samples)))];
 
   /* Find closest neuron */
-  Neuron currentNeuron = neuralNet.neurons
-       , nearestNeuron = neuralNet.neurons
-       ;
-  double distance = vectorLength(vectorSub(currentNeuron->p, sample))
-       , tmp
-       ;
-
-  for (unsigned i = 0; i < neuralNet.size; ++i, currentNeuron = currentNeuron->next)
-    if ((tmp = vectorLength(vectorSub(sample, currentNeuron->p))) < distance)
-    {
-      nearestNeuron = currentNeuron;
-      distance      = tmp;
-    }
+  instrumentIterationBegin(bmu);
+  Neuron nearestNeuron = neuralNetNearest(neuralNet, sample);
+  instrumentIterationEnd(PHASE_BMU, bmu);
 
   /* Mark nearest neuron as activated */
   ++nearestNeuron->hits;
-  currentNeuron = nearestNeuron;
-  for (int i = 0; i <= SPREAD + 1; ++i)
-    currentNeuron = currentNeuron->prev;
+  neuralNet.error += vectorLength(vectorSub(sample, nearestNeuron->p));
 
   /* Let the activated neuron and its neighbours learn */
-  for (int i = -SPREAD; i <= SPREAD; ++i)
-  {
-    currentNeuron = currentNeuron->next;
-
-    currentNeuron->p = vectorAdd( currentNeuron->p
-                                , vectorScale( vectorSub( sample
-                                                        , currentNeuron->p
-                                                        )
-                                             , NEURONMOVE( fabs(i)
-                                                         , time
-                                                         )
-                                             )
-                                );
-  }
+  instrumentIterationBegin(update);
+  neuralNetAdapt(neuralNet, nearestNeuron, sample, time);
+  instrumentIterationEnd(PHASE_UPDATE, update);
 
   ++neuralNet.learned;
 
-  if (neuralNet.size < log(samples.items) * samples.items
+  if (neuralNet.size < neuralNet.maxSize && !neuralNet.failed
    && neuralNet.learned >= neuralNetLearnAfter(samples.items))
   {
+    instrumentBegin(grow);
     neuralNet = neuralNetGrow(neuralNet, neuralNetGrowThres(samples.items));
+    instrumentEnd(PHASE_GROW, grow);
   }
 
   return neuralNet;
@@ -336,6 +542,8 @@ extern NeuralNet neuralNetTrain(NeuralNet neuralNet, SampleMap samples, double t
  */
 extern NeuralNet neuralNetRemoveDoubleNeurons(NeuralNet neuralNet)
 {
+  instrumentBegin(prune);
+
   Neuron neuron = neuralNet.neurons;
 
   /**
@@ -367,6 +575,10 @@ extern NeuralNet neuralNetRemoveDoubleNeurons(NeuralNet neuralNet)
 
   assert(neuralNetInv(neuralNet));
 
+  neuralNet = neuralNetIndex(neuralNet);
+
+  instrumentEnd(PHASE_PRUNE, prune);
+
   return neuralNet;
 }
 
@@ -390,6 +602,18 @@ extern double neuralNetLength(NeuralNet neuralNet)
   return res;
 }
 
+/**
+ * Copies the positions of the neurons in the order of the ring, starting with
+ * neuralNet.neurons.
+ *
+ * @param[in]  neuralNet  Neural net.
+ * @param[out] positions  Space for neuralNet.size positions.
+ */
+extern void neuralNetPositions(NeuralNet neuralNet, Vector * positions)
+{
+  memcpy(positions, neuralNet.positions, neuralNet.size * sizeof(Vector));
+}
+
 /**
  * Prints information about the given neural network on stream.
  *
@@ -401,7 +625,7 @@ extern void neuralNetPrint(FILE * stream, NeuralNet neuralNet)
   Neuron neuron = neuralNet.neurons->next;
 
   fprintf(stream, "Neural net ::\n");
-  fprintf(stream, "  size : %li\n", neuralNet.size);
-  for (unsigned i = 0; i < neuralNet.size; ++i, neuron = neuron->next)
-    fprintf(stream, "  neuron %i at (%lf, %lf)\n", i, neuron->p.x, neuron->p.y);
+  fprintf(stream, "  size : %lu\n", neuralNet.size);
+  for (unsigned long i = 0; i < neuralNet.size; ++i, neuron = neuron->next)
+    fprintf(stream, "  neuron %lu at (%lf, %lf)\n", i, neuron->p.x, neuron->p.y);
 }
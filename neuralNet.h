@@ -9,6 +9,7 @@
 /* -------------------------------------------------------------------------- */
 #include "sampleMap.h"
 #include "vector.h"
+#include "rng.h"
 /* -------------------------------------------------------------------------- */
 
 /* A neuron */
@@ -22,6 +23,9 @@ struct NeuronData {
   /* Number of activations */
   unsigned hits;
 
+  /* Its place along the ring, see NeuralNet */
+  unsigned long index;
+
   /* Neighbour neurons */
   Neuron next
        , prev
@@ -36,8 +40,26 @@ typedef struct {
   /* Number of learning steps without growing */
   unsigned long learned;
 
+  /* Maximum number of neurons the net may grow to */
+  unsigned long maxSize;
+
+  /* Sum of the distances between the trained samples and their nearest neurons */
+  double error;
+
   /* The net's neurons */
   Neuron neurons;
+
+  /**
+   * The positions of the neurons and the neurons themselves in the order of
+   * the ring, starting with neurons, so that the vector kernels search them.
+   * They are renumbered whenever the ring changes.
+   */
+  Vector * positions;
+  Neuron * ring;
+  unsigned long capacity;
+
+  /* Set once growing has failed for lack of memory, the net stays as it was */
+  int failed;
 } NeuralNet;
 
 /* A bounding box */
@@ -51,17 +73,51 @@ typedef struct {
 #define neuralNetLearnAfter(n) (n)
 #define neuralNetGrowThres(n) ((1.0)/(log(n)))
 #define neuralNetShrinkThres(n) (1)
+
+/* Learning rate of the activated neuron after progression t of training time */
+#define neuralNetLearningRate(t) (exp(-1 / (2 * (t))))
+
+/**
+ * Maximum number of neurons for n samples. A ratio of 0 selects the default of
+ * log(n) neurons per sample.
+ */
+#define neuralNetMaxSize(n, ratio) ((unsigned long) (((ratio) > 0 ? (ratio) : log(n)) * (n)))
 /* -------------------------------------------------------------------------- */
 
 /**
  * Creates a neural net with exactly one neuron. The single neuron of the net
  * is positioned in the middle of the region given by bounds.
  *
- * @param[in] bounds  Bounding box for the neural net.
+ * @param[in] bounds   Bounding box for the neural net.
+ * @param[in] maxSize  Maximum number of neurons the net may grow to.
+ *
+ * @return Neural net with one neuron, or without neurons if it could not be
+ *         allocated.
+ */
+extern NeuralNet neuralNetMake(PositionBounds bounds, unsigned long maxSize);
+
+/**
+ * Creates a neural net whose neurons are at the given positions, connected in
+ * the given order.
+ *
+ * @param[in] positions  Positions of the neurons along the ring.
+ * @param[in] n          Number of neurons, at least 1.
+ * @param[in] maxSize    Maximum number of neurons the net may grow to.
+ *
+ * @return Neural net with n neurons, or without neurons if they could not be
+ *         allocated.
+ */
+extern NeuralNet neuralNetMakeFrom(Vector * positions, unsigned long n, unsigned long maxSize);
+
+/**
+ * Calculates the number of bytes a neural net with the given number of neurons
+ * occupies.
+ *
+ * @param[in] size  Number of neurons.
  *
- * @return Neural net with one neuron.
+ * @return Memory footprint in bytes.
  */
-extern NeuralNet neuralNetMake(PositionBounds bounds);
+extern unsigned long neuralNetFootprint(unsigned long size);
 
 /**
  * Frees the memory that is used by the given neural net.
@@ -72,6 +128,42 @@ extern NeuralNet neuralNetMake(PositionBounds bounds);
  */
 extern NeuralNet neuralNetFree(NeuralNet nn);
 
+/**
+ * Let's the neural net grow by creating new neurons, but never beyond its
+ * maximum size.
+ *
+ * @param[in] neuralNet      Neural net that should grow.
+ * @param[in] growThreshold  Defines how often a neuron must have been activated
+ *                           in order to grow new neighbouring neurons.
+ *
+ * @return New neural net after growing new neurons. If memory runs out, failed
+ *         is set and the net keeps the neurons grown so far.
+ */
+extern NeuralNet neuralNetGrow(NeuralNet neuralNet, double growThreshold);
+
+/**
+ * Finds the neuron that is closest to the given sample, i.e. the best matching
+ * unit.
+ *
+ * @param[in] neuralNet  Neural net.
+ * @param[in] sample     The sample.
+ *
+ * @return The neuron closest to sample.
+ */
+extern Neuron neuralNetNearest(NeuralNet neuralNet, Vector sample);
+
+/**
+ * Moves the activated neuron and its neighbours towards the sample. How far a
+ * neuron moves depends on its distance to the activated neuron along the ring
+ * and on the progression of training time.
+ *
+ * @param[in] neuralNet      Neural net.
+ * @param[in] nearestNeuron  The activated neuron.
+ * @param[in] sample         The sample.
+ * @param[in] time           Progression of training time, used for learning rate decay.
+ */
+extern void neuralNetAdapt(NeuralNet neuralNet, Neuron nearestNeuron, Vector sample, double time);
+
 /**
  * Trains the neural net based on the given samples. Time states how much time
  * of the learning has passed already and is used for learning rate decay.
@@ -79,10 +171,11 @@ extern NeuralNet neuralNetFree(NeuralNet nn);
  * @param[in] neuralNet  Neural net that should be trained.
  * @param[in] samples    The samples that should be used for training.
  * @param[in] time       Progression of training time, used for learning rate decay.
+ * @param[in] rng        Random number generator that picks the samples.
  *
  * @return Neural net after training.
  */
-extern NeuralNet neuralNetTrain(NeuralNet nn, SampleMap s, double time);
+extern NeuralNet neuralNetTrain(NeuralNet nn, SampleMap s, double time, Rng * rng);
 
 /**
  * Removes neurons that are considered to be "the same". This is the case  when
@@ -104,6 +197,15 @@ extern NeuralNet neuralNetRemoveDoubleNeurons(NeuralNet neuralNet);
  */
 extern double neuralNetLength(NeuralNet neuralNet);
 
+/**
+ * Copies the positions of the neurons in the order of the ring, starting with
+ * neuralNet.neurons.
+ *
+ * @param[in]  neuralNet  Neural net.
+ * @param[out] positions  Space for neuralNet.size positions.
+ */
+extern void neuralNetPositions(NeuralNet neuralNet, Vector * positions);
+
 /**
  * Prints information about the given neural network on stream.
  *
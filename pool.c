@@ -0,0 +1,299 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+/* -------------------------------------------------------------------------- */
+#include "pool.h"
+/* -------------------------------------------------------------------------- */
+
+/* A worker and the jobs it owns, from first to last */
+typedef struct {
+  Pool pool;
+  unsigned index;
+
+  unsigned long first
+              , last
+              ;
+
+  pthread_t thread;
+  pthread_mutex_t lock;
+} PoolWorker;
+
+struct PoolData {
+  PoolWork work;
+  void * arg;
+
+  unsigned workers;
+  PoolWorker * worker;
+
+  /* Jobs of the current run that have not finished yet */
+  unsigned long pending;
+
+  /* Number of runs started so far */
+  unsigned long generation;
+
+  int done;
+
+  pthread_mutex_t lock;
+  pthread_cond_t started
+               , finished
+               ;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Takes the next job of the given worker. If it has none left, the back half
+ * of the largest range of another worker becomes its own.
+ *
+ * @param[in]  pool  The pool.
+ * @param[in]  self  The worker.
+ * @param[out] job   The job.
+ *
+ * @return 0 on success, 1 if there are no jobs left.
+ */
+static int poolTake(Pool pool, PoolWorker * self, unsigned long * job)
+{
+  PoolWorker * victim;
+  unsigned long remaining
+              , most
+              , take
+              ;
+
+  pthread_mutex_lock(&self->lock);
+
+  if (self->first < self->last)
+  {
+    *job = self->first++;
+    pthread_mutex_unlock(&self->lock);
+    return 0;
+  }
+
+  pthread_mutex_unlock(&self->lock);
+
+  for (;;)
+  {
+    /* Find the worker with the most jobs left */
+    victim = NULL;
+    most   = 0;
+
+    for (unsigned w = 0; w < pool->workers; ++w)
+    {
+      pthread_mutex_lock(&pool->worker[w].lock);
+      remaining = pool->worker[w].last - pool->worker[w].first;
+      pthread_mutex_unlock(&pool->worker[w].lock);
+
+      if (remaining > most)
+      {
+        victim = &pool->worker[w];
+        most   = remaining;
+      }
+    }
+
+    if (!victim)
+      return 1;
+
+    /* The victim may have taken jobs in the meantime */
+    pthread_mutex_lock(&victim->lock);
+    remaining = victim->last - victim->first;
+    take      = (remaining + 1) / 2;
+    victim->last -= take;
+    pthread_mutex_unlock(&victim->lock);
+
+    if (!take)
+      continue;
+
+    *job = victim->last;
+
+    pthread_mutex_lock(&self->lock);
+    self->first = *job + 1;
+    self->last  = *job + take;
+    pthread_mutex_unlock(&self->lock);
+
+    return 0;
+  }
+}
+
+/**
+ * Runs jobs whenever a run is started, until the pool is freed.
+ *
+ * @param[in] arg  The worker.
+ *
+ * @return NULL.
+ */
+static void * poolWorkerRun(void * arg)
+{
+  PoolWorker * self = arg;
+  Pool pool = self->pool;
+
+  unsigned long seen = 0
+              , job
+              ;
+
+  pthread_mutex_lock(&pool->lock);
+
+  for (;;)
+  {
+    while (pool->generation == seen && !pool->done)
+      pthread_cond_wait(&pool->started, &pool->lock);
+
+    if (pool->done)
+      break;
+
+    seen = pool->generation;
+    pthread_mutex_unlock(&pool->lock);
+
+    while (!poolTake(pool, self, &job))
+    {
+      pool->work(pool->arg, self->index, job);
+
+      /* The last job of the run wakes up poolRun */
+      if (!__atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL))
+      {
+        pthread_mutex_lock(&pool->lock);
+        pthread_cond_broadcast(&pool->finished);
+        pthread_mutex_unlock(&pool->lock);
+      }
+    }
+
+    pthread_mutex_lock(&pool->lock);
+  }
+
+  pthread_mutex_unlock(&pool->lock);
+
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Starts the given number of workers.
+ *
+ * @param[in] workers  Number of workers, at least one.
+ * @param[in] work     Function that runs a job.
+ * @param[in] arg      Argument for work.
+ *
+ * @return The pool, NULL in case of an error.
+ */
+extern Pool poolMake(unsigned workers, PoolWork work, void * arg)
+{
+  Pool pool = calloc(1, sizeof(*pool));
+
+  if (!pool || !(pool->worker = calloc(workers, sizeof(PoolWorker))))
+  {
+    perror("[ERROR] poolMake :: calloc failed.");
+    free(pool);
+    return NULL;
+  }
+
+  pool->work = work;
+  pool->arg  = arg;
+
+  pthread_mutex_init(&pool->lock, NULL);
+  pthread_cond_init(&pool->started, NULL);
+  pthread_cond_init(&pool->finished, NULL);
+
+  for (unsigned w = 0; w < workers; ++w)
+  {
+    pool->worker[w].pool  = pool;
+    pool->worker[w].index = w;
+    pthread_mutex_init(&pool->worker[w].lock, NULL);
+  }
+
+  for (pool->workers = 0; pool->workers < workers; ++pool->workers)
+    if (pthread_create(&pool->worker[pool->workers].thread, NULL, poolWorkerRun, &pool->worker[pool->workers]))
+    {
+      fprintf(stderr, "[ERROR] poolMake :: Could not start worker.\n");
+
+      /* poolFree only cleans up the workers that were started */
+      for (unsigned w = pool->workers; w < workers; ++w)
+        pthread_mutex_destroy(&pool->worker[w].lock);
+
+      return poolFree(pool);
+    }
+
+  return pool;
+}
+
+/**
+ * Runs the jobs 0 to jobs - 1 on the workers and waits until all of them have
+ * finished.
+ *
+ * @param[in] pool  The pool.
+ * @param[in] jobs  Number of jobs.
+ */
+extern void poolRun(Pool pool, unsigned long jobs)
+{
+  if (!jobs)
+    return;
+
+  pthread_mutex_lock(&pool->lock);
+
+  /* Before any job can be taken */
+  __atomic_store_n(&pool->pending, jobs, __ATOMIC_RELEASE);
+
+  /* Every worker starts with an equal share */
+  for (unsigned w = 0; w < pool->workers; ++w)
+  {
+    pthread_mutex_lock(&pool->worker[w].lock);
+    pool->worker[w].first = jobs *  w      / pool->workers;
+    pool->worker[w].last  = jobs * (w + 1) / pool->workers;
+    pthread_mutex_unlock(&pool->worker[w].lock);
+  }
+
+  ++pool->generation;
+  pthread_cond_broadcast(&pool->started);
+
+  while (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE))
+    pthread_cond_wait(&pool->finished, &pool->lock);
+
+  pthread_mutex_unlock(&pool->lock);
+}
+
+/**
+ * Returns the number of workers.
+ *
+ * @param[in] pool  The pool.
+ *
+ * @return Number of workers.
+ */
+extern unsigned poolWorkers(Pool pool)
+{
+  return pool->workers;
+}
+
+/**
+ * Stops the workers and frees the pool.
+ *
+ * @param[in] pool  The pool.
+ *
+ * @return NULL.
+ */
+extern Pool poolFree(Pool pool)
+{
+  pthread_mutex_lock(&pool->lock);
+  pool->done = 1;
+  pthread_cond_broadcast(&pool->started);
+  pthread_mutex_unlock(&pool->lock);
+
+  for (unsigned w = 0; w < pool->workers; ++w)
+  {
+    pthread_join(pool->worker[w].thread, NULL);
+    pthread_mutex_destroy(&pool->worker[w].lock);
+  }
+
+  pthread_cond_destroy(&pool->finished);
+  pthread_cond_destroy(&pool->started);
+  pthread_mutex_destroy(&pool->lock);
+
+  free(pool->worker);
+  free(pool);
+
+  return NULL;
+}
@@ -0,0 +1,70 @@
+/**
+ * @file
+ *
+ * A fixed pool of worker threads that runs numbered jobs. Every worker owns a
+ * range of the jobs and takes them from its front. A worker that runs out of
+ * jobs steals the back half of the largest remaining range of another worker,
+ * so that long jobs do not leave the other workers idle. The workers stay
+ * alive between runs.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __POOL_H__
+#define __POOL_H__
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Runs one job.
+ *
+ * @param[in] arg     Argument given to poolMake.
+ * @param[in] worker  Index of the worker that runs the job, below the number
+ *                    of workers.
+ * @param[in] job     Index of the job.
+ */
+typedef void (* PoolWork)(void * arg, unsigned worker, unsigned long job);
+
+/* A pool of worker threads */
+typedef struct PoolData * Pool;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Starts the given number of workers.
+ *
+ * @param[in] workers  Number of workers, at least one.
+ * @param[in] work     Function that runs a job.
+ * @param[in] arg      Argument for work.
+ *
+ * @return The pool, NULL in case of an error.
+ */
+extern Pool poolMake(unsigned workers, PoolWork work, void * arg);
+
+/**
+ * Runs the jobs 0 to jobs - 1 on the workers and waits until all of them have
+ * finished.
+ *
+ * @param[in] pool  The pool.
+ * @param[in] jobs  Number of jobs.
+ */
+extern void poolRun(Pool pool, unsigned long jobs);
+
+/**
+ * Returns the number of workers.
+ *
+ * @param[in] pool  The pool.
+ *
+ * @return Number of workers.
+ */
+extern unsigned poolWorkers(Pool pool);
+
+/**
+ * Stops the workers and frees the pool.
+ *
+ * @param[in] pool  The pool.
+ *
+ * @return NULL.
+ */
+extern Pool poolFree(Pool pool);
+
+#endif
@@ -0,0 +1,469 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <math.h>
+#include <cairo.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "poster.h"
+#include "frameSink.h"
+#include "instrument.h"
+#include "pool.h"
+/* -------------------------------------------------------------------------- */
+
+/* Radius of the dots and width of the lines as part of the shorter side */
+#define POSTER_RADIUS (0.001)
+#define POSTER_LINE   (0.00025)
+
+/* Neurons closer than this many pixels to the last drawn one are passed over */
+#define POSTER_LOD (1.0)
+
+/* Number of dots that are filled at once */
+#define POSTER_BATCH (4096)
+
+/* -------------------------------------------------------------------------- */
+
+/* Items that reach into the bands of the poster */
+typedef struct {
+  /* Where the items of every band start, and where those of the last end */
+  unsigned long * start;
+
+  /* Indices of the items, band after band */
+  unsigned long * items;
+} PosterBucket;
+
+/* Everything the workers share */
+typedef struct {
+  unsigned long width
+              , height
+              , columns
+              , bands
+              ;
+
+  double radius
+       , line
+       ;
+
+  /* Scaling factor for projection in picture space */
+  PositionBounds bounds;
+  Vector scale;
+
+  /* Cities and the neurons that are drawn, in picture space */
+  Vector * cities
+       , * ring
+       ;
+  unsigned long cityCount
+              , ringCount
+              ;
+
+  /* Cities, neurons and segments of the ring, from ring[i] to the next */
+  PosterBucket cityBucket
+             , neuronBucket
+             , segmentBucket
+             ;
+
+  /* Pixels of the band that is rendered and of the one before, in turns */
+  unsigned char * pixels[2];
+  unsigned long stride;
+
+  /* The band that is rendered, and whether the one before is encoded */
+  unsigned long band;
+  int encode;
+
+  PngStream png;
+
+  unsigned long failed;
+} Poster;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Projects positions from object space into picture space.
+ *
+ * @param[in]  poster     The poster.
+ * @param[in]  positions  Positions in object space.
+ * @param[in]  n          Number of positions.
+ * @param[out] projected  Space for n positions in picture space.
+ */
+static void posterProject(Poster * poster, Vector * positions, unsigned long n, Vector * projected)
+{
+  vectorProject( positions, n, poster->bounds.topleft
+               , vectorMake(poster->scale.x, -poster->scale.y)
+               , vectorMake(2 * poster->radius, poster->height - 2 * poster->radius)
+               , projected
+               );
+}
+
+/**
+ * Sorts items into the bands they reach into. An item is either a position,
+ * or the segment from a position to the next in the ring.
+ *
+ * @param[in]  poster     The poster.
+ * @param[in]  points     Positions in picture space.
+ * @param[in]  n          Number of positions.
+ * @param[in]  segments   Whether the items are segments.
+ * @param[in]  reach      How far around the items is drawn.
+ * @param[out] bucket     The items by band.
+ *
+ * @return 0 on success.
+ */
+static int posterSort(Poster * poster, Vector * points, unsigned long n, Boolean segments, double reach, PosterBucket * bucket)
+{
+  bucket->start = calloc(poster->bands + 1, sizeof(unsigned long));
+  bucket->items = NULL;
+
+  if (!bucket->start)
+    return 1;
+
+  /* Count the items of every band first, then place them */
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    for (unsigned long i = 0; i < n; ++i)
+    {
+      Vector q = segments ? points[(i + 1) % n] : points[i];
+      double top    = fmin(points[i].y, q.y) - reach
+           , bottom = fmax(points[i].y, q.y) + reach
+           ;
+
+      if (bottom < 0 || top >= poster->height)
+        continue;
+
+      unsigned long first = top > 0 ? top / POSTER_TILE : 0
+                  , last  = bottom / POSTER_TILE
+                  ;
+
+      if (last >= poster->bands)
+        last = poster->bands - 1;
+
+      for (unsigned long band = first; band <= last; ++band)
+        if (pass)
+          bucket->items[bucket->start[band]++] = i;
+        else
+          ++bucket->start[band + 1];
+    }
+
+    if (!pass)
+    {
+      for (unsigned long band = 0; band < poster->bands; ++band)
+        bucket->start[band + 1] += bucket->start[band];
+
+      if (!(bucket->items = malloc((bucket->start[poster->bands] + 1) * sizeof(unsigned long))))
+        return 1;
+    }
+  }
+
+  /* Placing moved every start to the start of the next band */
+  for (unsigned long band = poster->bands; band > 0; --band)
+    bucket->start[band] = bucket->start[band - 1];
+  bucket->start[0] = 0;
+
+  return 0;
+}
+
+/**
+ * Frees the items of a bucket.
+ *
+ * @param[in] bucket  The bucket.
+ */
+static void posterBucketFree(PosterBucket * bucket)
+{
+  free(bucket->start);
+  free(bucket->items);
+}
+
+/**
+ * Fills dots around the positions of a band that reach into the tile between
+ * left and right.
+ *
+ * @param[in] cr         Cairo context.
+ * @param[in] poster     The poster.
+ * @param[in] positions  Positions in picture space.
+ * @param[in] bucket     Positions by band.
+ * @param[in] band       The band.
+ * @param[in] left       Left side of the tile.
+ * @param[in] right      Right side of the tile.
+ */
+static void posterFillDots(cairo_t * cr, Poster * poster, Vector * positions, PosterBucket * bucket, unsigned long band, double left, double right)
+{
+  double reach = poster->radius + 1;
+  unsigned long queued = 0;
+
+  for (unsigned long k = bucket->start[band]; k < bucket->start[band + 1]; ++k)
+  {
+    Vector p = positions[bucket->items[k]];
+
+    if (p.x + reach < left || p.x - reach > right)
+      continue;
+
+    cairo_new_sub_path(cr);
+    cairo_arc(cr, p.x, p.y, poster->radius, 0, 2 * M_PI);
+
+    if (++queued == POSTER_BATCH)
+    {
+      cairo_fill(cr);
+      queued = 0;
+    }
+  }
+
+  if (queued)
+    cairo_fill(cr);
+}
+
+/**
+ * Renders a tile into the pixels of its band.
+ *
+ * @param[in] poster  The poster.
+ * @param[in] band    The band.
+ * @param[in] column  Column of the tile.
+ */
+static void posterTile(Poster * poster, unsigned long band, unsigned long column)
+{
+  instrumentBegin(render);
+
+  unsigned long x = column * POSTER_TILE
+              , y = band   * POSTER_TILE
+              , w = poster->width  - x < POSTER_TILE ? poster->width  - x : POSTER_TILE
+              , h = poster->height - y < POSTER_TILE ? poster->height - y : POSTER_TILE
+              ;
+
+  double left  = x
+       , right = x + w
+       , reach = poster->line + 1
+       ;
+
+  cairo_surface_t * surface = cairo_image_surface_create_for_data( poster->pixels[band % 2] + 4 * x
+                                                                 , CAIRO_FORMAT_RGB24, w, h, poster->stride);
+  cairo_t * cr = cairo_create(surface);
+
+  /* Everything is drawn at its place on the poster */
+  cairo_translate(cr, -left, -(double) y);
+
+  cairo_set_source_rgb(cr, 1.0, 1.0, 1.0);
+  cairo_paint(cr);
+
+  /* Render samples, i.e. the cities */
+  cairo_set_source_rgb(cr, 1.0, 0.0, 0.0);
+  posterFillDots(cr, poster, poster->cities, &poster->cityBucket, band, left, right);
+
+  /* Render the segments of the ring that reach into the tile, one path for
+     consecutive segments */
+  cairo_set_source_rgb(cr, 0.0, 0.0, 0.0);
+  cairo_set_line_width(cr, poster->line);
+
+  PosterBucket * segments = &poster->segmentBucket;
+  unsigned long drawn = ULONG_MAX;
+
+  for (unsigned long k = segments->start[band]; k < segments->start[band + 1]; ++k)
+  {
+    unsigned long i = segments->items[k];
+    Vector a = poster->ring[i]
+         , b = poster->ring[(i + 1) % poster->ringCount]
+         ;
+
+    if (fmax(a.x, b.x) + reach < left || fmin(a.x, b.x) - reach > right)
+      continue;
+
+    if (drawn == ULONG_MAX || i != drawn + 1)
+      cairo_move_to(cr, a.x, a.y);
+
+    cairo_line_to(cr, b.x, b.y);
+    drawn = i;
+  }
+
+  cairo_stroke(cr);
+
+  /* Render the neurons */
+  cairo_set_source_rgb(cr, 0.0, 1.0, 0.0);
+  posterFillDots(cr, poster, poster->ring, &poster->neuronBucket, band, left, right);
+
+  if (cairo_status(cr) != CAIRO_STATUS_SUCCESS)
+    __atomic_add_fetch(&poster->failed, 1, __ATOMIC_RELAXED);
+
+  cairo_destroy(cr);
+  cairo_surface_destroy(surface);
+
+  instrumentEnd(PHASE_RENDER, render);
+}
+
+/**
+ * Writes a band that has been rendered to the PNG stream.
+ *
+ * @param[in] poster  The poster.
+ * @param[in] band    The band.
+ */
+static void posterEncode(Poster * poster, unsigned long band)
+{
+  instrumentBegin(encode);
+
+  unsigned long rows = poster->height - band * POSTER_TILE;
+
+  if (pngStreamRows(poster->png, poster->pixels[band % 2], poster->stride, rows < POSTER_TILE ? rows : POSTER_TILE))
+    __atomic_add_fetch(&poster->failed, 1, __ATOMIC_RELAXED);
+
+  instrumentEnd(PHASE_ENCODE, encode);
+}
+
+/**
+ * Runs one job of a band, the first encodes the band before if there is one,
+ * the others render the tiles.
+ *
+ * @param[in] arg     The poster.
+ * @param[in] worker  The worker.
+ * @param[in] job     Index of the job.
+ */
+static void posterJob(void * arg, unsigned worker, unsigned long job)
+{
+  Poster * poster = arg;
+
+  if (poster->encode && !job)
+    posterEncode(poster, poster->band - 1);
+  else
+    posterTile(poster, poster->band, job - poster->encode);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Renders the samples and the given neurons as a PNG poster. The picture is
+ * laid out like those of the drawer, with dots and lines in proportion to its
+ * size.
+ *
+ * @param[in] sampleMap  Samples in object space.
+ * @param[in] bounds     Bounding box around the samples in object space.
+ * @param[in] neurons    Neuron positions in object space, in the order of the ring.
+ * @param[in] size       Number of neurons.
+ * @param[in] width      Width of the poster.
+ * @param[in] height     Height of the poster.
+ * @param[in] threads    Number of threads that render tiles.
+ * @param[in] filename   Output filename.
+ *
+ * @return 0 on success.
+ */
+extern int posterDraw( SampleMap sampleMap, PositionBounds bounds
+                     , Vector * neurons, unsigned long size
+                     , unsigned long width, unsigned long height
+                     , unsigned threads, char * filename
+                     )
+{
+  /* Rows of pixels are addressed by cairo with an int */
+  if (!width || !height || width > INT_MAX / 4)
+  {
+    fprintf(stderr, "[ERROR] A poster cannot have %lu x %lu pixels.\n", width, height);
+    return 1;
+  }
+
+  Poster poster = { 0 };
+  double shorter = width < height ? width : height;
+
+  poster.width   = width;
+  poster.height  = height;
+  poster.columns = (width  + POSTER_TILE - 1) / POSTER_TILE;
+  poster.bands   = (height + POSTER_TILE - 1) / POSTER_TILE;
+  poster.radius  = fmax(POSTER_RADIUS * shorter, 1.0);
+  poster.line    = fmax(POSTER_LINE   * shorter, 0.5);
+  poster.bounds  = bounds;
+  poster.scale   = vectorMake( (width  - 4 * poster.radius) / (bounds.bottomright.x - bounds.topleft.x)
+                             , (height - 4 * poster.radius) / (bounds.bottomright.y - bounds.topleft.y));
+  poster.stride  = 4 * width;
+
+  poster.cities    = malloc(sampleMap.items * sizeof(Vector));
+  poster.ring      = malloc(size * sizeof(Vector));
+  poster.pixels[0] = malloc(poster.stride * POSTER_TILE);
+  poster.pixels[1] = malloc(poster.stride * POSTER_TILE);
+
+  /* Without cities or neurons there is nothing to allocate for them */
+  int error = (!poster.cities && sampleMap.items) || (!poster.ring && size)
+           || !poster.pixels[0] || !poster.pixels[1];
+
+  if (!error)
+  {
+    posterProject(&poster, sampleMap.samples, sampleMap.items, poster.cities);
+    posterProject(&poster, neurons, size, poster.ring);
+
+    poster.cityCount = sampleMap.items;
+
+    /* Neurons closer than a pixel to the last drawn one are passed over */
+    for (unsigned long i = 0; i < size; ++i)
+    {
+      Vector p = poster.ring[i];
+
+      if (!poster.ringCount
+       || fabs(p.x - poster.ring[poster.ringCount - 1].x) >= POSTER_LOD
+       || fabs(p.y - poster.ring[poster.ringCount - 1].y) >= POSTER_LOD)
+        poster.ring[poster.ringCount++] = p;
+    }
+
+    error = posterSort(&poster, poster.cities, poster.cityCount, FALSE, poster.radius + 1, &poster.cityBucket)
+         || posterSort(&poster, poster.ring, poster.ringCount, FALSE, poster.radius + 1, &poster.neuronBucket)
+         || posterSort(&poster, poster.ring, poster.ringCount, TRUE, poster.line + 1, &poster.segmentBucket);
+  }
+
+  if (error)
+    perror("[ERROR] posterDraw :: malloc failed.");
+
+  Pool pool = NULL;
+
+  error = error
+       || !(poster.png = pngStreamOpen(filename, width, height))
+       || !(pool = poolMake(threads, posterJob, &poster))
+       ;
+
+  /* Every band is encoded while the next one is rendered */
+  for (poster.band = 0; !error && poster.band < poster.bands && !poster.failed; ++poster.band)
+  {
+    poster.encode = poster.band > 0;
+    poolRun(pool, poster.columns + poster.encode);
+  }
+
+  if (!error && !poster.failed)
+    posterEncode(&poster, poster.bands - 1);
+
+  if (!error && poster.failed)
+  {
+    fprintf(stderr, "[ERROR] Could not write poster %s.\n", filename);
+    error = 1;
+  }
+
+  /* Clean up... */
+  if (pool)
+    pool = poolFree(pool);
+
+  if (poster.png)
+    poster.png = pngStreamClose(poster.png);
+
+  posterBucketFree(&poster.segmentBucket);
+  posterBucketFree(&poster.neuronBucket);
+  posterBucketFree(&poster.cityBucket);
+
+  free(poster.pixels[1]);
+  free(poster.pixels[0]);
+  free(poster.ring);
+  free(poster.cities);
+
+  return error;
+}
+
+/**
+ * Calculates the number of bytes a poster of the given width occupies while
+ * rendering the given numbers of neurons and samples, for nets whose segments
+ * reach into two bands at most.
+ *
+ * @param[in] width    Width of the poster.
+ * @param[in] neurons  Number of neurons.
+ * @param[in] samples  Number of samples.
+ *
+ * @return Memory footprint in bytes.
+ */
+extern unsigned long posterFootprint(unsigned long width, unsigned long neurons, unsigned long samples)
+{
+  return 2 * 4UL * width * POSTER_TILE
+       + (neurons + samples) * sizeof(Vector)
+       + 2 * (2 * neurons + samples) * sizeof(unsigned long);
+}
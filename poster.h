@@ -0,0 +1,61 @@
+/**
+ * @file
+ *
+ * A poster is a picture of the net too large to be held in memory at once,
+ * e.g. 16384 x 16384 pixels for a tour through tens of thousands of cities.
+ * It is rendered in bands of square tiles, every tile on a worker of its own
+ * with only the cities and segments of the ring that reach into it. Every
+ * band is written to a PNG stream while the workers render the next one, so
+ * that no more than two bands are in memory.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __POSTER_H__
+#define __POSTER_H__
+
+/* -------------------------------------------------------------------------- */
+#include "neuralNet.h"
+#include "sampleMap.h"
+/* -------------------------------------------------------------------------- */
+
+/* Width and height of a tile in pixels */
+#define POSTER_TILE (256)
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Renders the samples and the given neurons as a PNG poster. The picture is
+ * laid out like those of the drawer, with dots and lines in proportion to its
+ * size.
+ *
+ * @param[in] sampleMap  Samples in object space.
+ * @param[in] bounds     Bounding box around the samples in object space.
+ * @param[in] neurons    Neuron positions in object space, in the order of the ring.
+ * @param[in] size       Number of neurons.
+ * @param[in] width      Width of the poster.
+ * @param[in] height     Height of the poster.
+ * @param[in] threads    Number of threads that render tiles.
+ * @param[in] filename   Output filename.
+ *
+ * @return 0 on success.
+ */
+extern int posterDraw( SampleMap sampleMap, PositionBounds bounds
+                     , Vector * neurons, unsigned long size
+                     , unsigned long width, unsigned long height
+                     , unsigned threads, char * filename
+                     );
+
+/**
+ * Calculates the number of bytes a poster of the given width occupies while
+ * rendering the given numbers of neurons and samples, for nets whose segments
+ * reach into two bands at most.
+ *
+ * @param[in] width    Width of the poster.
+ * @param[in] neurons  Number of neurons.
+ * @param[in] samples  Number of samples.
+ *
+ * @return Memory footprint in bytes.
+ */
+extern unsigned long posterFootprint(unsigned long width, unsigned long neurons, unsigned long samples);
+
+#endif
@@ -0,0 +1,279 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <pthread.h>
+/* -------------------------------------------------------------------------- */
+#include "renderer.h"
+#include "trace.h"
+/* -------------------------------------------------------------------------- */
+
+/* The positions of the neurons at one point of training */
+typedef struct {
+  Vector * neurons;
+  unsigned long size
+              , capacity
+              ;
+
+  /* Where the picture goes, as which frame, and the iteration it shows */
+  FrameSink sink;
+  unsigned long frame
+              , iteration
+              ;
+} Snapshot;
+
+struct RendererData {
+  Drawer drawer;
+
+  unsigned threads;
+  pthread_t * thread;
+
+  /* The snapshots, the free ones on a stack, those to render in a queue */
+  unsigned snapshots;
+  Snapshot * snapshot;
+
+  unsigned * free
+         , * queue
+         ;
+  unsigned available
+         , first
+         , queued
+         ;
+
+  int done;
+
+  pthread_mutex_t lock;
+  pthread_cond_t submitted
+               , rendered
+               ;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Renders snapshots until the renderer is closed and none are left.
+ *
+ * @param[in] arg  The renderer.
+ *
+ * @return NULL.
+ */
+static void * rendererRun(void * arg)
+{
+  Renderer renderer = arg;
+  Snapshot * snapshot;
+  unsigned index;
+
+  /* Every thread renders onto its own picture, one snapshot after the other */
+  cairo_surface_t * surface = NULL
+                , * drawn
+                ;
+
+  #ifdef INSTRUMENT
+  traceThreadName("render");
+  #endif
+
+  pthread_mutex_lock(&renderer->lock);
+
+  for (;;)
+  {
+    while (!renderer->queued && !renderer->done)
+      pthread_cond_wait(&renderer->submitted, &renderer->lock);
+
+    if (!renderer->queued)
+      break;
+
+    index = renderer->queue[renderer->first];
+    renderer->first = (renderer->first + 1) % renderer->snapshots;
+    --renderer->queued;
+
+    pthread_mutex_unlock(&renderer->lock);
+
+    /* The snapshot belongs to this thread until it is free again */
+    snapshot = &renderer->snapshot[index];
+    drawn    = drawerDrawNeurons(renderer->drawer, snapshot->neurons, snapshot->size, surface);
+
+    if (drawn)
+      surface = drawn;
+
+    /* The frame is written even without a picture, so that streams go on */
+    frameSinkWrite(snapshot->sink, drawn, snapshot->frame, snapshot->iteration);
+
+    pthread_mutex_lock(&renderer->lock);
+
+    renderer->free[renderer->available++] = index;
+    pthread_cond_signal(&renderer->rendered);
+  }
+
+  pthread_mutex_unlock(&renderer->lock);
+
+  if (surface)
+    cairo_surface_destroy(surface);
+
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Starts the given number of render threads.
+ *
+ * @param[in] drawer   Drawer for the samples, which must remain valid until
+ *                     the renderer is closed.
+ * @param[in] threads  Number of render threads, at least one.
+ *
+ * @return The renderer, NULL in case of an error.
+ */
+extern Renderer rendererOpen(Drawer drawer, unsigned threads)
+{
+  Renderer renderer = calloc(1, sizeof(*renderer));
+
+  if (!renderer)
+  {
+    perror("[ERROR] rendererOpen :: calloc failed.");
+    return NULL;
+  }
+
+  pthread_mutex_init(&renderer->lock, NULL);
+  pthread_cond_init(&renderer->submitted, NULL);
+  pthread_cond_init(&renderer->rendered, NULL);
+
+  renderer->drawer    = drawer;
+  renderer->snapshots = RENDERER_DEPTH * threads;
+  renderer->thread    = calloc(threads, sizeof(pthread_t));
+  renderer->snapshot  = calloc(renderer->snapshots, sizeof(Snapshot));
+  renderer->free      = calloc(renderer->snapshots, sizeof(unsigned));
+  renderer->queue     = calloc(renderer->snapshots, sizeof(unsigned));
+
+  if (!renderer->thread || !renderer->snapshot || !renderer->free || !renderer->queue)
+  {
+    perror("[ERROR] rendererOpen :: calloc failed.");
+    return rendererClose(renderer);
+  }
+
+  for (unsigned index = 0; index < renderer->snapshots; ++index)
+    renderer->free[renderer->available++] = index;
+
+  for (; renderer->threads < threads; ++renderer->threads)
+    if (pthread_create(&renderer->thread[renderer->threads], NULL, rendererRun, renderer))
+    {
+      fprintf(stderr, "[ERROR] rendererOpen :: Could not start render thread.\n");
+      return rendererClose(renderer);
+    }
+
+  return renderer;
+}
+
+/**
+ * Takes a snapshot of the net to be rendered as the given frame of sink.
+ * Waits while all snapshots are taken.
+ *
+ * @param[in] renderer   The renderer.
+ * @param[in] nn         Neural net.
+ * @param[in] sink       Where the picture goes.
+ * @param[in] frame      Number of the frame in sink.
+ * @param[in] iteration  Iteration the picture shows.
+ *
+ * @return 0 on success.
+ */
+extern int rendererSubmit(Renderer renderer, NeuralNet nn, FrameSink sink, unsigned long frame, unsigned long iteration)
+{
+  Snapshot * snapshot;
+  Vector * grown;
+  unsigned index;
+
+  pthread_mutex_lock(&renderer->lock);
+
+  while (!renderer->available)
+    pthread_cond_wait(&renderer->rendered, &renderer->lock);
+
+  index = renderer->free[--renderer->available];
+
+  pthread_mutex_unlock(&renderer->lock);
+
+  /* The snapshot belongs to the trainer until it is queued */
+  snapshot = &renderer->snapshot[index];
+
+  if (nn.size > snapshot->capacity)
+  {
+    grown = realloc(snapshot->neurons, nn.size * sizeof(Vector));
+
+    if (grown)
+    {
+      snapshot->neurons  = grown;
+      snapshot->capacity = nn.size;
+    }
+  }
+
+  int error = nn.size > snapshot->capacity;
+
+  if (error)
+    perror("[ERROR] rendererSubmit :: malloc failed.");
+  else
+  {
+    neuralNetPositions(nn, snapshot->neurons);
+    snapshot->size      = nn.size;
+    snapshot->sink      = sink;
+    snapshot->frame     = frame;
+    snapshot->iteration = iteration;
+  }
+
+  pthread_mutex_lock(&renderer->lock);
+
+  if (error)
+    renderer->free[renderer->available++] = index;
+  else
+  {
+    renderer->queue[(renderer->first + renderer->queued++) % renderer->snapshots] = index;
+    pthread_cond_signal(&renderer->submitted);
+  }
+
+  pthread_mutex_unlock(&renderer->lock);
+
+  /* Give up the number of the frame, so that the frames after it are written */
+  if (error)
+    frameSinkWrite(sink, NULL, frame, iteration);
+
+  return error;
+}
+
+/**
+ * Waits until all snapshots are rendered and stops the render threads.
+ *
+ * @param[in] renderer  The renderer.
+ *
+ * @return NULL.
+ */
+extern Renderer rendererClose(Renderer renderer)
+{
+  if (renderer->threads)
+  {
+    pthread_mutex_lock(&renderer->lock);
+    renderer->done = 1;
+    pthread_cond_broadcast(&renderer->submitted);
+    pthread_mutex_unlock(&renderer->lock);
+
+    for (unsigned thread = 0; thread < renderer->threads; ++thread)
+      pthread_join(renderer->thread[thread], NULL);
+  }
+
+  pthread_cond_destroy(&renderer->rendered);
+  pthread_cond_destroy(&renderer->submitted);
+  pthread_mutex_destroy(&renderer->lock);
+
+  if (renderer->snapshot)
+    for (unsigned index = 0; index < renderer->snapshots; ++index)
+      free(renderer->snapshot[index].neurons);
+
+  free(renderer->queue);
+  free(renderer->free);
+  free(renderer->snapshot);
+  free(renderer->thread);
+  free(renderer);
+
+  return NULL;
+}
@@ -0,0 +1,65 @@
+/**
+ * @file
+ *
+ * Renders pictures of the net on background threads. The trainer hands over a
+ * snapshot of the neuron positions, which takes a copy of the net, and goes on
+ * training while the render threads rasterise the pictures and hand them to
+ * their frame sink. There is a fixed number of snapshots; while all of them
+ * wait to be rendered, the trainer waits for the next one to become free.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __RENDERER_H__
+#define __RENDERER_H__
+
+/* -------------------------------------------------------------------------- */
+#include "drawer.h"
+#include "frameSink.h"
+#include "neuralNet.h"
+/* -------------------------------------------------------------------------- */
+
+/* Number of snapshots per render thread */
+#define RENDERER_DEPTH (2)
+
+/* -------------------------------------------------------------------------- */
+
+/* Render threads and their snapshots */
+typedef struct RendererData * Renderer;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Starts the given number of render threads.
+ *
+ * @param[in] drawer   Drawer for the samples, which must remain valid until
+ *                     the renderer is closed.
+ * @param[in] threads  Number of render threads, at least one.
+ *
+ * @return The renderer, NULL in case of an error.
+ */
+extern Renderer rendererOpen(Drawer drawer, unsigned threads);
+
+/**
+ * Takes a snapshot of the net to be rendered as the given frame of sink.
+ * Waits while all snapshots are taken.
+ *
+ * @param[in] renderer   The renderer.
+ * @param[in] nn         Neural net.
+ * @param[in] sink       Where the picture goes.
+ * @param[in] frame      Number of the frame in sink.
+ * @param[in] iteration  Iteration the picture shows.
+ *
+ * @return 0 on success.
+ */
+extern int rendererSubmit(Renderer renderer, NeuralNet nn, FrameSink sink, unsigned long frame, unsigned long iteration);
+
+/**
+ * Waits until all snapshots are rendered and stops the render threads.
+ *
+ * @param[in] renderer  The renderer.
+ *
+ * @return NULL.
+ */
+extern Renderer rendererClose(Renderer renderer);
+
+#endif
@@ -0,0 +1,339 @@
+/**
+ * @file
+ *
+ * Renders the snapshots of a trajectory log as frames, on all cpus at once.
+ * The log is read in rounds of a few snapshots per thread, which are then
+ * rendered in parallel, every thread onto a picture of its own.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "sampleMap.h"
+#include "mapReader.h"
+#include "drawer.h"
+#include "solver.h"
+#include "frameSink.h"
+#include "trajectory.h"
+#include "instrument.h"
+#include "pool.h"
+/* -------------------------------------------------------------------------- */
+
+/* A type for the config */
+typedef struct {
+  unsigned long threads;
+
+  Boolean help
+        , error
+        ;
+
+  char * filename
+     , * logFile
+     , * frames
+     ;
+} Config;
+
+/* A snapshot that is rendered in the current round */
+typedef struct {
+  Vector * neurons;
+  unsigned long size
+              , capacity
+              ;
+
+  /* Number of the frame in the sink, and the iteration it shows */
+  unsigned long frame
+              , iteration
+              ;
+} Frame;
+
+/* Everything the workers share */
+typedef struct {
+  Drawer drawer;
+  FrameSink sink;
+
+  Frame * frames;
+
+  /* The picture of every worker */
+  cairo_surface_t ** surfaces;
+
+  unsigned long failed;
+} Replay;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_THREADS (    0)
+#define DEFAULT_FRAMES  ("png")
+
+/* Number of snapshots per thread that are read for one round */
+#define REPLAY_DEPTH (4)
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the default config
+ *
+ * @return Default config.
+ */
+static Config getDefaultConfig(void)
+{
+  Config c;
+
+  c.threads  = DEFAULT_THREADS;
+  c.help     = FALSE;
+  c.error    = FALSE;
+  c.filename = NULL;
+  c.logFile  = NULL;
+  c.frames   = DEFAULT_FRAMES;
+
+  return c;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "tspreplay, a program for rendering the trajectory logs of tspsom.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "Usage: tspreplay <tsp file> <trajectory log> [options]\n");
+  fprintf(stream, "  Required arguments:\n");
+  fprintf(stream, "    tsp file       File that contains the tsp instance.\n");
+  fprintf(stream, "    trajectory log Log written by tspsom -L, - for stdin.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -j <number>    Number of threads                           (default: number of cpus)\n");
+  fprintf(stream, "    -f <format>    Images as png, fastpng, ppm, raw or tspf    (default: %s)\n", DEFAULT_FRAMES);
+  fprintf(stream, "                   ppm, raw and tspf stream to -, fd:<n> or a file given after a colon\n");
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = getDefaultConfig();
+
+  /* First parameters are the instance and the log */
+  c.filename = argv[1];
+  c.logFile  = argv[2];
+  int i = 3;
+
+  while (i < argc && !c.error)
+  {
+    if (strcmp(argv[i], "-h") == 0)
+      c.help = TRUE;
+
+    else if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-j") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.threads) != 1 || !c.threads;
+
+    else if (strcmp(argv[i], "-f") == 0)
+      c.frames = argv[++i];
+
+    else
+      c.error = TRUE;
+
+    ++i;
+  }
+
+  if (c.error)
+    fprintf(stderr, "[ERROR] Invalid argument %s.\n", argv[i - 1]);
+
+  return c;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Copies a snapshot into a frame of the round, whose buffer grows if it is too
+ * small.
+ *
+ * @param[in,out] frame     The frame.
+ * @param[in]     snapshot  The snapshot.
+ *
+ * @return 0 on success.
+ */
+static int frameCopy(Frame * frame, TrajectorySnapshot snapshot)
+{
+  if (snapshot.size > frame->capacity)
+  {
+    Vector * grown = realloc(frame->neurons, snapshot.size * sizeof(Vector));
+
+    if (!grown)
+    {
+      perror("[ERROR] frameCopy :: realloc failed.");
+      return 1;
+    }
+
+    frame->neurons  = grown;
+    frame->capacity = snapshot.size;
+  }
+
+  memcpy(frame->neurons, snapshot.neurons, snapshot.size * sizeof(Vector));
+  frame->size      = snapshot.size;
+  frame->iteration = snapshot.iteration;
+
+  return 0;
+}
+
+/**
+ * Renders one frame of the round and hands it to the sink.
+ *
+ * @param[in] arg     The replay.
+ * @param[in] worker  The worker.
+ * @param[in] job     Index of the frame in the round.
+ */
+static void replayFrame(void * arg, unsigned worker, unsigned long job)
+{
+  Replay * replay = arg;
+  Frame * frame = &replay->frames[job];
+
+  cairo_surface_t * drawn = drawerDrawNeurons(replay->drawer, frame->neurons, frame->size, replay->surfaces[worker]);
+
+  if (drawn)
+    replay->surfaces[worker] = drawn;
+
+  /* The frame is written even without a picture, so that streams go on */
+  if (frameSinkWrite(replay->sink, drawn, frame->frame, frame->iteration) || !drawn)
+    __atomic_add_fetch(&replay->failed, 1, __ATOMIC_RELAXED);
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  Config c = parseArgs(argc, argv);
+
+  if (c.help || c.error)
+  {
+    help(stderr);
+    return c.error;
+  }
+
+  /* One thread per cpu */
+  if (!c.threads)
+  {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    c.threads = cpus > 0 ? cpus : 1;
+  }
+
+  SampleMap cities = mapReaderRead(c.filename);
+
+  if (!cities.items)
+  {
+    fprintf(stderr, "[ERROR] No cities read from %s.\n", c.filename);
+    return 1;
+  }
+
+  Replay replay;
+  replay.drawer   = drawerMake(cities, solverBounds(cities));
+  replay.sink     = NULL;
+  replay.frames   = calloc(REPLAY_DEPTH * c.threads, sizeof(Frame));
+  replay.surfaces = calloc(c.threads, sizeof(cairo_surface_t *));
+  replay.failed   = 0;
+
+  TrajectoryReader reader = NULL;
+  Pool pool = NULL;
+
+  int error = !replay.drawer.samples;
+
+  if (!error && (!replay.frames || !replay.surfaces))
+  {
+    perror("[ERROR] main :: calloc failed.");
+    error = 1;
+  }
+
+  error = error
+       || !(reader = trajectoryReaderOpen(c.logFile))
+       || !(replay.sink = frameSinkOpen(c.frames))
+       || !(pool = poolMake(c.threads, replayFrame, &replay))
+       ;
+
+  #ifdef INFO
+  uint64_t start = instrumentNow();
+  #endif
+
+  unsigned long frames = 0
+              , round    = REPLAY_DEPTH * c.threads
+              , n        = round
+              ;
+
+  TrajectorySnapshot snapshot;
+  int status = 0;
+
+  /* A round that is not full ends the log */
+  while (!error && n == round)
+  {
+    for (n = 0; !error && n < round && !(status = trajectoryReaderNext(reader, &snapshot)); ++n)
+      error = frameCopy(&replay.frames[n], snapshot);
+
+    /* The frames of the round are numbered only once they are complete */
+    n -= error;
+    error = error || status < 0;
+
+    for (unsigned long f = 0; f < n; ++f)
+      replay.frames[f].frame = frameSinkNext(replay.sink);
+
+    if (n)
+      poolRun(pool, n);
+
+    frames += n;
+  }
+
+  #ifdef INFO
+  if (!error)
+    fprintf(stderr, "[INFO ] Rendered %lu frames on %lu threads in %.3lf s.\n"
+                  , frames - replay.failed, c.threads, (instrumentNow() - start) / 1e9);
+  #endif
+
+  error = error || replay.failed;
+
+  /* Clean up... */
+  if (pool)
+    pool = poolFree(pool);
+
+  if (replay.sink)
+    replay.sink = frameSinkClose(replay.sink);
+
+  if (reader)
+    reader = trajectoryReaderClose(reader);
+
+  if (replay.surfaces)
+    for (unsigned long w = 0; w < c.threads; ++w)
+      if (replay.surfaces[w])
+        cairo_surface_destroy(replay.surfaces[w]);
+
+  if (replay.frames)
+    for (unsigned long f = 0; f < round; ++f)
+      free(replay.frames[f].neurons);
+
+  free(replay.surfaces);
+  free(replay.frames);
+
+  replay.drawer = drawerFree(replay.drawer);
+  cities = sampleMapFree(cities);
+
+  return error;
+}
@@ -0,0 +1,105 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <math.h>
+/* -------------------------------------------------------------------------- */
+#include "rng.h"
+/* -------------------------------------------------------------------------- */
+#define ROTL(x, k) (((x) << (k)) | ((x) >> (64 - (k))))
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates a random number generator from the given seed. The same seed always
+ * yields the same sequence of numbers.
+ *
+ * @param[in] seed  Seed.
+ *
+ * @return Seeded random number generator.
+ */
+extern Rng rngMake(uint64_t seed)
+{
+  Rng res;
+
+  /* Spread the seed over the state with splitmix64 */
+  for (int i = 0; i < 4; ++i)
+  {
+    uint64_t z = (seed += 0x9e3779b97f4a7c15ULL);
+
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+
+    res.s[i] = z ^ (z >> 31);
+  }
+
+  return res;
+}
+
+/**
+ * Draws the next 64 random bits.
+ *
+ * @param[in,out] rng  Random number generator.
+ *
+ * @return Random number.
+ */
+extern uint64_t rngNext(Rng * rng)
+{
+  uint64_t * s = rng->s
+         , res = ROTL(s[1] * 5, 7) * 9
+         , t   = s[1] << 17
+         ;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3]  = ROTL(s[3], 45);
+
+  return res;
+}
+
+/**
+ * Draws a random index in [0, n).
+ *
+ * @param[in,out] rng  Random number generator.
+ * @param[in]     n    Upper bound (exclusive).
+ *
+ * @return Random index.
+ */
+extern unsigned long rngIndex(Rng * rng, unsigned long n)
+{
+  return rngNext(rng) % n;
+}
+
+/**
+ * Draws a uniformly distributed number in [0, 1).
+ *
+ * @param[in,out] rng  Random number generator.
+ *
+ * @return Random number.
+ */
+extern double rngUniform(Rng * rng)
+{
+  return (rngNext(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+/**
+ * Draws a standard normally distributed number.
+ *
+ * @param[in,out] rng  Random number generator.
+ *
+ * @return Random number.
+ */
+extern double rngGaussian(Rng * rng)
+{
+  /* Box-Muller, 1 - u keeps the logarithm finite */
+  double u = 1.0 - rngUniform(rng)
+       , v = rngUniform(rng)
+       ;
+
+  return sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v);
+}
@@ -0,0 +1,67 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __RNG_H__
+#define __RNG_H__
+
+/* -------------------------------------------------------------------------- */
+#include <stdint.h>
+/* -------------------------------------------------------------------------- */
+
+/* State of a xoshiro256** pseudo random number generator */
+typedef struct {
+  uint64_t s[4];
+} Rng;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates a random number generator from the given seed. The same seed always
+ * yields the same sequence of numbers.
+ *
+ * @param[in] seed  Seed.
+ *
+ * @return Seeded random number generator.
+ */
+extern Rng rngMake(uint64_t seed);
+
+/**
+ * Draws the next 64 random bits.
+ *
+ * @param[in,out] rng  Random number generator.
+ *
+ * @return Random number.
+ */
+extern uint64_t rngNext(Rng * rng);
+
+/**
+ * Draws a random index in [0, n).
+ *
+ * @param[in,out] rng  Random number generator.
+ * @param[in]     n    Upper bound (exclusive).
+ *
+ * @return Random index.
+ */
+extern unsigned long rngIndex(Rng * rng, unsigned long n);
+
+/**
+ * Draws a uniformly distributed number in [0, 1).
+ *
+ * @param[in,out] rng  Random number generator.
+ *
+ * @return Random number.
+ */
+extern double rngUniform(Rng * rng);
+
+/**
+ * Draws a standard normally distributed number.
+ *
+ * @param[in,out] rng  Random number generator.
+ *
+ * @return Random number.
+ */
+extern double rngGaussian(Rng * rng);
+
+#endif
@@ -19,7 +19,7 @@
  *
  * @return The new sample map with space for the given number of samples.
  */
-extern SampleMap sampleMapMake(int size)
+extern SampleMap sampleMapMake(unsigned long size)
 {
   SampleMap res;
 
@@ -27,10 +27,31 @@ extern SampleMap sampleMapMake(int size)
   res.items = 0;
 
   res.samples = malloc(size * sizeof(Vector));
+  res.weights = NULL;
+
+  if (!res.samples && size)
+  {
+    perror("[ERROR] sampleMapMake :: malloc failed.");
+    res.size = 0;
+  }
 
   return res;
 }
 
+/**
+ * Calculates the number of bytes a sample map with the given number of samples
+ * occupies.
+ *
+ * @param[in] size      Number of samples.
+ * @param[in] weighted  Whether the samples have weights.
+ *
+ * @return Memory footprint in bytes.
+ */
+extern unsigned long sampleMapFootprint(unsigned long size, int weighted)
+{
+  return sizeof(SampleMap) + size * (sizeof(Vector) + (weighted ? sizeof(unsigned long) : 0));
+}
+
 /**
  * Inserts a sample into the sample map.
  *
@@ -48,6 +69,40 @@ extern SampleMap sampleMapPut(SampleMap s, Vector sample)
   return s;
 }
 
+/**
+ * Picks the sample that covers the given point of the cumulated weights, so
+ * that for a uniformly distributed point the probability of a sample being
+ * picked is proportional to its weight.
+ *
+ * @param[in] s  The sample map.
+ * @param[in] r  Point in [0, sampleMapWeight(s)).
+ *
+ * @return Index of the picked sample.
+ */
+extern unsigned long sampleMapPick(SampleMap s, unsigned long r)
+{
+  unsigned long lo = 0
+              , hi = s.items - 1
+              , mid
+              ;
+
+  if (!s.weights)
+    return r;
+
+  /* Find the first sample whose cumulative weight exceeds r */
+  while (lo < hi)
+  {
+    mid = lo + (hi - lo) / 2;
+
+    if (s.weights[mid] > r)
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  return lo;
+}
+
 /**
  * Frees the memory used by the given sample map.
  *
@@ -62,7 +117,11 @@ extern SampleMap sampleMapFree(SampleMap s)
   if (s.samples)
     free(s.samples);
 
+  if (s.weights)
+    free(s.weights);
+
   s.samples = NULL;
+  s.weights = NULL;
 
   return s;
 }
@@ -76,9 +135,9 @@ extern SampleMap sampleMapFree(SampleMap s)
 extern void sampleMapPrint(SampleMap s, FILE * stream)
 {
   fprintf(stream, "Sample Map ::\n");
-  fprintf(stream, "  size  : %i\n", s.size);
-  fprintf(stream, "  items : %i\n", s.items);
+  fprintf(stream, "  size  : %lu\n", s.size);
+  fprintf(stream, "  items : %lu\n", s.items);
 
-  for (unsigned i = 0; i < s.items; ++i)
-    fprintf(stream, "  %i : (%lf, %lf)\n", i, s.samples[i].x, s.samples[i].y);
+  for (unsigned long i = 0; i < s.items; ++i)
+    fprintf(stream, "  %lu : (%lf, %lf)\n", i, s.samples[i].x, s.samples[i].y);
 }
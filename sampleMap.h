@@ -15,15 +15,22 @@
 /* A sample map, i.e. a collection of samples */
 typedef struct {
   /* Capacity of the sample map */
-  unsigned size;
+  unsigned long size;
 
   /* Number of elements in the sample map */
-  unsigned items;
+  unsigned long items;
 
   /* The elements of the sample map */
   Vector * samples;
+
+  /* Cumulative weights of the samples, NULL if every sample weighs 1 */
+  unsigned long * weights;
 } SampleMap;
 
+/* -------------------------------------------------------------------------- */
+#define sampleMapWeight(s) ((s).weights ? (s).weights[(s).items - 1] : (s).items)
+/* -------------------------------------------------------------------------- */
+
 /* -------------------------------------------------------------------------- */
 
 /**
@@ -33,7 +40,18 @@ typedef struct {
  *
  * @return The new sample map with space for the given number of samples.
  */
-extern SampleMap sampleMapMake(int size);
+extern SampleMap sampleMapMake(unsigned long size);
+
+/**
+ * Calculates the number of bytes a sample map with the given number of samples
+ * occupies.
+ *
+ * @param[in] size      Number of samples.
+ * @param[in] weighted  Whether the samples have weights.
+ *
+ * @return Memory footprint in bytes.
+ */
+extern unsigned long sampleMapFootprint(unsigned long size, int weighted);
 
 /**
  * Inserts a sample into the sample map.
@@ -45,6 +63,18 @@ extern SampleMap sampleMapMake(int size);
  */
 extern SampleMap sampleMapPut(SampleMap s, Vector sample);
 
+/**
+ * Picks the sample that covers the given point of the cumulated weights, so
+ * that for a uniformly distributed point the probability of a sample being
+ * picked is proportional to its weight.
+ *
+ * @param[in] s  The sample map.
+ * @param[in] r  Point in [0, sampleMapWeight(s)).
+ *
+ * @return Index of the picked sample.
+ */
+extern unsigned long sampleMapPick(SampleMap s, unsigned long r);
+
 /**
  * Frees the memory used by the given sample map.
  *
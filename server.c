@@ -0,0 +1,610 @@
+/**
+ * @file
+ *
+ * Serves solve requests on a Unix domain socket. A fixed number of threads
+ * accept connections and answer the requests on them one after another, each
+ * with buffers for the cities and the tour that are allocated up front and
+ * only grow for larger instances.
+ *
+ * A request consists of lines of text. Any number of option lines
+ *
+ *   iterations <number>
+ *   seed <number>
+ *   ratio <number>
+ *   epsilon <number>
+ *   tour <0 or 1>
+ *
+ * is followed by the instance, either a file the server can read
+ *
+ *   file <path>
+ *
+ * or the cities inline, in the format of instance files
+ *
+ *   cities <number>
+ *   <x> <y>
+ *   ...
+ *
+ * The answer is a single line of JSON. Options apply to one request only.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "sampleMap.h"
+#include "mapReader.h"
+#include "neuralNet.h"
+#include "solver.h"
+#include "instrument.h"
+/* -------------------------------------------------------------------------- */
+
+/* A type for the config */
+typedef struct {
+  unsigned long maxLearn
+              , seed
+              , threads
+              , capacity
+              ;
+
+  double ratio
+       , epsilon
+       ;
+
+  Boolean help
+        , error
+        ;
+
+  char * socketPath;
+} Config;
+
+/* Options of one request */
+typedef struct {
+  SolverOptions solver;
+  int tour;
+} Request;
+
+/* A thread that serves connections, with buffers it reuses for every request */
+typedef struct {
+  Config c;
+  int listener;
+
+  SampleMap cities;
+  unsigned long * tour;
+
+  pthread_t thread;
+} Worker;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_MAXLEARN (10000)
+#define DEFAULT_SEED     (    1)
+#define DEFAULT_RATIO    (    0)
+#define DEFAULT_EPSILON  (    0)
+#define DEFAULT_THREADS  (    0)
+#define DEFAULT_CAPACITY (10000)
+
+/* Number of connections that may wait to be accepted */
+#define SERVER_BACKLOG (64)
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the default config
+ *
+ * @return Default config.
+ */
+static Config getDefaultConfig(void)
+{
+  Config c;
+
+  c.maxLearn   = DEFAULT_MAXLEARN;
+  c.seed       = DEFAULT_SEED;
+  c.threads    = DEFAULT_THREADS;
+  c.capacity   = DEFAULT_CAPACITY;
+  c.ratio      = DEFAULT_RATIO;
+  c.epsilon    = DEFAULT_EPSILON;
+  c.help       = FALSE;
+  c.error      = FALSE;
+  c.socketPath = NULL;
+
+  return c;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "tspsomd, a server for finding approximate solutions to instances of the traveling salesman problem in 2D eucledian space.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "Usage: tspsomd <socket> [options]\n");
+  fprintf(stream, "  Required arguments:\n");
+  fprintf(stream, "    socket         Path of the Unix domain socket to listen on.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -l <number>    Default number of learning cycles           (default: %i)\n", DEFAULT_MAXLEARN);
+  fprintf(stream, "    -r <number>    Default maximum number of neurons per city  (default: log(cities))\n");
+  fprintf(stream, "    -e <number>    Default diagonal of the merge grid cells    (default: %i)\n", DEFAULT_EPSILON);
+  fprintf(stream, "    -s <number>    Default seed                                (default: %i)\n", DEFAULT_SEED);
+  fprintf(stream, "    -j <number>    Number of threads                           (default: number of cpus)\n");
+  fprintf(stream, "    -n <number>    Cities every thread allocates for up front  (default: %i)\n", DEFAULT_CAPACITY);
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = getDefaultConfig();
+
+  /* First parameter is the socket */
+  c.socketPath = argv[1];
+  int i = 2;
+
+  while (i < argc && !c.error)
+  {
+    if (strcmp(argv[i], "-h") == 0)
+      c.help = TRUE;
+
+    else if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-l") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.maxLearn) != 1 || !c.maxLearn;
+
+    else if (strcmp(argv[i], "-r") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.ratio) != 1;
+
+    else if (strcmp(argv[i], "-e") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.epsilon) != 1;
+
+    else if (strcmp(argv[i], "-s") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.seed) != 1;
+
+    else if (strcmp(argv[i], "-j") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.threads) != 1 || !c.threads;
+
+    else if (strcmp(argv[i], "-n") == 0)
+      c.error = sscanf(argv[++i], "%lu", &c.capacity) != 1;
+
+    else
+      c.error = TRUE;
+
+    ++i;
+  }
+
+  if (c.error)
+    fprintf(stderr, "[ERROR] Invalid argument %s.\n", argv[i - 1]);
+
+  return c;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Makes sure the buffers of a worker hold the given number of cities.
+ *
+ * @param[in,out] worker  The worker.
+ * @param[in]     items   Number of cities.
+ *
+ * @return 0 on success.
+ */
+static int reserve(Worker * worker, unsigned long items)
+{
+  if (items <= worker->cities.size && worker->tour)
+    return 0;
+
+  worker->cities = sampleMapFree(worker->cities);
+  free(worker->tour);
+
+  worker->cities = sampleMapMake(items);
+  worker->tour   = malloc(items * sizeof(unsigned long));
+
+  if (!worker->tour)
+    perror("[ERROR] reserve :: malloc failed.");
+
+  return !worker->cities.samples || !worker->tour;
+}
+
+/**
+ * Reads the cities of a request into the buffers of a worker.
+ *
+ * @param[in,out] worker  The worker.
+ * @param[in,out] reader  Where to read the cities from.
+ *
+ * @return 0 on success.
+ */
+static int readCities(Worker * worker, MapReader * reader)
+{
+  Vector p;
+
+  int error = !reader->items || reserve(worker, reader->items);
+
+  worker->cities.items = 0;
+
+  while (!error && worker->cities.items < reader->items)
+  {
+    error = mapReaderNext(reader, &p);
+
+    if (!error)
+      worker->cities = sampleMapPut(worker->cities, p);
+  }
+
+  return error;
+}
+
+/**
+ * Solves the cities in the buffers of a worker and writes the answer.
+ *
+ * @param[in] worker   The worker.
+ * @param[in] request  Options of the request.
+ * @param[in] start    When the request started, in nanoseconds.
+ * @param[in] out      Where to write the answer.
+ */
+static void solve(Worker * worker, Request request, uint64_t start, FILE * out)
+{
+  uint64_t parsed = instrumentNow();
+
+  Solver solver = solverMake(worker->cities, request.solver);
+
+  if (!solver)
+  {
+    fprintf(out, "{\"error\": \"out of memory\"}\n");
+    return;
+  }
+
+  if (solverRun(solver) < 0)
+  {
+    solver = solverFree(solver);
+    fprintf(out, "{\"error\": \"out of memory\"}\n");
+    return;
+  }
+
+  unsigned long samples = solverSamples(solver).items
+              , neurons = solverNet(solver).size
+              ;
+
+  double netLength  = neuralNetLength(solverNet(solver))
+       , tourLength = solverTour(solver, worker->tour)
+       ;
+
+  solver = solverFree(solver);
+
+  if (tourLength < 0)
+  {
+    fprintf(out, "{\"error\": \"out of memory\"}\n");
+    return;
+  }
+
+  uint64_t end = instrumentNow();
+
+  fprintf(out, "{\"cities\": %lu, \"samples\": %lu, \"iterations\": %lu, \"seed\": %lu, \"neurons\": %lu"
+               ", \"readSeconds\": %.6lf, \"seconds\": %.6lf, \"netLength\": %.6lf, \"tourLength\": %.6lf"
+             , worker->cities.items, samples, request.solver.iterations, request.solver.seed, neurons
+             , (parsed - start) / 1e9, (end - start) / 1e9, netLength, tourLength);
+
+  if (request.tour)
+  {
+    fprintf(out, ", \"tour\": [");
+    for (unsigned long i = 0; i < worker->cities.items; ++i)
+      fprintf(out, "%s%lu", i ? ", " : "", worker->tour[i]);
+    fprintf(out, "]");
+  }
+
+  fprintf(out, "}\n");
+}
+
+/**
+ * Creates the options of a request as given by the config.
+ *
+ * @param[in] c  Config.
+ *
+ * @return Options of a request.
+ */
+static Request defaultRequest(Config c)
+{
+  Request res;
+
+  res.solver            = solverDefaultOptions();
+  res.solver.iterations = c.maxLearn;
+  res.solver.ratio      = c.ratio;
+  res.solver.epsilon    = c.epsilon;
+  res.solver.seed       = c.seed;
+  res.tour              = 1;
+
+  return res;
+}
+
+/**
+ * Answers the requests on a connection until the client closes it.
+ *
+ * @param[in] worker  The worker.
+ * @param[in] in      Where the requests come from.
+ * @param[in] out     Where the answers go.
+ */
+static void serve(Worker * worker, FILE * in, FILE * out)
+{
+  Request request = defaultRequest(worker->c);
+  MapReader reader;
+
+  char * line = NULL
+     , key[16]
+     ;
+  size_t length = 0;
+  int offset
+    , valid
+    , error = 0
+    ;
+
+  uint64_t start = 0;
+
+  while (!error && getline(&line, &length, in) >= 0)
+  {
+    if (!start)
+      start = instrumentNow();
+
+    if (sscanf(line, "%15s %n", key, &offset) != 1)
+      continue;
+
+    if (strcmp(key, "iterations") == 0)
+      valid = sscanf(line + offset, "%lu", &request.solver.iterations) == 1 && request.solver.iterations;
+
+    else if (strcmp(key, "seed") == 0)
+      valid = sscanf(line + offset, "%lu", &request.solver.seed) == 1;
+
+    else if (strcmp(key, "ratio") == 0)
+      valid = sscanf(line + offset, "%lf", &request.solver.ratio) == 1;
+
+    else if (strcmp(key, "epsilon") == 0)
+      valid = sscanf(line + offset, "%lf", &request.solver.epsilon) == 1;
+
+    else if (strcmp(key, "tour") == 0)
+      valid = sscanf(line + offset, "%d", &request.tour) == 1;
+
+    else if (strcmp(key, "file") == 0 || strcmp(key, "cities") == 0)
+    {
+      if (key[0] == 'f')
+      {
+        line[strcspn(line, "\r\n")] = '\0';
+        reader = mapReaderOpen(line + offset);
+        valid  = reader.file != NULL;
+      }
+      else
+      {
+        reader.file   = in;
+        reader.binary = 0;
+        reader.read   = 0;
+        valid = sscanf(line + offset, "%lu", &reader.items) == 1;
+
+        /* The rest of the connection cannot be made sense of */
+        error = !valid;
+      }
+
+      if (valid)
+      {
+        valid = !readCities(worker, &reader);
+        error = !valid && reader.file == in;
+
+        if (reader.file != in)
+          reader = mapReaderClose(reader);
+      }
+
+      if (valid)
+        solve(worker, request, start, out);
+      else
+        fprintf(out, "{\"error\": \"could not read the cities\"}\n");
+
+      fflush(out);
+
+      request = defaultRequest(worker->c);
+      start   = 0;
+      continue;
+    }
+
+    else
+      valid = 0;
+
+    if (!valid)
+    {
+      fprintf(out, "{\"error\": \"invalid request line\"}\n");
+      fflush(out);
+    }
+  }
+
+  free(line);
+}
+
+/**
+ * Accepts connections and serves them until the listening socket is closed.
+ *
+ * @param[in] arg  The worker.
+ *
+ * @return NULL.
+ */
+static void * workerRun(void * arg)
+{
+  Worker * worker = arg;
+
+  int connection;
+  FILE * in
+     , * out
+     ;
+
+  for (;;)
+  {
+    connection = accept(worker->listener, NULL, NULL);
+
+    if (connection < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+
+      break;
+    }
+
+    in  = fdopen(connection, "r");
+    out = in ? fdopen(dup(connection), "w") : NULL;
+
+    if (in && out)
+      serve(worker, in, out);
+    else
+      perror("[ERROR] workerRun :: fdopen failed.");
+
+    if (out)
+      fclose(out);
+
+    if (in)
+      fclose(in);
+    else
+      close(connection);
+  }
+
+  return NULL;
+}
+
+/**
+ * Creates a socket that listens on the given path. A socket left behind by an
+ * earlier server is replaced. Only the owner may connect.
+ *
+ * @param[in] path  Path of the socket.
+ *
+ * @return The socket, -1 in case of an error.
+ */
+static int listenOn(char * path)
+{
+  struct sockaddr_un address;
+  struct stat info;
+
+  if (strlen(path) >= sizeof(address.sun_path))
+  {
+    fprintf(stderr, "[ERROR] Socket path %s is too long.\n", path);
+    return -1;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strcpy(address.sun_path, path);
+
+  if (!stat(path, &info) && S_ISSOCK(info.st_mode))
+    unlink(path);
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if (listener < 0
+   || bind(listener, (struct sockaddr *) &address, sizeof(address))
+   || chmod(path, S_IRUSR | S_IWUSR)
+   || listen(listener, SERVER_BACKLOG))
+  {
+    perror("[ERROR] listenOn :: Could not listen");
+
+    if (listener >= 0)
+      close(listener);
+
+    return -1;
+  }
+
+  return listener;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  if (argc < 2)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  Config c = parseArgs(argc, argv);
+
+  if (c.help || c.error)
+  {
+    help(stderr);
+    return c.error;
+  }
+
+  if (!c.threads)
+  {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    c.threads = cpus > 0 ? cpus : 1;
+  }
+
+  /* Workers neither get terminated by clients that hang up nor get signals */
+  sigset_t signals;
+  int received;
+
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  sigaddset(&signals, SIGTERM);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+  signal(SIGPIPE, SIG_IGN);
+
+  int listener = listenOn(c.socketPath);
+
+  if (listener < 0)
+    return 1;
+
+  Worker * workers = calloc(c.threads, sizeof(Worker));
+
+  if (!workers)
+  {
+    perror("[ERROR] main :: calloc failed.");
+    return 1;
+  }
+
+  unsigned long started = 0;
+
+  for (; started < c.threads; ++started)
+  {
+    workers[started].c        = c;
+    workers[started].listener = listener;
+
+    if (c.capacity && reserve(&workers[started], c.capacity))
+      break;
+
+    if (pthread_create(&workers[started].thread, NULL, workerRun, &workers[started]))
+    {
+      fprintf(stderr, "[ERROR] main :: Could not start worker.\n");
+      break;
+    }
+  }
+
+  #ifdef INFO
+  if (started)
+    fprintf(stderr, "[INFO ] Listening on %s with %lu threads.\n", c.socketPath, started);
+  #endif
+
+  /* Serve until told to stop, requests in progress are dropped */
+  if (started)
+    sigwait(&signals, &received);
+
+  #ifdef INFO
+  if (started)
+    fprintf(stderr, "[INFO ] Stopping.\n");
+  #endif
+
+  unlink(c.socketPath);
+  close(listener);
+
+  return started < c.threads;
+}
@@ -1,19 +1,232 @@
 /**
  * @file set.c Schnittstelle einer Bibliothek fuer Mengenoperationen.
  *
- * Mengen werden intern durch sortierte verkettete Listen dargestellt.
+ * Mengen werden intern durch aufsteigend sortierte Felder oder durch Bitmengen
+ * dargestellt. Alle Operationen sind iterativ.
  *
  * @author Christopher Blöcker
  */
 
 #include <assert.h>
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 
 #include "list.h"
 #include "set.h"
 
 /* ########################################################################## */
 
+/** Anzahl der Bits eines Wortes einer Bitmenge. */
+#define SET_BITS (sizeof(unsigned long) * CHAR_BIT)
+
+/** Teile von a und b, die in das Ergebnis einer Mengenoperation eingehen. */
+#define SET_ONLY_A (1)
+#define SET_ONLY_B (2)
+#define SET_BOTH   (4)
+
+/** Darstellung einer nicht leeren Menge oder einer Bitmenge. */
+struct SetData
+{
+  /** Woerter der Bitmenge, NULL fuer ein sortiertes Feld. */
+  unsigned long * words;
+  /** Aufsteigend sortierte Elemente des Feldes. */
+  Element * elems;
+  /** Anzahl der Woerter bzw. Platz fuer so viele Elemente. */
+  unsigned long capacity;
+  /** Anzahl der Elemente. */
+  unsigned long count;
+};
+
+/** Position beim aufsteigenden Durchlaufen einer Menge. */
+typedef struct
+{
+  /** Die Menge. */
+  Set s;
+  /** Naechster Index im Feld bzw. naechstes Bit der Bitmenge. */
+  unsigned long i;
+} Cursor;
+
+/* ########################################################################## */
+
+/**
+ * Vergroessert einen Speicherbereich, beendet das Programm, wenn das nicht
+ * moeglich ist.
+ *
+ * @param [in] p Speicherbereich, NULL fuer einen neuen.
+ * @param [in] bytes Neue Groesse.
+ *
+ * @return vergroesserter Speicherbereich.
+ */
+static void * setRealloc(void * p, size_t bytes)
+{
+  void * res = realloc(p, bytes ? bytes : 1);
+
+  if (!res)
+  {
+    perror("[ERROR] set :: realloc failed.");
+    exit(1);
+  }
+
+  return res;
+}
+
+/**
+ * Erzeugt eine leere Menge, die Platz fuer die gegebene Anzahl von Woertern
+ * einer Bitmenge bzw. Elementen eines Feldes hat.
+ *
+ * @param [in] bitset 1 fuer eine Bitmenge, 0 fuer ein sortiertes Feld.
+ * @param [in] capacity Anzahl der Woerter bzw. Elemente.
+ *
+ * @return leere Menge.
+ */
+static Set setMake(int bitset, unsigned long capacity)
+{
+  Set res = setRealloc(NULL, sizeof(*res));
+
+  res->words    = bitset ? setRealloc(NULL, capacity * sizeof(unsigned long)) : NULL;
+  res->elems    = bitset ? NULL : setRealloc(NULL, capacity * sizeof(Element));
+  res->capacity = capacity;
+  res->count    = 0;
+
+  if (bitset)
+    memset(res->words, 0, capacity * sizeof(unsigned long));
+
+  return res;
+}
+
+/**
+ * Sorgt dafuer, dass die Menge s Platz fuer die gegebene Anzahl von Woertern
+ * bzw. Elementen hat. Neue Woerter sind leer.
+ *
+ * @param [in,out] s Menge.
+ * @param [in] capacity benoetigte Anzahl der Woerter bzw. Elemente.
+ */
+static void setReserve(Set s, unsigned long capacity)
+{
+  if (capacity <= s->capacity)
+    return;
+
+  if (capacity < 2 * s->capacity)
+    capacity = 2 * s->capacity;
+
+  if (s->words)
+  {
+    s->words = setRealloc(s->words, capacity * sizeof(unsigned long));
+    memset(s->words + s->capacity, 0, (capacity - s->capacity) * sizeof(unsigned long));
+  }
+  else
+    s->elems = setRealloc(s->elems, capacity * sizeof(Element));
+
+  s->capacity = capacity;
+}
+
+/**
+ * Bestimmt die Position im Feld der Menge s, an der das Element e steht oder
+ * einzufuegen waere.
+ *
+ * @param [in] s Menge, die als sortiertes Feld dargestellt wird.
+ * @param [in] e Element.
+ *
+ * @return Index des ersten Elements, das groesser gleich e ist.
+ */
+static unsigned long setFind(Set s, Element e)
+{
+  unsigned long lo = 0
+              , hi = s->count
+              ;
+
+  while (lo < hi)
+  {
+    unsigned long mid = lo + (hi - lo) / 2;
+
+    if (list_geElement(s->elems[mid], e))
+      hi = mid;
+    else
+      lo = mid + 1;
+  }
+
+  return lo;
+}
+
+/**
+ * Haengt ein Element an eine Menge an, das groesser als alle ihre Elemente
+ * ist. Eine leere Menge wird dabei als sortiertes Feld angelegt.
+ *
+ * @param [in,out] s Zeiger auf die Menge.
+ * @param [in] e das anzuhaengende Element.
+ */
+static void setPush(Set * s, Element e)
+{
+  if (!*s)
+    *s = setMake(0, 16);
+
+  Set t = *s;
+
+  if (t->words)
+  {
+    setReserve(t, e / SET_BITS + 1);
+    t->words[e / SET_BITS] |= 1UL << e % SET_BITS;
+  }
+  else
+  {
+    setReserve(t, t->count + 1);
+    t->elems[t->count] = set_copyElement(e);
+  }
+
+  ++t->count;
+}
+
+/**
+ * Liefert das naechste Element beim aufsteigenden Durchlaufen einer Menge.
+ *
+ * @param [in,out] c Position in der Menge.
+ * @param [out] e das naechste Element.
+ *
+ * @return 1, falls es ein naechstes Element gibt; 0 sonst.
+ */
+static int cursorNext(Cursor * c, Element * e)
+{
+  Set s = c->s;
+
+  if (!s)
+    return 0;
+
+  if (!s->words)
+  {
+    if (c->i >= s->count)
+      return 0;
+
+    *e = s->elems[c->i++];
+    return 1;
+  }
+
+  unsigned long w = c->i / SET_BITS;
+
+  if (w >= s->capacity)
+    return 0;
+
+  /* Bits vor der Position werden ausgeblendet */
+  unsigned long word = s->words[w] & ~0UL << c->i % SET_BITS;
+
+  while (!word)
+  {
+    if (++w >= s->capacity)
+    {
+      c->i = w * SET_BITS;
+      return 0;
+    }
+
+    word = s->words[w];
+  }
+
+  *e   = w * SET_BITS + __builtin_ctzl(word);
+  c->i = *e + 1;
+
+  return 1;
+}
+
 /**
  * Berechnet die Summe aller Elemente der Menge s.
  *
@@ -23,46 +236,126 @@
  */
 static Element set_sum(Set s)
 {
-  return (set_is_empty(s)) ? 0 : set_elementValue(set_get_first(s)) + set_sum(list_tail(s));
+  Cursor c = { s, 0 };
+  Element e
+        , res = 0
+        ;
+
+  while (cursorNext(&c, &e))
+    res += set_elementValue(e);
+
+  return res;
 }
 
 /**
- * Bestimmt die Partitionen der Menge s. Die Partitionen sind dadurch definiert,
- * dass die Summe der Elemente der ersten Partition gleich oder größer der Summe
- * der Elemente der zweiten Partition ist. Dabei ist das größte Element der ersten
- * Partition kleiner als das kleinste Element der zweiten Partition.
+ * Verknuepft zwei Mengen. Sind beide Bitmengen, wird wortweise verknuepft,
+ * sonst werden ihre Elemente aufsteigend gemischt.
  *
- * @param [in,out] *res1 erste Partition
- * @param [in,out] *res2 zweite Partition
- * @param [in] s Menge, von der die Partitionen bestimmt werden sollen
+ * @param [in,out] res Zeiger auf das Ergebnis.
+ * @param [in] a die erste Menge.
+ * @param [in] b die zweite Menge.
+ * @param [in] keep Teile von a und b, die in das Ergebnis eingehen.
+ *
+ * @pre res zeigt auf existierende leere Menge.
  */
-static void partition(Set *res1, Set *res2, Set s)
+static void setCombine(Set * res, Set a, Set b, int keep)
 {
-  if (!set_is_empty(s))
-  {    
-    if (set_sum(*res1) < set_sum(s))
+  assert(set_is_empty(*res));
+
+  if (a && b && a->words && b->words)
+  {
+    unsigned long words = a->capacity > b->capacity ? a->capacity : b->capacity;
+
+    set_remove_all_elems(res);
+    *res = setMake(1, words);
+
+    for (unsigned long w = 0; w < words; ++w)
+    {
+      unsigned long x = w < a->capacity ? a->words[w] : 0
+                  , y = w < b->capacity ? b->words[w] : 0
+                  , r = (keep & SET_ONLY_A ? x & ~y : 0)
+                      | (keep & SET_ONLY_B ? ~x & y : 0)
+                      | (keep & SET_BOTH   ? x &  y : 0)
+                  ;
+
+      (*res)->words[w] = r;
+      (*res)->count   += __builtin_popcountl(r);
+    }
+
+    return;
+  }
+
+  Cursor ca = { a, 0 }
+       , cb = { b, 0 }
+       ;
+  Element x = 0
+        , y = 0
+        ;
+  int moreA = cursorNext(&ca, &x)
+    , moreB = cursorNext(&cb, &y)
+    ;
+
+  while (moreA || moreB)
+  {
+    if (moreA && (!moreB || !list_geElement(x, y)))
     {
-      set_insert(res1, set_get_first(s));
-      partition(res1, res2, list_tail(s));
+      if (keep & SET_ONLY_A)
+        setPush(res, x);
+
+      moreA = cursorNext(&ca, &x);
     }
+
+    else if (moreB && (!moreA || !list_geElement(y, x)))
+    {
+      if (keep & SET_ONLY_B)
+        setPush(res, y);
+
+      moreB = cursorNext(&cb, &y);
+    }
+
     else
-      set_copy(res2, s);
+    {
+      if (keep & SET_BOTH)
+        setPush(res, x);
+
+      moreA = cursorNext(&ca, &x);
+      moreB = cursorNext(&cb, &y);
+    }
   }
 }
 
 /**
- * Gibt die Stringrepräsentation der Elemente der Menge s aus. 
- * Vor jedem der Elemente wird ein Komma ausgegeben.
+ * Bestimmt die Partitionen der Menge s. Die Partitionen sind dadurch definiert,
+ * dass die Summe der Elemente der ersten Partition gleich oder größer der Summe
+ * der Elemente der zweiten Partition ist. Dabei ist das größte Element der ersten
+ * Partition kleiner als das kleinste Element der zweiten Partition.
  *
- * @param [in] s Menge, die ausgegeben werden soll
+ * @param [in,out] *res1 erste Partition
+ * @param [in,out] *res2 zweite Partition
+ * @param [in] s Menge, von der die Partitionen bestimmt werden sollen
  */
-static void printSet(Set s)
+static void partition(Set *res1, Set *res2, Set s)
 {
-  if (!list_isEmpty(s))
+  Cursor c = { s, 0 };
+  Element e = 0
+        , total = set_sum(s)
+        , first = 0
+        ;
+  int more = cursorNext(&c, &e);
+
+  /* Die kleinsten Elemente kommen in die erste Partition, solange ihre Summe
+     kleiner als die der uebrigen Elemente ist */
+  while (more && first < total - first)
   {
-    fprintf(stdout, ",");
-    set_printElement(set_get_first(s));
-    printSet(list_tail(s));
+    setPush(res1, e);
+    first += set_elementValue(e);
+    more   = cursorNext(&c, &e);
+  }
+
+  while (more)
+  {
+    setPush(res2, e);
+    more = cursorNext(&c, &e);
   }
 }
 
@@ -75,7 +368,20 @@ static void printSet(Set s)
  */
 void set_make_empty (Set * s)
 {
-  *s = list_mkEmpty();
+  *s = NULL;
+}
+
+/**
+ * Initialisiert eine Menge als leere Bitmenge fuer die Elemente 0 bis n - 1.
+ * Groessere Elemente koennen trotzdem eingefuegt werden, die Bitmenge waechst
+ * dann mit.
+ *
+ * @param[out] s Zeiger auf die initialisierte Menge.
+ * @param[in] n Anzahl der moeglichen Elemente.
+ */
+void set_make_bounded (Set * s, Element n)
+{
+  *s = setMake(1, (n + SET_BITS - 1) / SET_BITS);
 }
 
 /**
@@ -90,9 +396,26 @@ void set_make_empty (Set * s)
 void set_insert (Set * s, Element e)
 {
   assert(s != NULL);
-  
-  *s = list_insertElem(set_copyElement(e), *s);
-  
+
+  if (!set_contains(*s, set_elementValue(e)))
+  {
+    Set t = *s;
+
+    if (!t || t->words || !t->count || !list_geElement(t->elems[t->count - 1], e))
+      setPush(s, e);
+
+    else
+    {
+      unsigned long i = setFind(t, set_elementValue(e));
+
+      setReserve(t, t->count + 1);
+      memmove(t->elems + i + 1, t->elems + i, (t->count - i) * sizeof(Element));
+
+      t->elems[i] = set_copyElement(e);
+      ++t->count;
+    }
+  }
+
   assert(set_contains(*s, set_elementValue(e)));
 }
 
@@ -110,7 +433,24 @@ void set_remove (Set * s, Element e)
 {
   assert(s != NULL);
 
-  *s = list_removeElem(set_elementValue(e), *s);
+  if (set_contains(*s, set_elementValue(e)))
+  {
+    Set t = *s;
+
+    if (t->words)
+      t->words[e / SET_BITS] &= ~(1UL << e % SET_BITS);
+
+    else
+    {
+      unsigned long i = setFind(t, set_elementValue(e));
+
+      memmove(t->elems + i, t->elems + i + 1, (t->count - i - 1) * sizeof(Element));
+    }
+
+    /* Leere Felder belegen keinen Speicher */
+    if (!--t->count && !t->words)
+      set_remove_all_elems(s);
+  }
 
   assert(!set_contains(*s, set_elementValue(e)));
 }
@@ -121,14 +461,21 @@ void set_remove (Set * s, Element e)
  * @param[in,out] s Zeiger auf die Menge.
  *
  * @pre s ist Zeiger auf existierende Menge.
- * @post s ist Zeiger auf leere Menge.
+ * @post s ist Zeiger auf leere Menge, die keinen Speicher mehr belegt.
  */
 void set_remove_all_elems (Set * s)
 {
   assert(s != NULL);
 
-  *s = list_removeAllElems(*s);
-  
+  if (*s)
+  {
+    free((*s)->words);
+    free((*s)->elems);
+    free(*s);
+  }
+
+  *s = NULL;
+
   assert(set_is_empty(*s));
 }
 
@@ -141,7 +488,7 @@ void set_remove_all_elems (Set * s)
  */
 int set_is_empty (Set s)
 {
-  return list_isEmpty(s);
+  return !s || !s->count;
 }
 
 /**
@@ -153,7 +500,7 @@ int set_is_empty (Set s)
  */
 unsigned long set_cardinality (Set s)
 {
-  return list_length(s);
+  return s ? s->count : 0;
 }
 
 /**
@@ -162,15 +509,20 @@ unsigned long set_cardinality (Set s)
  *
  * @param[in] s die Menge.
  *
- * @return groesstes Element in der Menge.
+ * @return kleinstes Element in der Menge.
  *
  * @pre s ist nicht leer.
  */
 Element set_get_first (Set s)
 {
+  Cursor c = { s, 0 };
+  Element res = 0;
+
   assert(!set_is_empty(s));
 
-  return list_head(s);
+  cursorNext(&c, &res);
+
+  return res;
 }
 
 /**
@@ -179,7 +531,7 @@ Element set_get_first (Set s)
  *
  * @param[in] s die Menge.
  *
- * @return kleinstes Element in der Menge.
+ * @return groesstes Element in der Menge.
  *
  * @pre s ist nicht leer.
  */
@@ -187,8 +539,15 @@ Element set_get_last (Set s)
 {
   assert(!set_is_empty(s));
 
-  if (set_is_empty(list_tail(s))) return set_get_first(s);
-  return set_get_last(list_tail(s));
+  if (!s->words)
+    return s->elems[s->count - 1];
+
+  unsigned long w = s->capacity;
+
+  while (!s->words[--w])
+    ;
+
+  return w * SET_BITS + SET_BITS - 1 - __builtin_clzl(s->words[w]);
 }
 
 /**
@@ -201,7 +560,15 @@ Element set_get_last (Set s)
  */
 int set_contains (Set s, Element e)
 {
-  return list_isIn(set_elementValue(e), s);
+  if (set_is_empty(s))
+    return 0;
+
+  if (s->words)
+    return e / SET_BITS < s->capacity && (s->words[e / SET_BITS] >> e % SET_BITS & 1);
+
+  unsigned long i = setFind(s, set_elementValue(e));
+
+  return i < s->count && list_eqElement(s->elems[i], e);
 }
 
 /**
@@ -215,8 +582,36 @@ int set_contains (Set s, Element e)
 int set_is_subset (Set a, Set b)
 {
   if (set_is_empty(a)) return 1;
-  if (set_contains(b, set_get_first(a))) return set_is_subset(list_tail(a), list_tail(b));
-  return 0;
+  if (set_cardinality(a) > set_cardinality(b)) return 0;
+
+  if (a->words && b->words)
+  {
+    for (unsigned long w = 0; w < a->capacity; ++w)
+      if (a->words[w] & ~(w < b->capacity ? b->words[w] : 0))
+        return 0;
+
+    return 1;
+  }
+
+  /* Jedes Element von a muss beim gleichzeitigen Durchlaufen in b stehen */
+  Cursor ca = { a, 0 }
+       , cb = { b, 0 }
+       ;
+  Element x = 0
+        , y = 0
+        ;
+  int moreB = cursorNext(&cb, &y);
+
+  while (cursorNext(&ca, &x))
+  {
+    while (moreB && !list_geElement(y, x))
+      moreB = cursorNext(&cb, &y);
+
+    if (!moreB || !list_eqElement(x, y))
+      return 0;
+  }
+
+  return 1;
 }
 
 /**
@@ -229,11 +624,7 @@ int set_is_subset (Set a, Set b)
  */
 int set_equals (Set a, Set b)
 {
-  if (set_is_empty(a) && set_is_empty(b)) return 1;
-  if (set_is_empty(a) || set_is_empty(b)) return 0;
-  if (list_eqElement(set_elementValue(set_get_first(a)), set_elementValue(set_get_first(b))))
-    return set_equals(list_tail(a), list_tail(b));
-  return 0;
+  return set_cardinality(a) == set_cardinality(b) && set_is_subset(a, b);
 }
 
 /**
@@ -247,29 +638,7 @@ int set_equals (Set a, Set b)
  */
 void set_union (Set * res, Set a, Set b)
 {
-  assert(set_is_empty(*res));
-  
-  if (!set_is_empty(a) && !set_is_empty(b))
-  {
-    if (!list_geElement(set_get_first(a), set_get_first(b)))
-    {
-      set_union(res, list_tail(a), b);
-      *res = list_cons(set_copyElement(set_get_first(a)), *res);
-    }
-      
-    else if (list_eqElement(set_get_first(a), set_get_first(b)))
-    {
-      set_union(res, list_tail(a), list_tail(b));
-      *res = list_cons(set_copyElement(set_get_first(a)), *res);
-    }
-      
-    else
-      set_union(res, b, a);
-  }
-  else if (set_is_empty(a))
-    set_copy(res, b);
-  else
-    set_copy(res, a);
+  setCombine(res, a, b, SET_ONLY_A | SET_ONLY_B | SET_BOTH);
 }
 
 /**
@@ -283,22 +652,7 @@ void set_union (Set * res, Set a, Set b)
  */
 void set_intersection (Set * res, Set a, Set b)
 {
-  assert(set_is_empty(*res));
-  
-  if (!set_is_empty(a) && !(set_is_empty(b)))
-  {
-    if (!list_geElement(set_get_first(a), set_get_first(b)))
-      set_intersection(res, list_tail(a), b);
-      
-    else if (list_eqElement(set_get_first(a), set_get_first(b)))
-    {
-      set_intersection(res, list_tail(a), list_tail(b));
-      *res = list_cons(set_copyElement(set_get_first(a)), *res);
-    }
-    
-    else
-      set_intersection(res, a, list_tail(b));
-  }
+  setCombine(res, a, b, SET_BOTH);
 }
 
 /**
@@ -312,26 +666,7 @@ void set_intersection (Set * res, Set a, Set b)
  */
 void set_difference (Set * res, Set a, Set b)
 {
-  assert(set_is_empty(*res));
-  
-  if (!set_is_empty(a) && !(set_is_empty(b)))
-  {
-    if (!list_geElement(set_get_first(a), set_get_first(b)))
-    {
-      set_difference(res, list_tail(a), b);
-      *res = list_cons(set_copyElement(set_get_first(a)), *res);
-    }
-    
-    else if (list_eqElement(set_get_first(a), set_get_first(b)))
-      set_difference(res, list_tail(a), list_tail(b));
-
-    else
-      set_difference(res, a, list_tail(b));
-  }
-  else if (set_is_empty(b))
-  {
-    set_copy(res, a);
-  }
+  setCombine(res, a, b, SET_ONLY_A);
 }
 
 /**
@@ -345,26 +680,7 @@ void set_difference (Set * res, Set a, Set b)
  */
 void set_symmetric_difference (Set * res, Set a, Set b)
 {
-  assert(set_is_empty(*res));
-  
-  if (!set_is_empty(a) && !set_is_empty(b))
-  {
-    if (!list_geElement(set_get_first(a), set_get_first(b)))
-    {
-      set_symmetric_difference(res, list_tail(a), b);
-      *res = list_cons(set_copyElement(set_get_first(a)), *res);
-    }
-    
-    else if (list_eqElement(set_get_first(a), set_get_first(b)))
-      set_symmetric_difference(res, list_tail(a), list_tail(b));
-      
-    else
-      set_symmetric_difference(res, b, a);
-  }
-  else if (set_is_empty(a))
-    set_copy(res, b);
-  else
-    set_copy(res, a);
+  setCombine(res, a, b, SET_ONLY_A | SET_ONLY_B);
 }
 
 /**
@@ -379,13 +695,21 @@ void set_symmetric_difference (Set * res, Set a, Set b)
 void set_copy (Set * res, Set s)
 {
   assert(set_is_empty(*res));
-  
-  if (!set_is_empty(s))
+
+  set_remove_all_elems(res);
+
+  if (s)
   {
-    set_copy(res, list_tail(s));
-    *res = list_cons(set_copyElement(set_get_first(s)), *res);
+    *res = setMake(s->words != NULL, s->capacity);
+
+    if (s->words)
+      memcpy((*res)->words, s->words, s->capacity * sizeof(unsigned long));
+    else
+      memcpy((*res)->elems, s->elems, s->count * sizeof(Element));
+
+    (*res)->count = s->count;
   }
-  
+
   assert(set_equals(*res, s));
 }
 
@@ -411,16 +735,16 @@ void set_copy (Set * res, Set s)
 void set_partition (Set * res1, Set * res2, Set s)
 {
 #ifndef NDEBUG
-  List test1 = list_mkEmpty();
-  List test2 = list_mkEmpty();
+  Set test1 = NULL;
+  Set test2 = NULL;
 #endif
 
   assert(set_is_empty(*res1));
   assert(set_is_empty(*res2));
-  
+
   partition(res1, res2, s);
-  
-#ifndef NDEBUG 
+
+#ifndef NDEBUG
   set_intersection(&test1, *res1, *res2);
   set_union(&test2, *res1, *res2);
 #endif
@@ -441,14 +765,21 @@ void set_partition (Set * res1, Set * res2, Set s)
  */
 void set_print (Set s)
 {
+  Cursor c = { s, 0 };
+  Element e;
+
   fprintf(stdout, "(");
-  
-  if (!set_is_empty(s))
+
+  if (cursorNext(&c, &e))
   {
-    set_printElement(set_elementValue(set_get_first(s)));
-    printSet(list_tail(s));
+    set_printElement(set_elementValue(e));
+
+    while (cursorNext(&c, &e))
+    {
+      fprintf(stdout, ",");
+      set_printElement(set_elementValue(e));
+    }
   }
-  
+
   fprintf(stdout, ")\n");
 }
-
@@ -4,15 +4,23 @@
 /**
  * @file set.h Schnittstelle einer Bibliothek fuer Mengenoperationen.
  *
- * Mengen werden intern durch sortierte verkettete Listen dargestellt.
+ * Mengen werden intern durch aufsteigend sortierte Felder dargestellt. Mengen
+ * ueber einem beschraenkten Wertebereich, z.B. den Nummern der Staedte, koennen
+ * mit set_make_bounded als Bitmengen mit einem Bit pro moeglichem Element
+ * angelegt werden. Vereinigung, Schnitt und Differenz zweier Bitmengen werden
+ * wortweise berechnet, alle uebrigen durch Mischen der sortierten Elemente.
+ * Ergebnisse sind Bitmengen, wenn beide Operanden Bitmengen sind.
+ *
+ * Die leere Menge belegt keinen Speicher, solange sie keine Bitmenge ist.
+ * set_remove_all_elems gibt den Speicher einer Menge frei.
  *
  * @author Martin Egge, Christian Uhlig
  */
 
 #include "list.h"
 
-/** Eine Menge, hier als sortierte verkettete Liste implementiert. */
-typedef List Set;
+/** Eine Menge, NULL ist die leere Menge. */
+typedef struct SetData * Set;
 
 /**
  * Liefert den Wert des Elements e
@@ -46,6 +54,16 @@ typedef List Set;
  */
 void set_make_empty (Set * s);
 
+/**
+ * Initialisiert eine Menge als leere Bitmenge fuer die Elemente 0 bis n - 1.
+ * Groessere Elemente koennen trotzdem eingefuegt werden, die Bitmenge waechst
+ * dann mit.
+ *
+ * @param[out] s Zeiger auf die initialisierte Menge.
+ * @param[in] n Anzahl der moeglichen Elemente.
+ */
+void set_make_bounded (Set * s, Element n);
+
 /**
  * Fuegt ein Element e in eine Menge s ein.
  *
@@ -75,7 +93,7 @@ void set_remove (Set * s, Element e);
  * @param[in,out] s Zeiger auf die Menge.
  *
  * @pre s ist Zeiger auf existierende Menge.
- * @post s ist Zeiger auf leere Menge.
+ * @post s ist Zeiger auf leere Menge, die keinen Speicher mehr belegt.
  */
 void set_remove_all_elems (Set * s);
 
@@ -103,7 +121,7 @@ unsigned long set_cardinality (Set s);
  *
  * @param[in] s die Menge.
  *
- * @return groesstes Element in der Menge.
+ * @return kleinstes Element in der Menge.
  *
  * @pre s ist nicht leer.
  */
@@ -115,7 +133,7 @@ Element set_get_first (Set s);
  *
  * @param[in] s die Menge.
  *
- * @return kleinstes Element in der Menge.
+ * @return groesstes Element in der Menge.
  *
  * @pre s ist nicht leer.
  */
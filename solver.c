@@ -0,0 +1,452 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+/* -------------------------------------------------------------------------- */
+#include "solver.h"
+#include "mapMerger.h"
+#include "drawer.h"
+#include "renderer.h"
+#include "tour.h"
+#include "checkpoint.h"
+#include "instrument.h"
+#include "rng.h"
+/* -------------------------------------------------------------------------- */
+
+struct SolverData {
+  SolverOptions options;
+
+  /* The cities, owned by the caller, and the samples they were merged into */
+  SampleMap cities
+          , samples
+          ;
+
+  MapMerge merge;
+  PositionBounds bounds;
+
+  NeuralNet net;
+  Rng rng;
+
+  /* Number of iterations trained so far */
+  unsigned long iteration;
+
+  /* Background with the samples, prepared on the first render */
+  Drawer drawer;
+
+  /* Render threads, started on the first render if there are to be any */
+  unsigned renderThreads;
+  Renderer renderer;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the default options.
+ *
+ * @return Default options.
+ */
+extern SolverOptions solverDefaultOptions(void)
+{
+  SolverOptions o;
+
+  o.iterations = 10000;
+  o.maxNeurons = 0;
+  o.ratio      = 0;
+  o.epsilon    = 0;
+  o.seed       = 1;
+
+  return o;
+}
+
+/**
+ * Finds the bounding box around the given samples.
+ *
+ * @param[in] s  The samples, at least one.
+ *
+ * @return Bounding box.
+ */
+extern PositionBounds solverBounds(SampleMap s)
+{
+  instrumentBegin(t);
+
+  PositionBounds bounds;
+  vectorBounds(s.samples, s.items, &bounds.topleft, &bounds.bottomright);
+
+  instrumentEnd(PHASE_BOUNDS, t);
+
+  return bounds;
+}
+
+/**
+ * Creates a solver for the given cities. Coincident cities are merged into
+ * weighted samples first. The cities must remain valid until the solver is
+ * freed.
+ *
+ * @param[in] cities   The cities, at least one.
+ * @param[in] options  Options of the solve.
+ *
+ * @return The solver, NULL in case of an error.
+ */
+extern Solver solverMake(SampleMap cities, SolverOptions options)
+{
+  Solver solver = calloc(1, sizeof(*solver));
+
+  if (!solver)
+  {
+    perror("[ERROR] solverMake :: calloc failed.");
+    return NULL;
+  }
+
+  solver->options = options;
+  solver->cities  = cities;
+
+  /* Merge coincident cities into weighted samples */
+  if (options.epsilon < 0)
+    solver->samples = cities;
+  else
+    solver->samples = mapMergerMerge(cities, options.epsilon, &solver->merge);
+
+  solver->bounds = solverBounds(solver->samples);
+
+  solver->net = neuralNetMake( solver->bounds
+                             , options.maxNeurons ? options.maxNeurons
+                                                  : neuralNetMaxSize(solver->samples.items, options.ratio)
+                             );
+  solver->rng = rngMake(options.seed);
+
+  if (!solver->net.neurons)
+    return solverFree(solver);
+
+  return solver;
+}
+
+/**
+ * Frees the solver.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return NULL.
+ */
+extern Solver solverFree(Solver solver)
+{
+  solverRenderWait(solver);
+
+  solver->drawer = drawerFree(solver->drawer);
+  solver->net    = neuralNetFree(solver->net);
+
+  if (solver->samples.samples != solver->cities.samples)
+    solver->samples = sampleMapFree(solver->samples);
+
+  solver->merge = mapMergerFree(solver->merge);
+
+  free(solver);
+
+  return NULL;
+}
+
+/**
+ * Replaces the cities of a solver that does not merge them by more of them,
+ * e.g. as they arrive while being read. The previous cities must be a prefix
+ * of the new ones.
+ *
+ * @param[in] solver  The solver.
+ * @param[in] cities  The cities.
+ * @param[in] bounds  Bounding box around the cities.
+ */
+extern void solverUpdate(Solver solver, SampleMap cities, PositionBounds bounds)
+{
+  solver->cities  = cities;
+  solver->samples = cities;
+  solver->bounds  = bounds;
+
+  /* The projection depends on all cities */
+  solverRenderWait(solver);
+  solver->drawer = drawerFree(solver->drawer);
+}
+
+/**
+ * Continues the solve from the checkpoint in the given file, which must have
+ * been written for the same samples. The number of iterations and the seed
+ * are taken from the checkpoint.
+ *
+ * @param[in] solver    The solver.
+ * @param[in] filename  File that holds the checkpoint.
+ *
+ * @return 0 on success.
+ */
+extern int solverResume(Solver solver, char * filename)
+{
+  Checkpoint checkpoint;
+
+  if (checkpointRead(filename, &checkpoint))
+    return 1;
+
+  if (checkpoint.samples != solver->samples.items
+   || checkpoint.hash    != checkpointHash(solver->samples))
+  {
+    fprintf(stderr, "[ERROR] Checkpoint %s belongs to other cities.\n", filename);
+    checkpoint.net = neuralNetFree(checkpoint.net);
+    return 1;
+  }
+
+  solver->net = neuralNetFree(solver->net);
+
+  solver->net                = checkpoint.net;
+  solver->rng                = checkpoint.rng;
+  solver->iteration          = checkpoint.iteration;
+  solver->options.iterations = checkpoint.maxLearn;
+  solver->options.seed       = checkpoint.seed;
+
+  return 0;
+}
+
+/**
+ * Writes a checkpoint of the solve to the given file.
+ *
+ * @param[in] solver    The solver.
+ * @param[in] filename  Where to write the checkpoint.
+ *
+ * @return 0 on success.
+ */
+extern int solverCheckpoint(Solver solver, char * filename)
+{
+  Checkpoint checkpoint;
+
+  checkpoint.iteration = solver->iteration;
+  checkpoint.maxLearn  = solver->options.iterations;
+  checkpoint.seed      = solver->options.seed;
+  checkpoint.samples   = solver->samples.items;
+  checkpoint.hash      = checkpointHash(solver->samples);
+  checkpoint.net       = solver->net;
+  checkpoint.rng       = solver->rng;
+
+  return checkpointWrite(filename, checkpoint);
+}
+
+/**
+ * Trains the net for at most n iterations, fewer if the schedule ends before.
+ *
+ * @param[in] solver  The solver.
+ * @param[in] n       Number of iterations.
+ *
+ * @return Number of iterations trained, -1 if the net could not grow for lack
+ *         of memory.
+ */
+extern long solverStep(Solver solver, unsigned long n)
+{
+  unsigned long iterations = solver->options.iterations
+              , remaining  = iterations - solver->iteration
+              ;
+
+  if (n > remaining)
+    n = remaining;
+
+  instrumentBegin(train);
+
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    unsigned long time = ++solver->iteration;
+
+    solver->net = neuralNetTrain( solver->net
+                                , solver->samples
+                                , (double) (iterations - time) / iterations
+                                , &solver->rng
+                                );
+
+    if (solver->net.failed)
+    {
+      instrumentEnd(PHASE_TRAIN, train);
+      return -1;
+    }
+  }
+
+  instrumentEnd(PHASE_TRAIN, train);
+
+  return n;
+}
+
+/**
+ * Trains the net until the schedule ends.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return Number of iterations trained, -1 if the net could not grow for lack
+ *         of memory.
+ */
+extern long solverRun(Solver solver)
+{
+  return solverStep(solver, solver->options.iterations - solver->iteration);
+}
+
+/**
+ * Renders the cities and the net as the next frame of sink. With render
+ * threads, only a snapshot of the net is taken and the picture is rendered in
+ * the background.
+ *
+ * @param[in] solver  The solver.
+ * @param[in] sink    Where the picture goes.
+ */
+extern void solverRender(Solver solver, FrameSink sink)
+{
+  unsigned long frame = frameSinkNext(sink);
+
+  if (!solver->drawer.samples)
+    solver->drawer = drawerMake(solver->samples, solver->bounds);
+
+  if (solver->drawer.samples && solver->renderThreads && !solver->renderer)
+    solver->renderer = rendererOpen(solver->drawer, solver->renderThreads);
+
+  if (solver->renderer)
+  {
+    rendererSubmit(solver->renderer, solver->net, sink, frame, solver->iteration);
+    return;
+  }
+
+  cairo_surface_t * surface = NULL;
+  Vector * neurons = solver->drawer.samples ? malloc(solver->net.size * sizeof(Vector)) : NULL;
+
+  if (solver->drawer.samples && !neurons)
+    perror("[ERROR] solverRender :: malloc failed.");
+
+  if (neurons)
+  {
+    neuralNetPositions(solver->net, neurons);
+    surface = drawerDrawNeurons(solver->drawer, neurons, solver->net.size, NULL);
+    free(neurons);
+  }
+
+  /* Without a picture, the frame is only skipped */
+  frameSinkWrite(sink, surface, frame, solver->iteration);
+
+  if (surface)
+    cairo_surface_destroy(surface);
+}
+
+/**
+ * Sets the number of threads that render in the background, 0 to render on
+ * the calling thread. Waits for the pictures that are being rendered.
+ *
+ * @param[in] solver   The solver.
+ * @param[in] threads  Number of render threads.
+ */
+extern void solverRenderThreads(Solver solver, unsigned threads)
+{
+  solverRenderWait(solver);
+
+  solver->renderThreads = threads;
+}
+
+/**
+ * Waits until the pictures that are rendered in the background are written.
+ *
+ * @param[in] solver  The solver.
+ */
+extern void solverRenderWait(Solver solver)
+{
+  if (solver->renderer)
+    solver->renderer = rendererClose(solver->renderer);
+}
+
+/**
+ * Extracts the tour through all cities in the order of the ring, merged cities
+ * one after another.
+ *
+ * @param[in]  solver  The solver.
+ * @param[out] tour    Indices of the cities in the order of the tour.
+ *
+ * @return Length of the tour, negative in case of an error.
+ */
+extern double solverTour(Solver solver, unsigned long * tour)
+{
+  unsigned long * sampleTour = malloc(solver->samples.items * sizeof(unsigned long));
+
+  if (!sampleTour)
+  {
+    perror("[ERROR] solverTour :: malloc failed.");
+    return -1;
+  }
+
+  /* Without merging, every sample is a city of its own */
+  MapMerge merge = solver->merge;
+
+  if (!merge.first)
+    merge.cities = merge.groups = solver->cities.items;
+
+  if (tourMake(solver->net, solver->samples, sampleTour))
+  {
+    free(sampleTour);
+    return -1;
+  }
+
+  mapMergerExpand(merge, sampleTour, tour);
+
+  free(sampleTour);
+
+  return tourLength(solver->cities, tour, solver->cities.items);
+}
+
+/**
+ * Returns the options of the solve, which a checkpoint may have changed.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return The options.
+ */
+extern SolverOptions solverOptions(Solver solver)
+{
+  return solver->options;
+}
+
+/**
+ * Returns the number of iterations trained so far.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return Number of iterations.
+ */
+extern unsigned long solverIteration(Solver solver)
+{
+  return solver->iteration;
+}
+
+/**
+ * Returns the current progression of training time, from 1 down to 0.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return Progression of training time.
+ */
+extern double solverProgress(Solver solver)
+{
+  return (double) (solver->options.iterations - solver->iteration) / solver->options.iterations;
+}
+
+/**
+ * Returns the net. It remains owned by the solver and changes with training.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return The net.
+ */
+extern NeuralNet solverNet(Solver solver)
+{
+  return solver->net;
+}
+
+/**
+ * Returns the samples that are trained on.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return The samples.
+ */
+extern SampleMap solverSamples(Solver solver)
+{
+  return solver->samples;
+}
@@ -0,0 +1,215 @@
+/**
+ * @file
+ *
+ * The solver holds everything one solve needs: the instance, the net, the
+ * random number generator, the schedule and the render state. Solvers share
+ * no state, so several of them may run on different threads at once.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __SOLVER_H__
+#define __SOLVER_H__
+
+/* -------------------------------------------------------------------------- */
+#include "neuralNet.h"
+#include "frameSink.h"
+#include "sampleMap.h"
+/* -------------------------------------------------------------------------- */
+
+/* Options of a solve */
+typedef struct {
+  /* Number of training iterations, which defines the schedule */
+  unsigned long iterations;
+
+  /* Maximum number of neurons, 0 for ratio neurons per sample */
+  unsigned long maxNeurons;
+
+  /* Maximum number of neurons per sample, 0 for the default */
+  double ratio;
+
+  /* Distance below which cities are merged, negative to not merge at all */
+  double epsilon;
+
+  /* Seed of the random number generator */
+  unsigned long seed;
+} SolverOptions;
+
+/* A solve of one instance */
+typedef struct SolverData * Solver;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the default options.
+ *
+ * @return Default options.
+ */
+extern SolverOptions solverDefaultOptions(void);
+
+/**
+ * Finds the bounding box around the given samples.
+ *
+ * @param[in] s  The samples, at least one.
+ *
+ * @return Bounding box.
+ */
+extern PositionBounds solverBounds(SampleMap s);
+
+/**
+ * Creates a solver for the given cities. Coincident cities are merged into
+ * weighted samples first. The cities must remain valid until the solver is
+ * freed.
+ *
+ * @param[in] cities   The cities, at least one.
+ * @param[in] options  Options of the solve.
+ *
+ * @return The solver, NULL in case of an error.
+ */
+extern Solver solverMake(SampleMap cities, SolverOptions options);
+
+/**
+ * Frees the solver.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return NULL.
+ */
+extern Solver solverFree(Solver solver);
+
+/**
+ * Replaces the cities of a solver that does not merge them by more of them,
+ * e.g. as they arrive while being read. The previous cities must be a prefix
+ * of the new ones.
+ *
+ * @param[in] solver  The solver.
+ * @param[in] cities  The cities.
+ * @param[in] bounds  Bounding box around the cities.
+ */
+extern void solverUpdate(Solver solver, SampleMap cities, PositionBounds bounds);
+
+/**
+ * Continues the solve from the checkpoint in the given file, which must have
+ * been written for the same samples. The number of iterations and the seed
+ * are taken from the checkpoint.
+ *
+ * @param[in] solver    The solver.
+ * @param[in] filename  File that holds the checkpoint.
+ *
+ * @return 0 on success.
+ */
+extern int solverResume(Solver solver, char * filename);
+
+/**
+ * Writes a checkpoint of the solve to the given file.
+ *
+ * @param[in] solver    The solver.
+ * @param[in] filename  Where to write the checkpoint.
+ *
+ * @return 0 on success.
+ */
+extern int solverCheckpoint(Solver solver, char * filename);
+
+/**
+ * Trains the net for at most n iterations, fewer if the schedule ends before.
+ *
+ * @param[in] solver  The solver.
+ * @param[in] n       Number of iterations.
+ *
+ * @return Number of iterations trained, -1 if the net could not grow for lack
+ *         of memory.
+ */
+extern long solverStep(Solver solver, unsigned long n);
+
+/**
+ * Trains the net until the schedule ends.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return Number of iterations trained, -1 if the net could not grow for lack
+ *         of memory.
+ */
+extern long solverRun(Solver solver);
+
+/**
+ * Renders the cities and the net as the next frame of sink. With render
+ * threads, only a snapshot of the net is taken and the picture is rendered in
+ * the background.
+ *
+ * @param[in] solver  The solver.
+ * @param[in] sink    Where the picture goes.
+ */
+extern void solverRender(Solver solver, FrameSink sink);
+
+/**
+ * Sets the number of threads that render in the background, 0 to render on
+ * the calling thread. Waits for the pictures that are being rendered.
+ *
+ * @param[in] solver   The solver.
+ * @param[in] threads  Number of render threads.
+ */
+extern void solverRenderThreads(Solver solver, unsigned threads);
+
+/**
+ * Waits until the pictures that are rendered in the background are written.
+ *
+ * @param[in] solver  The solver.
+ */
+extern void solverRenderWait(Solver solver);
+
+/**
+ * Extracts the tour through all cities in the order of the ring, merged cities
+ * one after another.
+ *
+ * @param[in]  solver  The solver.
+ * @param[out] tour    Indices of the cities in the order of the tour.
+ *
+ * @return Length of the tour, negative in case of an error.
+ */
+extern double solverTour(Solver solver, unsigned long * tour);
+
+/**
+ * Returns the options of the solve, which a checkpoint may have changed.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return The options.
+ */
+extern SolverOptions solverOptions(Solver solver);
+
+/**
+ * Returns the number of iterations trained so far.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return Number of iterations.
+ */
+extern unsigned long solverIteration(Solver solver);
+
+/**
+ * Returns the current progression of training time, from 1 down to 0.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return Progression of training time.
+ */
+extern double solverProgress(Solver solver);
+
+/**
+ * Returns the net. It remains owned by the solver and changes with training.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return The net.
+ */
+extern NeuralNet solverNet(Solver solver);
+
+/**
+ * Returns the samples that are trained on.
+ *
+ * @param[in] solver  The solver.
+ *
+ * @return The samples.
+ */
+extern SampleMap solverSamples(Solver solver);
+
+#endif
@@ -0,0 +1,229 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+/* -------------------------------------------------------------------------- */
+#include "telemetry.h"
+/* -------------------------------------------------------------------------- */
+
+/* Number of records that may wait for the writer */
+#define TELEMETRY_QUEUE (256)
+
+/* -------------------------------------------------------------------------- */
+
+struct TelemetryData {
+  FILE * file;
+
+  /* Records waiting to be written, from first to first + queued */
+  TelemetryRecord queue[TELEMETRY_QUEUE];
+  unsigned long first
+              , queued
+              , dropped
+              ;
+
+  int done;
+
+  pthread_t thread;
+  pthread_mutex_t lock;
+  pthread_cond_t arrived;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Writes a record as a single JSON line.
+ *
+ * @param[in] file    Where to write the record.
+ * @param[in] record  The record.
+ */
+static void telemetryWrite(FILE * file, TelemetryRecord record)
+{
+  fprintf(file, "{\"iteration\": %lu, \"neurons\": %lu, \"learningRate\": %.6lf, \"error\": %.6lf"
+                ", \"length\": %.6lf, \"iterationsPerSecond\": %.1lf}\n"
+              , record.iteration, record.neurons, record.learningRate, record.error
+              , record.length, record.iterationsPerSecond);
+}
+
+/**
+ * Writes the queued records until the telemetry is closed.
+ *
+ * @param[in] arg  The telemetry.
+ *
+ * @return NULL.
+ */
+static void * telemetryRun(void * arg)
+{
+  Telemetry telemetry = arg;
+
+  TelemetryRecord records[TELEMETRY_QUEUE];
+  unsigned long n;
+  int done = 0;
+
+  while (!done)
+  {
+    /* Take all queued records, so that the trainer never waits for writing */
+    pthread_mutex_lock(&telemetry->lock);
+
+    while (!telemetry->queued && !telemetry->done)
+      pthread_cond_wait(&telemetry->arrived, &telemetry->lock);
+
+    for (n = 0; n < telemetry->queued; ++n)
+      records[n] = telemetry->queue[(telemetry->first + n) % TELEMETRY_QUEUE];
+
+    telemetry->first  = (telemetry->first + n) % TELEMETRY_QUEUE;
+    telemetry->queued = 0;
+    done = telemetry->done;
+
+    pthread_mutex_unlock(&telemetry->lock);
+
+    for (unsigned long record = 0; record < n; ++record)
+      telemetryWrite(telemetry->file, records[record]);
+
+    fflush(telemetry->file);
+  }
+
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens the given target and starts a thread that writes the records put into
+ * the telemetry. The target is a file name, "-" for stdout or "fd:<n>" for an
+ * open file descriptor.
+ *
+ * @param[in] target  Where to write the records.
+ *
+ * @return The telemetry, NULL in case of an error.
+ */
+extern Telemetry telemetryOpen(char * target)
+{
+  Telemetry telemetry = calloc(1, sizeof(*telemetry));
+  int fd;
+
+  if (!telemetry)
+  {
+    perror("[ERROR] telemetryOpen :: calloc failed.");
+    return NULL;
+  }
+
+  if (strcmp(target, "-") == 0)
+    telemetry->file = stdout;
+  else if (sscanf(target, "fd:%d", &fd) == 1)
+    telemetry->file = fdopen(fd, "w");
+  else
+    telemetry->file = fopen(target, "w");
+
+  if (!telemetry->file)
+  {
+    fprintf(stderr, "[ERROR] Could not open telemetry target %s.\n", target);
+    free(telemetry);
+    return NULL;
+  }
+
+  pthread_mutex_init(&telemetry->lock, NULL);
+  pthread_cond_init(&telemetry->arrived, NULL);
+
+  if (pthread_create(&telemetry->thread, NULL, telemetryRun, telemetry))
+  {
+    perror("[ERROR] telemetryOpen :: pthread_create failed.");
+
+    pthread_cond_destroy(&telemetry->arrived);
+    pthread_mutex_destroy(&telemetry->lock);
+
+    if (telemetry->file != stdout)
+      fclose(telemetry->file);
+
+    free(telemetry);
+    return NULL;
+  }
+
+  return telemetry;
+}
+
+/**
+ * Hands a record to the writer thread without waiting for it to be written.
+ * If the writer falls behind, the record is dropped.
+ *
+ * @param[in] telemetry  The telemetry.
+ * @param[in] record     The record.
+ */
+extern void telemetryPut(Telemetry telemetry, TelemetryRecord record)
+{
+  pthread_mutex_lock(&telemetry->lock);
+
+  if (telemetry->queued < TELEMETRY_QUEUE)
+  {
+    telemetry->queue[(telemetry->first + telemetry->queued++) % TELEMETRY_QUEUE] = record;
+    pthread_cond_signal(&telemetry->arrived);
+  }
+  else
+    ++telemetry->dropped;
+
+  pthread_mutex_unlock(&telemetry->lock);
+}
+
+/**
+ * Writes the remaining records, stops the writer thread and closes the target.
+ *
+ * @param[in] telemetry  The telemetry.
+ *
+ * @return NULL.
+ */
+extern Telemetry telemetryClose(Telemetry telemetry)
+{
+  pthread_mutex_lock(&telemetry->lock);
+  telemetry->done = 1;
+  pthread_cond_signal(&telemetry->arrived);
+  pthread_mutex_unlock(&telemetry->lock);
+
+  pthread_join(telemetry->thread, NULL);
+
+  if (telemetry->dropped)
+    fprintf(stderr, "[ERROR] Dropped %lu telemetry records.\n", telemetry->dropped);
+
+  if (telemetry->file == stdout)
+    fflush(stdout);
+  else
+    fclose(telemetry->file);
+
+  pthread_cond_destroy(&telemetry->arrived);
+  pthread_mutex_destroy(&telemetry->lock);
+  free(telemetry);
+
+  return NULL;
+}
+
+/**
+ * Writes a string as a JSON string, in quotes and with quotes, backslashes
+ * and control characters escaped, so that names such as file names can be
+ * written into JSON lines as they are.
+ *
+ * @param[in] file  Where to write the string.
+ * @param[in] s     The string.
+ */
+extern void telemetryWriteString(FILE * file, const char * s)
+{
+  fputc('"', file);
+
+  for (; *s; ++s)
+  {
+    unsigned char ch = *s;
+
+    if (ch == '"' || ch == '\\')
+      fprintf(file, "\\%c", ch);
+    else if (ch < 0x20)
+      fprintf(file, "\\u%04x", ch);
+    else
+      fputc(ch, file);
+  }
+
+  fputc('"', file);
+}
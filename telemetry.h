@@ -0,0 +1,70 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __TELEMETRY_H__
+#define __TELEMETRY_H__
+
+/* -------------------------------------------------------------------------- */
+#include <stdio.h>
+/* -------------------------------------------------------------------------- */
+
+/* Progress of training that is written as one JSON line */
+typedef struct {
+  unsigned long iteration
+              , neurons
+              ;
+
+  double learningRate
+       , error
+       , length
+       , iterationsPerSecond
+       ;
+} TelemetryRecord;
+
+/* Records that are written by a background thread */
+typedef struct TelemetryData * Telemetry;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens the given target and starts a thread that writes the records put into
+ * the telemetry. The target is a file name, "-" for stdout or "fd:<n>" for an
+ * open file descriptor.
+ *
+ * @param[in] target  Where to write the records.
+ *
+ * @return The telemetry, NULL in case of an error.
+ */
+extern Telemetry telemetryOpen(char * target);
+
+/**
+ * Hands a record to the writer thread without waiting for it to be written.
+ * If the writer falls behind, the record is dropped.
+ *
+ * @param[in] telemetry  The telemetry.
+ * @param[in] record     The record.
+ */
+extern void telemetryPut(Telemetry telemetry, TelemetryRecord record);
+
+/**
+ * Writes the remaining records, stops the writer thread and closes the target.
+ *
+ * @param[in] telemetry  The telemetry.
+ *
+ * @return NULL.
+ */
+extern Telemetry telemetryClose(Telemetry telemetry);
+
+/**
+ * Writes a string as a JSON string, in quotes and with quotes, backslashes
+ * and control characters escaped, so that names such as file names can be
+ * written into JSON lines as they are.
+ *
+ * @param[in] file  Where to write the string.
+ * @param[in] s     The string.
+ */
+extern void telemetryWriteString(FILE * file, const char * s);
+
+#endif
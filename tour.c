@@ -0,0 +1,303 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <math.h>
+#include <float.h>
+/* -------------------------------------------------------------------------- */
+#include "tour.h"
+#include "vector.h"
+/* -------------------------------------------------------------------------- */
+
+/* A sample along with where it is visited on the ring */
+typedef struct {
+  /* Index of the nearest neuron along the ring */
+  unsigned long neuron;
+
+  /* Projection onto the ring's direction at that neuron */
+  double t;
+
+  unsigned long sample;
+} TourStop;
+
+/* A uniform grid of buckets for nearest neuron queries */
+typedef struct {
+  /* Number of cells per dimension */
+  unsigned long cells;
+
+  /* Origin and size of a cell */
+  Vector origin
+       , cell
+       ;
+
+  /* The neurons of cell c are items[first[c]] to items[first[c+1]-1] */
+  unsigned long * first
+              , * items
+              ;
+} NeuronGrid;
+
+/* -------------------------------------------------------------------------- */
+#define neuronGridCoord(g, v, d) \
+  ((unsigned long) fmin(fmax(floor(((v).d - (g).origin.d) / (g).cell.d), 0), (g).cells - 1))
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Orders tour stops by neuron and projection.
+ *
+ * @param[in] a  First tour stop.
+ * @param[in] b  Second tour stop.
+ *
+ * @return <0, 0 or >0 if a is visited before, together with or after b.
+ */
+static int tourStopCompare(const void * a, const void * b)
+{
+  const TourStop * u = a
+               , * v = b
+               ;
+
+  if (u->neuron != v->neuron)
+    return u->neuron < v->neuron ? -1 : 1;
+
+  if (u->t != v->t)
+    return u->t < v->t ? -1 : 1;
+
+  return (u->sample > v->sample) - (u->sample < v->sample);
+}
+
+/**
+ * Sorts the given positions into a grid with about two positions per cell.
+ *
+ * @param[in] positions  Positions.
+ * @param[in] n          Number of positions.
+ *
+ * @return The grid, with first set to NULL if allocation failed.
+ */
+static NeuronGrid neuronGridMake(Vector * positions, unsigned long n)
+{
+  NeuronGrid grid;
+  Vector max = positions[0];
+  unsigned long cell;
+
+  grid.origin = positions[0];
+  grid.cells  = (unsigned long) ceil(sqrt(n / 2.0));
+
+  for (unsigned long i = 1; i < n; ++i)
+  {
+    grid.origin.x = fmin(grid.origin.x, positions[i].x);
+    grid.origin.y = fmin(grid.origin.y, positions[i].y);
+    max.x         = fmax(max.x, positions[i].x);
+    max.y         = fmax(max.y, positions[i].y);
+  }
+
+  grid.cell = vectorMake( fmax((max.x - grid.origin.x) / grid.cells, DBL_MIN)
+                        , fmax((max.y - grid.origin.y) / grid.cells, DBL_MIN)
+                        );
+
+  grid.first = calloc(grid.cells * grid.cells + 1, sizeof(unsigned long));
+  grid.items = malloc(n * sizeof(unsigned long));
+
+  if (!grid.first || !grid.items)
+  {
+    perror("[ERROR] neuronGridMake :: malloc failed.");
+    free(grid.first);
+    free(grid.items);
+    grid.first = NULL;
+    grid.items = NULL;
+    return grid;
+  }
+
+  /* Counting sort of the positions by cell */
+  for (unsigned long i = 0; i < n; ++i)
+    ++grid.first[neuronGridCoord(grid, positions[i], y) * grid.cells + neuronGridCoord(grid, positions[i], x) + 1];
+
+  for (cell = 1; cell <= grid.cells * grid.cells; ++cell)
+    grid.first[cell] += grid.first[cell - 1];
+
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    cell = neuronGridCoord(grid, positions[i], y) * grid.cells + neuronGridCoord(grid, positions[i], x);
+    grid.items[grid.first[cell]++] = i;
+  }
+
+  /* Filling has moved every start to the start of the next cell */
+  for (cell = grid.cells * grid.cells; cell > 0; --cell)
+    grid.first[cell] = grid.first[cell - 1];
+  grid.first[0] = 0;
+
+  return grid;
+}
+
+/**
+ * Finds the position that is nearest to p by searching rings of cells around
+ * the cell of p until no closer position can be found.
+ *
+ * @param[in] grid       Grid of the positions.
+ * @param[in] positions  Positions.
+ * @param[in] p          Query position.
+ *
+ * @return Index of the nearest position.
+ */
+static unsigned long neuronGridNearest(NeuronGrid grid, Vector * positions, Vector p)
+{
+  long cx = neuronGridCoord(grid, p, x)
+     , cy = neuronGridCoord(grid, p, y)
+     , cells = grid.cells
+     ;
+
+  double best = DBL_MAX
+       , reach = fmin(grid.cell.x, grid.cell.y)
+       , d
+       ;
+
+  unsigned long res = 0;
+
+  for (long r = 0; r <= cells && best > (r - 1) * reach * (r - 1) * reach; ++r)
+    for (long y = cy - r; y <= cy + r; ++y)
+      for (long x = cx - r; x <= cx + r; x += (y == cy - r || y == cy + r) ? 1 : 2 * r)
+      {
+        if (x < 0 || y < 0 || x >= cells || y >= cells)
+          continue;
+
+        for (unsigned long i = grid.first[y * cells + x]; i < grid.first[y * cells + x + 1]; ++i)
+        {
+          Vector v = vectorSub(positions[grid.items[i]], p);
+
+          if ((d = v.x * v.x + v.y * v.y) < best)
+          {
+            best = d;
+            res  = grid.items[i];
+          }
+        }
+
+        /* Rings of radius 0 consist of a single cell */
+        if (!r)
+          break;
+      }
+
+  return res;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Extracts a tour from the trained neural net. Every sample is assigned to its
+ * nearest neuron and the samples are visited in the order of their neurons
+ * along the ring. Samples that share a neuron are ordered by their projection
+ * onto the ring's direction at that neuron.
+ *
+ * @param[in]  neuralNet  Trained neural net.
+ * @param[in]  samples    The samples.
+ * @param[out] tour       Space for samples.items sample indices.
+ *
+ * @return 0 on success, 1 if memory could not be allocated.
+ */
+extern int tourMake(NeuralNet neuralNet, SampleMap samples, unsigned long * tour)
+{
+  unsigned long n = neuralNet.size;
+
+  Vector * positions = malloc(n * sizeof(Vector));
+  TourStop * stops   = malloc(samples.items * sizeof(TourStop));
+  NeuronGrid grid;
+
+  if (!positions || !stops)
+  {
+    perror("[ERROR] tourMake :: malloc failed.");
+    free(positions);
+    free(stops);
+    return 1;
+  }
+
+  neuralNetPositions(neuralNet, positions);
+  grid = neuronGridMake(positions, n);
+
+  if (!grid.first)
+  {
+    free(positions);
+    free(stops);
+    return 1;
+  }
+
+  for (unsigned long sample = 0; sample < samples.items; ++sample)
+  {
+    unsigned long neuron = neuronGridNearest(grid, positions, samples.samples[sample]);
+
+    Vector direction = vectorSub(positions[(neuron + 1) % n], positions[(neuron + n - 1) % n])
+         , offset    = vectorSub(samples.samples[sample], positions[neuron])
+         ;
+
+    stops[sample].neuron = neuron;
+    stops[sample].t      = direction.x * offset.x + direction.y * offset.y;
+    stops[sample].sample = sample;
+  }
+
+  qsort(stops, samples.items, sizeof(TourStop), tourStopCompare);
+
+  for (unsigned long i = 0; i < samples.items; ++i)
+    tour[i] = stops[i].sample;
+
+  free(grid.first);
+  free(grid.items);
+  free(stops);
+  free(positions);
+
+  return 0;
+}
+
+/**
+ * Calculates the length of a round trip through the given samples.
+ *
+ * @param[in] samples  The samples.
+ * @param[in] tour     Order in which the samples are visited.
+ * @param[in] n        Number of samples in the tour.
+ *
+ * @return Length of the round trip.
+ */
+extern double tourLength(SampleMap samples, unsigned long * tour, unsigned long n)
+{
+  double res = 0.0;
+
+  for (unsigned long i = 0; i < n; ++i)
+    res += vectorLength(vectorSub(samples.samples[tour[i]], samples.samples[tour[(i + 1) % n]]));
+
+  return res;
+}
+
+/**
+ * Writes the tour to the given file, the number of cities in the first line
+ * followed by one city index per line.
+ *
+ * @param[in] filename  Output filename.
+ * @param[in] tour      Order in which the cities are visited.
+ * @param[in] n         Number of cities in the tour.
+ *
+ * @return 0 on success, 1 otherwise.
+ */
+extern int tourWrite(char * filename, unsigned long * tour, unsigned long n)
+{
+  int error = 0;
+
+  FILE * f = fopen(filename, "w");
+
+  if (!f)
+  {
+    fprintf(stderr, "tourWrite :: Error opening file %s.\n", filename);
+    return 1;
+  }
+
+  error = fprintf(f, "%lu\n", n) < 0;
+
+  for (unsigned long i = 0; i < n && !error; ++i)
+    error = fprintf(f, "%lu\n", tour[i]) < 0;
+
+  error |= fclose(f) != 0;
+
+  if (error)
+    fprintf(stderr, "tourWrite :: Error writing file %s.\n", filename);
+
+  return error;
+}
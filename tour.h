@@ -0,0 +1,51 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __TOUR_H__
+#define __TOUR_H__
+
+/* -------------------------------------------------------------------------- */
+#include "neuralNet.h"
+#include "sampleMap.h"
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Extracts a tour from the trained neural net. Every sample is assigned to its
+ * nearest neuron and the samples are visited in the order of their neurons
+ * along the ring. Samples that share a neuron are ordered by their projection
+ * onto the ring's direction at that neuron.
+ *
+ * @param[in]  neuralNet  Trained neural net.
+ * @param[in]  samples    The samples.
+ * @param[out] tour       Space for samples.items sample indices.
+ *
+ * @return 0 on success, 1 if memory could not be allocated.
+ */
+extern int tourMake(NeuralNet neuralNet, SampleMap samples, unsigned long * tour);
+
+/**
+ * Calculates the length of a round trip through the given samples.
+ *
+ * @param[in] samples  The samples.
+ * @param[in] tour     Order in which the samples are visited.
+ * @param[in] n        Number of samples in the tour.
+ *
+ * @return Length of the round trip.
+ */
+extern double tourLength(SampleMap samples, unsigned long * tour, unsigned long n);
+
+/**
+ * Writes the tour to the given file, the number of cities in the first line
+ * followed by one city index per line.
+ *
+ * @param[in] filename  Output filename.
+ * @param[in] tour      Order in which the cities are visited.
+ * @param[in] n         Number of cities in the tour.
+ *
+ * @return 0 on success, 1 otherwise.
+ */
+extern int tourWrite(char * filename, unsigned long * tour, unsigned long n);
+
+#endif
@@ -0,0 +1,227 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+/* -------------------------------------------------------------------------- */
+#include "trace.h"
+#include "instrument.h"
+/* -------------------------------------------------------------------------- */
+
+/* A recorded event */
+typedef struct {
+  const char * name;
+  uint64_t start
+         , end
+         ;
+} TraceEvent;
+
+/* The events of one thread */
+typedef struct TraceBufferData {
+  unsigned long tid;
+  const char * name;
+
+  /* Number of events ever written, the latest are kept */
+  uint64_t written;
+
+  TraceEvent events[TRACE_CAPACITY];
+
+  struct TraceBufferData * next;
+} * TraceBuffer;
+
+/* -------------------------------------------------------------------------- */
+
+int traceOn = 0;
+
+/* Start of the trace */
+static uint64_t origin;
+
+/* Buffers of all threads that recorded events, and the number of threads */
+static TraceBuffer buffers = NULL;
+static unsigned long threads = 0;
+
+/* Number of traces closed so far, buffers of earlier traces have been freed */
+static unsigned long generation = 0;
+
+/* Buffer of the calling thread, and the trace it belongs to */
+static __thread TraceBuffer local = NULL;
+static __thread unsigned long localGeneration = 0;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Returns the buffer of the calling thread, creating and registering it on
+ * its first use in the current trace.
+ *
+ * @return The buffer, NULL if it could not be allocated.
+ */
+static TraceBuffer traceBuffer(void)
+{
+  unsigned long current = __atomic_load_n(&generation, __ATOMIC_ACQUIRE);
+
+  /* A buffer of an earlier trace has been freed by traceClose */
+  if (local && localGeneration == current)
+    return local;
+
+  local           = calloc(1, sizeof(*local));
+  localGeneration = current;
+
+  if (!local)
+  {
+    perror("[ERROR] traceBuffer :: calloc failed.");
+    return NULL;
+  }
+
+  local->tid  = __atomic_fetch_add(&threads, 1, __ATOMIC_RELAXED);
+  local->next = __atomic_load_n(&buffers, __ATOMIC_RELAXED);
+
+  /* Push the buffer onto the list of all buffers */
+  while (!__atomic_compare_exchange_n(&buffers, &local->next, local, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+    ;
+
+  return local;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Starts recording events. Must be called before any other thread records.
+ */
+extern void traceOpen(void)
+{
+  origin  = instrumentNow();
+  traceOn = 1;
+}
+
+/**
+ * Records an event of the calling thread.
+ *
+ * @param[in] name   Name of the event, must outlive the trace.
+ * @param[in] start  Start of the event as given by instrumentNow.
+ * @param[in] end    End of the event as given by instrumentNow.
+ */
+extern void traceEvent(const char * name, uint64_t start, uint64_t end)
+{
+  TraceBuffer buffer;
+
+  if (!traceOn || !(buffer = traceBuffer()))
+    return;
+
+  TraceEvent * event = &buffer->events[buffer->written % TRACE_CAPACITY];
+
+  event->name  = name;
+  event->start = start;
+  event->end   = end;
+
+  /* Publish the event to whoever writes the trace */
+  __atomic_store_n(&buffer->written, buffer->written + 1, __ATOMIC_RELEASE);
+}
+
+/**
+ * Records an event of the calling thread that ends now.
+ *
+ * @param[in] name   Name of the event, must outlive the trace.
+ * @param[in] start  Start of the event as given by instrumentNow.
+ *
+ * @return The end of the event.
+ */
+extern uint64_t traceSpan(const char * name, uint64_t start)
+{
+  uint64_t end = instrumentNow();
+
+  traceEvent(name, start, end);
+
+  return end;
+}
+
+/**
+ * Names the calling thread in the trace.
+ *
+ * @param[in] name  Name of the thread, must outlive the trace.
+ */
+extern void traceThreadName(const char * name)
+{
+  TraceBuffer buffer;
+
+  if (traceOn && (buffer = traceBuffer()))
+    buffer->name = name;
+}
+
+/**
+ * Writes the events of all threads as Chrome trace JSON. The other threads
+ * must not record events meanwhile.
+ *
+ * @param[in] filename  Where to write the trace.
+ *
+ * @return 0 on success.
+ */
+extern int traceWrite(char * filename)
+{
+  FILE * f = fopen(filename, "w");
+
+  if (!f)
+  {
+    fprintf(stderr, "[ERROR] Could not open trace file %s.\n", filename);
+    return 1;
+  }
+
+  fprintf(f, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [");
+
+  int first = 1;
+
+  for (TraceBuffer buffer = __atomic_load_n(&buffers, __ATOMIC_ACQUIRE); buffer; buffer = buffer->next)
+  {
+    uint64_t written = __atomic_load_n(&buffer->written, __ATOMIC_ACQUIRE)
+           , event   = written > TRACE_CAPACITY ? written - TRACE_CAPACITY : 0
+           ;
+
+    if (buffer->name)
+    {
+      fprintf(f, "%s\n{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %lu, \"args\": {\"name\": \"%s\"}}"
+               , first ? "" : ",", buffer->tid, buffer->name);
+      first = 0;
+    }
+
+    /* Timestamps are in microseconds */
+    for (; event < written; ++event)
+    {
+      TraceEvent * e = &buffer->events[event % TRACE_CAPACITY];
+
+      fprintf(f, "%s\n{\"name\": \"%s\", \"ph\": \"X\", \"pid\": 1, \"tid\": %lu, \"ts\": %.3lf, \"dur\": %.3lf}"
+               , first ? "" : ",", e->name, buffer->tid
+               , (e->start - origin) / 1e3, (e->end - e->start) / 1e3);
+      first = 0;
+    }
+  }
+
+  fprintf(f, "\n]}\n");
+
+  return fclose(f) != 0;
+}
+
+/**
+ * Stops recording events and frees the buffers of all threads. The other
+ * threads must not record events meanwhile. Threads that record after the
+ * trace has been opened again get new buffers.
+ */
+extern void traceClose(void)
+{
+  traceOn = 0;
+
+  while (buffers)
+  {
+    TraceBuffer next = buffers->next;
+
+    free(buffers);
+    buffers = next;
+  }
+
+  threads = 0;
+  local   = NULL;
+
+  __atomic_fetch_add(&generation, 1, __ATOMIC_RELEASE);
+}
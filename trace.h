@@ -0,0 +1,76 @@
+/**
+ * @file
+ *
+ * Records spans of time as events for the Chrome trace viewer. Every thread
+ * writes its events into a ring buffer of its own without taking locks, once
+ * the buffer is full the oldest events are overwritten. The events of all
+ * threads are written as Chrome trace JSON when the program ends.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __TRACE_H__
+#define __TRACE_H__
+
+/* -------------------------------------------------------------------------- */
+#include <stdint.h>
+/* -------------------------------------------------------------------------- */
+
+/* Number of events every thread keeps */
+#define TRACE_CAPACITY (1 << 16)
+
+/* -------------------------------------------------------------------------- */
+
+/* Whether events are recorded, set once by traceOpen */
+extern int traceOn;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Starts recording events. Must be called before any other thread records.
+ */
+extern void traceOpen(void);
+
+/**
+ * Records an event of the calling thread.
+ *
+ * @param[in] name   Name of the event, must outlive the trace.
+ * @param[in] start  Start of the event as given by instrumentNow.
+ * @param[in] end    End of the event as given by instrumentNow.
+ */
+extern void traceEvent(const char * name, uint64_t start, uint64_t end);
+
+/**
+ * Records an event of the calling thread that ends now.
+ *
+ * @param[in] name   Name of the event, must outlive the trace.
+ * @param[in] start  Start of the event as given by instrumentNow.
+ *
+ * @return The end of the event.
+ */
+extern uint64_t traceSpan(const char * name, uint64_t start);
+
+/**
+ * Names the calling thread in the trace.
+ *
+ * @param[in] name  Name of the thread, must outlive the trace.
+ */
+extern void traceThreadName(const char * name);
+
+/**
+ * Writes the events of all threads as Chrome trace JSON. The other threads
+ * must not record events meanwhile.
+ *
+ * @param[in] filename  Where to write the trace.
+ *
+ * @return 0 on success.
+ */
+extern int traceWrite(char * filename);
+
+/**
+ * Stops recording events and frees the buffers of all threads. The other
+ * threads must not record events meanwhile. Threads that record after the
+ * trace has been opened again get new buffers.
+ */
+extern void traceClose(void);
+
+#endif
@@ -0,0 +1,397 @@
+/**
+ * @file
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+/* -------------------------------------------------------------------------- */
+#include "trajectory.h"
+/* -------------------------------------------------------------------------- */
+
+/* Most bytes a quantized coordinate takes, for differences up to 17 bits */
+#define TRAJECTORY_VARINT (3)
+
+/* -------------------------------------------------------------------------- */
+
+struct TrajectoryData {
+  FILE * file;
+
+  /* The encoded neurons of a snapshot */
+  unsigned char * buffer;
+  size_t bytes;
+};
+
+struct TrajectoryReaderData {
+  FILE * file;
+
+  /* The encoded neurons of a snapshot, and the decoded ones */
+  unsigned char * buffer;
+  size_t bytes;
+
+  Vector * neurons;
+  unsigned long capacity;
+};
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Appends a signed value as zigzag encoded varint.
+ *
+ * @param[out] b  Where to write the value.
+ * @param[in]  v  The value.
+ *
+ * @return Position after the value.
+ */
+static unsigned char * putVarint(unsigned char * b, int64_t v)
+{
+  uint64_t u = v < 0 ? ~((uint64_t) v << 1) : (uint64_t) v << 1;
+
+  for (; u >= 0x80; u >>= 7)
+    *b++ = u | 0x80;
+  *b++ = u;
+
+  return b;
+}
+
+/**
+ * Reads a zigzag encoded varint.
+ *
+ * @param[in]  b    Where the value starts.
+ * @param[in]  end  End of the data.
+ * @param[out] v    The value.
+ *
+ * @return Position after the value, NULL if the data ends before.
+ */
+static const unsigned char * getVarint(const unsigned char * b, const unsigned char * end, int64_t * v)
+{
+  uint64_t u = 0;
+
+  for (unsigned shift = 0; b < end && shift < 64; shift += 7)
+  {
+    u |= (uint64_t) (*b & 0x7f) << shift;
+
+    if (!(*b++ & 0x80))
+    {
+      *v = u & 1 ? (int64_t) ~(u >> 1) : (int64_t) (u >> 1);
+      return b;
+    }
+  }
+
+  return NULL;
+}
+
+/**
+ * Makes sure that the buffer holds at least the given number of bytes.
+ *
+ * @param[in,out] buffer    The buffer.
+ * @param[in,out] bytes     Its size.
+ * @param[in]     size      Number of bytes needed.
+ *
+ * @return 0 on success.
+ */
+static int reserve(unsigned char ** buffer, size_t * bytes, size_t size)
+{
+  if (size <= *bytes)
+    return 0;
+
+  unsigned char * grown = realloc(*buffer, size);
+
+  if (!grown)
+    return 1;
+
+  *buffer = grown;
+  *bytes  = size;
+
+  return 0;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens the given target for snapshots. The target is a file name, "-" for
+ * stdout or "fd:<n>" for an open file descriptor. Snapshots are appended to
+ * an existing log file if append is set.
+ *
+ * @param[in] target  Where to write the snapshots.
+ * @param[in] append  Whether to append to an existing file.
+ *
+ * @return The log, NULL in case of an error.
+ */
+extern Trajectory trajectoryOpen(char * target, int append)
+{
+  Trajectory trajectory = calloc(1, sizeof(*trajectory));
+  uint64_t version = TRAJECTORY_VERSION;
+  int fd;
+
+  if (!trajectory)
+  {
+    perror("[ERROR] trajectoryOpen :: calloc failed.");
+    return NULL;
+  }
+
+  if (strcmp(target, "-") == 0)
+    trajectory->file = stdout;
+  else if (sscanf(target, "fd:%d", &fd) == 1)
+    trajectory->file = fdopen(fd, "w");
+  else
+    trajectory->file = fopen(target, append ? "ab" : "wb");
+
+  /* An existing log already has its header */
+  int error = !trajectory->file;
+
+  if (!error && (!append || ftell(trajectory->file) <= 0))
+    error = fwrite(TRAJECTORY_MAGIC, 4, 1, trajectory->file) != 1
+         || fwrite(&version, sizeof(version), 1, trajectory->file) != 1;
+
+  if (error)
+  {
+    fprintf(stderr, "[ERROR] Could not open trajectory log %s.\n", target);
+
+    if (trajectory->file && trajectory->file != stdout)
+      fclose(trajectory->file);
+
+    free(trajectory);
+    return NULL;
+  }
+
+  return trajectory;
+}
+
+/**
+ * Appends a snapshot of the net to the log.
+ *
+ * @param[in] trajectory    The log.
+ * @param[in] nn            Neural net.
+ * @param[in] iteration     Iteration of training.
+ * @param[in] learningRate  Learning rate at that iteration.
+ *
+ * @return 0 on success.
+ */
+extern int trajectoryWrite(Trajectory trajectory, NeuralNet nn, unsigned long iteration, double learningRate)
+{
+  if (reserve(&trajectory->buffer, &trajectory->bytes, 2 * TRAJECTORY_VARINT * nn.size))
+  {
+    perror("[ERROR] trajectoryWrite :: realloc failed.");
+    return 1;
+  }
+
+  /* The neurons are quantized within their own bounding box */
+  Vector min
+       , max
+       ;
+
+  vectorBounds(nn.positions, nn.size, &min, &max);
+
+  double box[4] = { min.x, min.y, max.x, max.y };
+
+  double scaleX = box[2] > box[0] ? TRAJECTORY_STEPS / (box[2] - box[0]) : 0
+       , scaleY = box[3] > box[1] ? TRAJECTORY_STEPS / (box[3] - box[1]) : 0
+       ;
+
+  unsigned char * b = trajectory->buffer;
+  int64_t lastX = 0
+        , lastY = 0
+        ;
+
+  for (unsigned long i = 0; i < nn.size; ++i)
+  {
+    int64_t x = lround((nn.positions[i].x - box[0]) * scaleX)
+          , y = lround((nn.positions[i].y - box[1]) * scaleY)
+          ;
+
+    b = putVarint(b, x - lastX);
+    b = putVarint(b, y - lastY);
+
+    lastX = x;
+    lastY = y;
+  }
+
+  uint64_t head[2] = { iteration, nn.size }
+         , length  = b - trajectory->buffer
+         ;
+
+  int error = fwrite(&head[0], sizeof(uint64_t), 1, trajectory->file) != 1
+           || fwrite(&learningRate, sizeof(double), 1, trajectory->file) != 1
+           || fwrite(&head[1], sizeof(uint64_t), 1, trajectory->file) != 1
+           || fwrite(box, sizeof(box), 1, trajectory->file) != 1
+           || fwrite(&length, sizeof(length), 1, trajectory->file) != 1
+           || fwrite(trajectory->buffer, 1, length, trajectory->file) != length
+           ;
+
+  if (error)
+    fprintf(stderr, "[ERROR] Could not write snapshot of iteration %lu.\n", iteration);
+
+  return error;
+}
+
+/**
+ * Writes the remaining snapshots and closes the target.
+ *
+ * @param[in] trajectory  The log.
+ *
+ * @return NULL.
+ */
+extern Trajectory trajectoryClose(Trajectory trajectory)
+{
+  if (trajectory->file == stdout ? fflush(stdout) : fclose(trajectory->file))
+    fprintf(stderr, "[ERROR] Could not write trajectory log.\n");
+
+  free(trajectory->buffer);
+  free(trajectory);
+
+  return NULL;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens the given log for reading. The file name "-" refers to stdin.
+ *
+ * @param[in] filename  File that contains the log.
+ *
+ * @return The reader, NULL in case of an error.
+ */
+extern TrajectoryReader trajectoryReaderOpen(char * filename)
+{
+  TrajectoryReader reader = calloc(1, sizeof(*reader));
+  char magic[4];
+  uint64_t version;
+
+  if (!reader)
+  {
+    perror("[ERROR] trajectoryReaderOpen :: calloc failed.");
+    return NULL;
+  }
+
+  reader->file = strcmp(filename, "-") == 0 ? stdin : fopen(filename, "rb");
+
+  if (!reader->file)
+  {
+    fprintf(stderr, "[ERROR] Could not open trajectory log %s.\n", filename);
+    free(reader);
+    return NULL;
+  }
+
+  if (fread(magic, 4, 1, reader->file) != 1
+   || memcmp(magic, TRAJECTORY_MAGIC, 4)
+   || fread(&version, sizeof(version), 1, reader->file) != 1
+   || version != TRAJECTORY_VERSION)
+  {
+    fprintf(stderr, "[ERROR] %s is not a trajectory log.\n", filename);
+    return trajectoryReaderClose(reader);
+  }
+
+  return reader;
+}
+
+/**
+ * Reads the next snapshot. Its neurons belong to the reader and remain valid
+ * until the next snapshot is read.
+ *
+ * @param[in]  reader    The reader.
+ * @param[out] snapshot  The snapshot.
+ *
+ * @return 0 on success, 1 if there are no more snapshots, -1 in case of an error.
+ */
+extern int trajectoryReaderNext(TrajectoryReader reader, TrajectorySnapshot * snapshot)
+{
+  uint64_t iteration
+         , size
+         , length
+         ;
+  double learningRate
+       , box[4]
+       ;
+
+  /* The log may end between snapshots only */
+  if (fread(&iteration, sizeof(iteration), 1, reader->file) != 1)
+    return 1;
+
+  int error = fread(&learningRate, sizeof(double), 1, reader->file) != 1
+           || fread(&size, sizeof(size), 1, reader->file) != 1
+           || fread(box, sizeof(box), 1, reader->file) != 1
+           || fread(&length, sizeof(length), 1, reader->file) != 1
+           || length < 2 * size
+           || length > 2 * TRAJECTORY_VARINT * size
+           ;
+
+  if (!error && size > reader->capacity)
+  {
+    Vector * grown = realloc(reader->neurons, size * sizeof(Vector));
+
+    if (grown)
+    {
+      reader->neurons  = grown;
+      reader->capacity = size;
+    }
+  }
+
+  if (!error && (size > reader->capacity || reserve(&reader->buffer, &reader->bytes, length)))
+  {
+    perror("[ERROR] trajectoryReaderNext :: realloc failed.");
+    return -1;
+  }
+
+  error = error || fread(reader->buffer, 1, length, reader->file) != length;
+
+  const unsigned char * b   = reader->buffer
+                    , * end = reader->buffer + length
+                    ;
+  int64_t x = 0
+        , y = 0
+        , dx
+        , dy
+        ;
+
+  for (uint64_t i = 0; !error && i < size; ++i)
+  {
+    error = !(b = getVarint(b, end, &dx)) || !(b = getVarint(b, end, &dy));
+
+    if (!error)
+    {
+      x += dx;
+      y += dy;
+
+      reader->neurons[i] = vectorMake( box[0] + x * (box[2] - box[0]) / TRAJECTORY_STEPS
+                                     , box[1] + y * (box[3] - box[1]) / TRAJECTORY_STEPS);
+    }
+  }
+
+  if (error)
+  {
+    fprintf(stderr, "[ERROR] Truncated or corrupt snapshot of iteration %lu.\n", (unsigned long) iteration);
+    return -1;
+  }
+
+  snapshot->iteration    = iteration;
+  snapshot->learningRate = learningRate;
+  snapshot->size         = size;
+  snapshot->neurons      = reader->neurons;
+
+  return 0;
+}
+
+/**
+ * Closes the log.
+ *
+ * @param[in] reader  The reader.
+ *
+ * @return NULL.
+ */
+extern TrajectoryReader trajectoryReaderClose(TrajectoryReader reader)
+{
+  if (reader->file != stdin)
+    fclose(reader->file);
+
+  free(reader->neurons);
+  free(reader->buffer);
+  free(reader);
+
+  return NULL;
+}
@@ -0,0 +1,116 @@
+/**
+ * @file
+ *
+ * A trajectory log holds snapshots of the net taken during training, so that
+ * pictures and analyses of the training can be made afterwards, without
+ * slowing down training by more than a sequential write.
+ *
+ * @author Christopher Blöcker
+ */
+#ifndef __TRAJECTORY_H__
+#define __TRAJECTORY_H__
+
+/* -------------------------------------------------------------------------- */
+#include "neuralNet.h"
+#include "vector.h"
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Trajectory logs start with this magic, followed by the version as a 64 bit
+ * integer. Every snapshot consists of the iteration, the learning rate, the
+ * number of neurons, the bounding box of the neurons as left, top, right and
+ * bottom, and the number of bytes of the neurons, each as a 64 bit integer or
+ * double, all in the byte order of the machine. The neurons follow in the
+ * order of the ring: their coordinates, x before y, are quantized to
+ * TRAJECTORY_STEPS steps across the bounding box and stored as the difference
+ * to the coordinate of the previous neuron, zigzag encoded as a varint of 7
+ * bits per byte, least significant first. Neighbours in the ring lie close to
+ * each other, so that most neurons take two or three bytes.
+ */
+#define TRAJECTORY_MAGIC   "TSPT"
+#define TRAJECTORY_VERSION (1)
+#define TRAJECTORY_STEPS   (65535)
+
+/* -------------------------------------------------------------------------- */
+
+/* A log that snapshots are appended to */
+typedef struct TrajectoryData * Trajectory;
+
+/* A log that snapshots are read from */
+typedef struct TrajectoryReaderData * TrajectoryReader;
+
+/* A snapshot of the net */
+typedef struct {
+  unsigned long iteration;
+  double learningRate;
+
+  /* Positions of the neurons in the order of the ring */
+  unsigned long size;
+  Vector * neurons;
+} TrajectorySnapshot;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Opens the given target for snapshots. The target is a file name, "-" for
+ * stdout or "fd:<n>" for an open file descriptor. Snapshots are appended to
+ * an existing log file if append is set.
+ *
+ * @param[in] target  Where to write the snapshots.
+ * @param[in] append  Whether to append to an existing file.
+ *
+ * @return The log, NULL in case of an error.
+ */
+extern Trajectory trajectoryOpen(char * target, int append);
+
+/**
+ * Appends a snapshot of the net to the log.
+ *
+ * @param[in] trajectory    The log.
+ * @param[in] nn            Neural net.
+ * @param[in] iteration     Iteration of training.
+ * @param[in] learningRate  Learning rate at that iteration.
+ *
+ * @return 0 on success.
+ */
+extern int trajectoryWrite(Trajectory trajectory, NeuralNet nn, unsigned long iteration, double learningRate);
+
+/**
+ * Writes the remaining snapshots and closes the target.
+ *
+ * @param[in] trajectory  The log.
+ *
+ * @return NULL.
+ */
+extern Trajectory trajectoryClose(Trajectory trajectory);
+
+/**
+ * Opens the given log for reading. The file name "-" refers to stdin.
+ *
+ * @param[in] filename  File that contains the log.
+ *
+ * @return The reader, NULL in case of an error.
+ */
+extern TrajectoryReader trajectoryReaderOpen(char * filename);
+
+/**
+ * Reads the next snapshot. Its neurons belong to the reader and remain valid
+ * until the next snapshot is read.
+ *
+ * @param[in]  reader    The reader.
+ * @param[out] snapshot  The snapshot.
+ *
+ * @return 0 on success, 1 if there are no more snapshots, -1 in case of an error.
+ */
+extern int trajectoryReaderNext(TrajectoryReader reader, TrajectorySnapshot * snapshot);
+
+/**
+ * Closes the log.
+ *
+ * @param[in] reader  The reader.
+ *
+ * @return NULL.
+ */
+extern TrajectoryReader trajectoryReaderClose(TrajectoryReader reader);
+
+#endif
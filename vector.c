@@ -5,6 +5,7 @@
  */
 
 /* -------------------------------------------------------------------------- */
+#include <string.h>
 #include <math.h>
 /* -------------------------------------------------------------------------- */
 #include "vector.h"
@@ -13,63 +14,71 @@
 #define RADTODEG(x) ((180)*(x)/(M_PI))
 /* -------------------------------------------------------------------------- */
 
+/* Two doubles, e.g. both components of a vector, in one SIMD register */
+typedef double Lanes __attribute__ ((vector_size (2 * sizeof(double))));
+
+/* Lanes with all bits set where a comparison holds, or indices */
+typedef long long Mask __attribute__ ((vector_size (2 * sizeof(double))));
+
+/* -------------------------------------------------------------------------- */
+
 /**
- * Creates a 2D vector.
- *
- * @param[in] x  x-component.
- * @param[in] y  y-component.
- *
- * @return The vector with the given components.
+ * Loads two doubles, which need not be aligned like Lanes.
  */
-extern Vector vectorMake(double x, double y)
+static inline Lanes lanesLoad(const void * p)
 {
-  Vector res;
+  Lanes res;
 
-  res.x = x;
-  res.y = y;
+  memcpy(&res, p, sizeof(res));
 
   return res;
 }
 
 /**
- * Adds two vectors.
- *
- * @param[in] u  First vector.
- * @param[in] v  Second vector.
- *
- * @return u+v.
+ * Stores two doubles, which need not be aligned like Lanes.
  */
-extern Vector vectorAdd(Vector u, Vector v)
+static inline void lanesStore(void * p, Lanes l)
 {
-  return vectorMake(u.x + v.x, u.y + v.y);
+  memcpy(p, &l, sizeof(l));
 }
 
 /**
- * Subtracts one vector from another.
- *
- * @param[in] u  First vector.
- * @param[in] v  Second vector.
- *
- * @return u-v.
+ * Picks a where mask is set and b elsewhere.
  */
-extern Vector vectorSub(Vector u, Vector v)
+static inline Lanes lanesSelect(Mask mask, Lanes a, Lanes b)
 {
-  return vectorMake(u.x - v.x, u.y - v.y);
+  return (Lanes) ((mask & (Mask) a) | (~mask & (Mask) b));
 }
 
 /**
- * Scales a vector by a scalar.
- *
- * @param[in] u  Vector that should be scaled.
- * @param[in] s  Scaling factor.
- *
- * @return v*s.
+ * Squared lengths of two vectors, the first in the first lane.
+ */
+static inline Lanes lanesLength2(Lanes a, Lanes b)
+{
+  a *= a;
+  b *= b;
+
+  Lanes x = { a[0], b[0] }
+      , y = { a[1], b[1] }
+      ;
+
+  return x + y;
+}
+
+/**
+ * Index of the smaller of two lanes of values with their indices, the smaller
+ * index where they are the same.
  */
-extern Vector vectorScale(Vector u, double s)
+static inline unsigned long lanesArgmin(Lanes values, Mask indices)
 {
-  return vectorMake(u.x * s, u.y * s);
+  return values[1] < values[0] || (values[1] == values[0] && indices[1] < indices[0])
+       ? indices[1]
+       : indices[0]
+       ;
 }
 
+/* -------------------------------------------------------------------------- */
+
 /**
  * Rotates a vector by the given angle.
  *
@@ -86,3 +95,168 @@ extern Vector vectorRotate(Vector u, double angle)
                    , u.x * sin(a) + u.y * cos(a)
                    );
 }
+
+/**
+ * Moves points towards a target, each by its own rate, i.e.
+ * points[i] += (target - points[i]) * rates[i].
+ *
+ * @param[in,out] points  The points.
+ * @param[in]     n       Number of points.
+ * @param[in]     target  Where the points move to.
+ * @param[in]     rates   Fraction of the way each point moves.
+ */
+extern void vectorToward(Vector * points, unsigned long n, Vector target, const double * rates)
+{
+  Lanes t = lanesLoad(&target);
+
+  for (unsigned long i = 0; i < n; ++i)
+  {
+    Lanes p = lanesLoad(points + i)
+        , r = { rates[i], rates[i] }
+        ;
+
+    lanesStore(points + i, p + (t - p) * r);
+  }
+}
+
+/**
+ * Maps points affinely, i.e. out[i] = (points[i] - origin) * scale + offset,
+ * with the components multiplied separately. points and out may be the same.
+ *
+ * @param[in]  points  The points.
+ * @param[in]  n       Number of points.
+ * @param[in]  origin  Subtracted first.
+ * @param[in]  scale   Factors for x and y.
+ * @param[in]  offset  Added last.
+ * @param[out] out     Space for n points.
+ */
+extern void vectorProject(const Vector * points, unsigned long n, Vector origin, Vector scale, Vector offset, Vector * out)
+{
+  Lanes o = lanesLoad(&origin)
+      , s = lanesLoad(&scale)
+      , a = lanesLoad(&offset)
+      ;
+
+  for (unsigned long i = 0; i < n; ++i)
+    lanesStore(out + i, (lanesLoad(points + i) - o) * s + a);
+}
+
+/**
+ * Calculates the squared distances from a vector to points.
+ *
+ * @param[in]  u          The vector.
+ * @param[in]  points     The points.
+ * @param[in]  n          Number of points.
+ * @param[out] distances  Space for n squared distances.
+ */
+extern void vectorDistances2(Vector u, const Vector * points, unsigned long n, double * distances)
+{
+  Lanes t = lanesLoad(&u);
+  unsigned long i = 0;
+
+  for (; i + 1 < n; i += 2)
+    lanesStore(distances + i, lanesLength2(lanesLoad(points + i) - t, lanesLoad(points + i + 1) - t));
+
+  if (i < n)
+    distances[i] = vectorDistance2(points[i], u);
+}
+
+/**
+ * Finds the smallest of the given values.
+ *
+ * @param[in] values  The values.
+ * @param[in] n       Number of values, at least 1.
+ *
+ * @return Index of the first smallest value.
+ */
+extern unsigned long vectorArgmin(const double * values, unsigned long n)
+{
+  Lanes best = { INFINITY, INFINITY };
+  Mask index = { 0, 1 }
+     , step  = { 2, 2 }
+     , found = { 0, 0 }
+     ;
+  unsigned long i = 0;
+
+  /* Even values in the first lane, odd ones in the second */
+  for (; i + 1 < n; i += 2, index += step)
+  {
+    Lanes v = lanesLoad(values + i);
+    Mask less = (Mask) (v < best);
+
+    best  = lanesSelect(less, v, best);
+    found = (less & index) | (~less & found);
+  }
+
+  unsigned long res = lanesArgmin(best, found);
+
+  if (i < n && values[i] < values[res])
+    res = i;
+
+  return res;
+}
+
+/**
+ * Finds the point nearest to a vector, which is the same as vectorArgmin over
+ * vectorDistances2 but without storing the distances.
+ *
+ * @param[in] u       The vector.
+ * @param[in] points  The points.
+ * @param[in] n       Number of points, at least 1.
+ *
+ * @return Index of the first nearest point.
+ */
+extern unsigned long vectorNearest(Vector u, const Vector * points, unsigned long n)
+{
+  Lanes t    = lanesLoad(&u)
+      , best = { INFINITY, INFINITY }
+      ;
+  Mask index = { 0, 1 }
+     , step  = { 2, 2 }
+     , found = { 0, 0 }
+     ;
+  unsigned long i = 0;
+
+  /* Even points in the first lane, odd ones in the second */
+  for (; i + 1 < n; i += 2, index += step)
+  {
+    Lanes d = lanesLength2(lanesLoad(points + i) - t, lanesLoad(points + i + 1) - t);
+    Mask less = (Mask) (d < best);
+
+    best  = lanesSelect(less, d, best);
+    found = (less & index) | (~less & found);
+  }
+
+  unsigned long res = lanesArgmin(best, found);
+
+  if (i < n && vectorDistance2(points[i], u) < vectorDistance2(points[res], u))
+    res = i;
+
+  return res;
+}
+
+/**
+ * Finds the bounding box around points.
+ *
+ * @param[in]  points  The points.
+ * @param[in]  n       Number of points, at least 1.
+ * @param[out] min     Smallest x and y.
+ * @param[out] max     Largest x and y.
+ */
+extern void vectorBounds(const Vector * points, unsigned long n, Vector * min, Vector * max)
+{
+  Lanes lo = lanesLoad(points)
+      , hi = lo
+      ;
+
+  for (unsigned long i = 1; i < n; ++i)
+  {
+    Lanes p = lanesLoad(points + i);
+
+    lo = lanesSelect((Mask) (p < lo), p, lo);
+    hi = lanesSelect((Mask) (p > hi), p, hi);
+  }
+
+  lanesStore(min, lo);
+  lanesStore(max, hi);
+}
@@ -1,6 +1,10 @@
 /**
  * @file
  *
+ * The scalar operations are defined here, so that they are inlined into the
+ * loops that use them. The operations on arrays of vectors work on both
+ * components of a vector at once, in SIMD registers where there are any.
+ *
  * @author Christopher Blöcker
  */
 #ifndef __VECTOR_H__
@@ -26,7 +30,15 @@ typedef struct {
  *
  * @return The vector with the given components.
  */
-extern Vector vectorMake(double x, double y);
+static inline Vector vectorMake(double x, double y)
+{
+  Vector res;
+
+  res.x = x;
+  res.y = y;
+
+  return res;
+}
 
 /**
  * Adds two vectors.
@@ -36,7 +48,10 @@ extern Vector vectorMake(double x, double y);
  *
  * @return u+v.
  */
-extern Vector vectorAdd(Vector u, Vector v);
+static inline Vector vectorAdd(Vector u, Vector v)
+{
+  return vectorMake(u.x + v.x, u.y + v.y);
+}
 
 /**
  * Subtracts one vector from another.
@@ -46,7 +61,10 @@ extern Vector vectorAdd(Vector u, Vector v);
  *
  * @return u-v.
  */
-extern Vector vectorSub(Vector u, Vector v);
+static inline Vector vectorSub(Vector u, Vector v)
+{
+  return vectorMake(u.x - v.x, u.y - v.y);
+}
 
 /**
  * Scales a vector by a scalar.
@@ -56,7 +74,26 @@ extern Vector vectorSub(Vector u, Vector v);
  *
  * @return v*s.
  */
-extern Vector vectorScale(Vector u, double s);
+static inline Vector vectorScale(Vector u, double s)
+{
+  return vectorMake(u.x * s, u.y * s);
+}
+
+/**
+ * Calculates the squared distance between two vectors, which orders vectors
+ * by distance without taking a square root.
+ *
+ * @param[in] u  First vector.
+ * @param[in] v  Second vector.
+ *
+ * @return |u-v|².
+ */
+static inline double vectorDistance2(Vector u, Vector v)
+{
+  Vector d = vectorSub(u, v);
+
+  return d.x * d.x + d.y * d.y;
+}
 
 /**
  * Rotates a vector by the given angle.
@@ -68,4 +105,72 @@ extern Vector vectorScale(Vector u, double s);
  */
 extern Vector vectorRotate(Vector u, double angle);
 
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Moves points towards a target, each by its own rate, i.e.
+ * points[i] += (target - points[i]) * rates[i].
+ *
+ * @param[in,out] points  The points.
+ * @param[in]     n       Number of points.
+ * @param[in]     target  Where the points move to.
+ * @param[in]     rates   Fraction of the way each point moves.
+ */
+extern void vectorToward(Vector * points, unsigned long n, Vector target, const double * rates);
+
+/**
+ * Maps points affinely, i.e. out[i] = (points[i] - origin) * scale + offset,
+ * with the components multiplied separately. points and out may be the same.
+ *
+ * @param[in]  points  The points.
+ * @param[in]  n       Number of points.
+ * @param[in]  origin  Subtracted first.
+ * @param[in]  scale   Factors for x and y.
+ * @param[in]  offset  Added last.
+ * @param[out] out     Space for n points.
+ */
+extern void vectorProject(const Vector * points, unsigned long n, Vector origin, Vector scale, Vector offset, Vector * out);
+
+/**
+ * Calculates the squared distances from a vector to points.
+ *
+ * @param[in]  u          The vector.
+ * @param[in]  points     The points.
+ * @param[in]  n          Number of points.
+ * @param[out] distances  Space for n squared distances.
+ */
+extern void vectorDistances2(Vector u, const Vector * points, unsigned long n, double * distances);
+
+/**
+ * Finds the smallest of the given values.
+ *
+ * @param[in] values  The values.
+ * @param[in] n       Number of values, at least 1.
+ *
+ * @return Index of the first smallest value.
+ */
+extern unsigned long vectorArgmin(const double * values, unsigned long n);
+
+/**
+ * Finds the point nearest to a vector, which is the same as vectorArgmin over
+ * vectorDistances2 but without storing the distances.
+ *
+ * @param[in] u       The vector.
+ * @param[in] points  The points.
+ * @param[in] n       Number of points, at least 1.
+ *
+ * @return Index of the first nearest point.
+ */
+extern unsigned long vectorNearest(Vector u, const Vector * points, unsigned long n);
+
+/**
+ * Finds the bounding box around points.
+ *
+ * @param[in]  points  The points.
+ * @param[in]  n       Number of points, at least 1.
+ * @param[out] min     Smallest x and y.
+ * @param[out] max     Largest x and y.
+ */
+extern void vectorBounds(const Vector * points, unsigned long n, Vector * min, Vector * max);
+
 #endif
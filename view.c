@@ -0,0 +1,248 @@
+/**
+ * @file
+ *
+ * Watches a run of tspsom through its live view. The net is copied from the
+ * shared memory segment at a rate of its own and rendered whenever it has
+ * changed, until the run ends or the viewer is interrupted.
+ *
+ * @author Christopher Blöcker
+ */
+
+/* -------------------------------------------------------------------------- */
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+/* -------------------------------------------------------------------------- */
+#include "types.h"
+#include "sampleMap.h"
+#include "mapReader.h"
+#include "drawer.h"
+#include "solver.h"
+#include "frameSink.h"
+#include "liveView.h"
+#include "instrument.h"
+/* -------------------------------------------------------------------------- */
+
+/* A type for the config */
+typedef struct {
+  double rate;
+
+  Boolean help
+        , error
+        ;
+
+  char * filename
+     , * segment
+     , * frames
+     ;
+} Config;
+
+/* -------------------------------------------------------------------------- */
+#define DEFAULT_RATE   (   10)
+#define DEFAULT_FRAMES ("png")
+/* -------------------------------------------------------------------------- */
+
+/* Set once the viewer is interrupted */
+static volatile sig_atomic_t stopSignal = 0;
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ * Creates the default config
+ *
+ * @return Default config.
+ */
+static Config getDefaultConfig(void)
+{
+  Config c;
+
+  c.rate     = DEFAULT_RATE;
+  c.help     = FALSE;
+  c.error    = FALSE;
+  c.filename = NULL;
+  c.segment  = NULL;
+  c.frames   = DEFAULT_FRAMES;
+
+  return c;
+}
+
+/**
+ * Prints the help message to stream.
+ *
+ * @param stream Where to print the help message.
+ */
+static void help(FILE * stream)
+{
+  fprintf(stream, "tspview, a program for watching tspsom while it trains.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "Usage: tspview <tsp file> <segment> [options]\n");
+  fprintf(stream, "  Required arguments:\n");
+  fprintf(stream, "    tsp file       File that contains the tsp instance.\n");
+  fprintf(stream, "    segment        Live view published by tspsom -V.\n");
+  fprintf(stream, "\n");
+  fprintf(stream, "  Options:\n");
+  fprintf(stream, "    -r <number>    Frames per second                           (default: %i)\n", DEFAULT_RATE);
+  fprintf(stream, "    -f <format>    Images as png, fastpng, ppm, raw or tspf    (default: %s)\n", DEFAULT_FRAMES);
+  fprintf(stream, "                   ppm, raw and tspf stream to -, fd:<n> or a file given after a colon\n");
+}
+
+/**
+ * Parses the command line arguments.
+ *
+ * @param[in] argc Parameter count.
+ * @param[in] argv The parameters.
+ *
+ * @return Config parsed from the command line arguments.
+ */
+static Config parseArgs(int argc, char * argv[])
+{
+  Config c = getDefaultConfig();
+
+  /* First parameters are the instance and the segment */
+  c.filename = argv[1];
+  c.segment  = argv[2];
+  int i = 3;
+
+  while (i < argc && !c.error)
+  {
+    if (strcmp(argv[i], "-h") == 0)
+      c.help = TRUE;
+
+    else if (i + 1 == argc)
+      c.error = TRUE;
+
+    else if (strcmp(argv[i], "-r") == 0)
+      c.error = sscanf(argv[++i], "%lf", &c.rate) != 1 || !(c.rate > 0);
+
+    else if (strcmp(argv[i], "-f") == 0)
+      c.frames = argv[++i];
+
+    else
+      c.error = TRUE;
+
+    ++i;
+  }
+
+  if (c.error)
+    fprintf(stderr, "[ERROR] Invalid argument %s.\n", argv[i - 1]);
+
+  return c;
+}
+
+/**
+ * Stops the viewer after the current frame.
+ *
+ * @param[in] signal  The signal.
+ */
+static void stopRequest(int signal)
+{
+  stopSignal = signal;
+}
+
+/* -------------------------------------------------------------------------- */
+
+/**
+ *
+ */
+int main(int argc, char * argv[])
+{
+  if (argc < 3)
+  {
+    help(stderr);
+    return 1;
+  }
+
+  Config c = parseArgs(argc, argv);
+
+  if (c.help || c.error)
+  {
+    help(stderr);
+    return c.error;
+  }
+
+  SampleMap cities = mapReaderRead(c.filename);
+
+  if (!cities.items)
+  {
+    fprintf(stderr, "[ERROR] No cities read from %s.\n", c.filename);
+    return 1;
+  }
+
+  Drawer drawer = drawerMake(cities, solverBounds(cities));
+  LiveView view = NULL;
+  FrameSink sink = NULL;
+
+  int error = !drawer.samples
+           || !(view = liveViewOpen(c.segment))
+           || !(sink = frameSinkOpen(c.frames))
+           ;
+
+  signal(SIGINT, stopRequest);
+  signal(SIGTERM, stopRequest);
+
+  cairo_surface_t * surface = NULL;
+  LiveViewSnapshot snapshot;
+  unsigned long frames = 0;
+
+  uint64_t period = 1e9 / c.rate
+         , next   = instrumentNow()
+         ;
+
+  while (!error && !stopSignal)
+  {
+    /* A net published before the run ended is still copied */
+    int writing = liveViewWriting(view)
+      , status  = liveViewRead(view, &snapshot)
+      ;
+
+    if (status < 0)
+      error = 1;
+
+    else if (!status)
+    {
+      cairo_surface_t * drawn = drawerDrawNeurons(drawer, snapshot.neurons, snapshot.size, surface);
+
+      if (drawn)
+        surface = drawn;
+
+      error = frameSinkWrite(sink, drawn, frameSinkNext(sink), snapshot.iteration) || !drawn;
+      ++frames;
+    }
+
+    else if (!writing)
+      break;
+
+    /* Frames that are late are dropped rather than caught up on */
+    uint64_t now = instrumentNow();
+
+    next = next + period > now ? next + period : now;
+
+    if (next > now)
+    {
+      struct timespec pause = { (next - now) / 1000000000, (next - now) % 1000000000 };
+      nanosleep(&pause, NULL);
+    }
+  }
+
+  #ifdef INFO
+  if (!error)
+    fprintf(stderr, "[INFO ] Rendered %lu frames.\n", frames);
+  #endif
+
+  /* Clean up... */
+  if (surface)
+    cairo_surface_destroy(surface);
+
+  if (sink)
+    sink = frameSinkClose(sink);
+
+  if (view)
+    view = liveViewClose(view);
+
+  drawer = drawerFree(drawer);
+  cities = sampleMapFree(cities);
+
+  return error;
+}